@@ -4,6 +4,8 @@
 
 #define MAX_TITLE 50
 #define MAX_NOTIF 50
+#define MAX_LINE 4096
+#define MAX_FIELDS 16
 
 // ---------------- TASK (BST) ----------------
 typedef struct Task {
@@ -51,13 +53,23 @@ typedef struct Queue {
 
 Queue notifQ = {.front = 0, .rear = -1, .count = 0};
 
+// ---------------- ID INDEX ----------------
+// The BST is ordered by priority, so tasks are found by id through this
+// array (taskIndex[id], filled as tasks are created).
+Task **taskIndex = NULL;
+int taskIndexCap = 0;
+
 // ---------------- Function Prototypes ----------------
 // BST
 Task* createTask(int id, char *title, int priority, char *dueDate, char *status);
 Task* insertTaskBST(Task *root, Task *newtask);
-Task* searchTaskBST(Task *root, int id);
+Task* buildBST(Task **sorted, int count);
 void inorderBST(Task *root);
 
+// ID index
+void indexTask(Task *task);
+Task* findTaskByID(int id);
+
 // DLL
 void addTaskToUser(User *user, Task *task);
 void removeTaskFromUser(User *user, int taskID);
@@ -68,23 +80,42 @@ void pushUndo(Operation op);
 Operation popUndo();
 void pushRedo(Operation op);
 Operation popRedo();
-void undoOperation(User *user, Task *root);
-void redoOperation(User *user, Task *root);
+void undoOperation(User *user);
+void redoOperation(User *user);
 
 // Queue
 void enqueueNotification(const char *msg);
 void dequeueNotification();
 void displayNotifications();
 
+// Menu operations (shared by the interactive menu and batch mode)
+int addTask(Task **root, int *nextTaskID, char *title, int priority, char *dueDate, char *status);
+void assignTask(User *user, int taskID);
+void unassignTask(User *user, int taskID);
+
+// Bulk import / export and batch mode
+int jsonField(const char *line, const char *key, char *out, int size);
+int csvSplit(char *line, char *fields[], int max);
+int namesUser(const char *user, const char *assignees, const char *name);
+void flattenBST(Task *root, Task **out, int *count);
+int compareTaskPriority(const void *a, const void *b);
+void writeCSVField(FILE *fp, const char *s);
+void writeJSONString(FILE *fp, const char *s);
+int importTasks(Task **root, User *user, int *nextTaskID, const char *path);
+int exportTasks(User *user, int nextTaskID, const char *path);
+int runBatch(const char *path, Task **root, User *user, int *nextTaskID);
+
 // ---------------- BST FUNCTIONS ----------------
 Task* createTask(int id, char *title, int priority, char *dueDate, char *status) {
     Task* newtask = (Task*)malloc(sizeof(Task));
     newtask->id = id;
-    strcpy(newtask->title, title);
+    // bulk-loaded fields can be longer than the struct allows
+    snprintf(newtask->title, sizeof(newtask->title), "%s", title);
     newtask->priority = priority;
-    strcpy(newtask->dueDate, dueDate);
-    strcpy(newtask->status, status);
+    snprintf(newtask->dueDate, sizeof(newtask->dueDate), "%s", dueDate);
+    snprintf(newtask->status, sizeof(newtask->status), "%s", status);
     newtask->left = newtask->right = NULL;
+    indexTask(newtask);
     return newtask;
 }
 
@@ -97,12 +128,14 @@ Task* insertTaskBST(Task *root, Task *newtask) {
     return root;
 }
 
-Task* searchTaskBST(Task *root, int id) {
-    if (root == NULL || root->id == id) return root;
-    if (id < root->id)
-        return searchTaskBST(root->left, id);
-    else
-        return searchTaskBST(root->right, id);
+// Balanced BST over tasks already sorted by priority (bulk loads build it once)
+Task* buildBST(Task **sorted, int count) {
+    if (count <= 0) return NULL;
+    int mid = count / 2;
+    Task *root = sorted[mid];
+    root->left = buildBST(sorted, mid);
+    root->right = buildBST(sorted + mid + 1, count - mid - 1);
+    return root;
 }
 
 void inorderBST(Task *root) {
@@ -114,6 +147,25 @@ void inorderBST(Task *root) {
     }
 }
 
+// ---------------- ID INDEX FUNCTIONS ----------------
+void indexTask(Task *task) {
+    if (task->id >= taskIndexCap) {
+        int newCap = taskIndexCap ? taskIndexCap * 2 : 1024;
+        while (newCap <= task->id) newCap *= 2;
+        Task **grown = (Task**)realloc(taskIndex, newCap * sizeof(Task*));
+        if (grown == NULL) return;
+        memset(grown + taskIndexCap, 0, (newCap - taskIndexCap) * sizeof(Task*));
+        taskIndex = grown;
+        taskIndexCap = newCap;
+    }
+    taskIndex[task->id] = task;
+}
+
+Task* findTaskByID(int id) {
+    if (id <= 0 || id >= taskIndexCap) return NULL;
+    return taskIndex[id];
+}
+
 // ---------------- DLL FUNCTIONS ----------------
 void addTaskToUser(User *user, Task *task) {
     DLLNode *newNode = (DLLNode*)malloc(sizeof(DLLNode));
@@ -202,7 +254,7 @@ Operation popRedo() {
     return op;
 }
 
-void undoOperation(User *user, Task *root) {
+void undoOperation(User *user) {
     if (undoTop == NULL) {
         printf("Nothing to undo!\n");
         return;
@@ -213,7 +265,7 @@ void undoOperation(User *user, Task *root) {
         pushRedo(op);
         enqueueNotification("Undo: Task unassigned.");
     } else if (strcmp(op.type, "remove") == 0) {
-        Task *task = searchTaskBST(root, op.taskID);
+        Task *task = findTaskByID(op.taskID);
         if (task) {
             addTaskToUser(user, task);
             pushRedo(op);
@@ -222,14 +274,14 @@ void undoOperation(User *user, Task *root) {
     }
 }
 
-void redoOperation(User *user, Task *root) {
+void redoOperation(User *user) {
     if (redoTop == NULL) {
         printf("Nothing to redo!\n");
         return;
     }
     Operation op = popRedo();
     if (strcmp(op.type, "assign") == 0) {
-        Task *task = searchTaskBST(root, op.taskID);
+        Task *task = findTaskByID(op.taskID);
         if (task) addTaskToUser(user, task);
         pushUndo(op);
         enqueueNotification("Redo: Task assigned again.");
@@ -274,8 +326,357 @@ void displayNotifications() {
     }
 }
 
+// ---------------- MENU OPERATIONS ----------------
+int addTask(Task **root, int *nextTaskID, char *title, int priority, char *dueDate, char *status) {
+    int id = (*nextTaskID)++;
+    *root = insertTaskBST(*root, createTask(id, title, priority, dueDate, status));
+    printf("Task added successfully with ID %d!\n", id);
+    enqueueNotification("New task added.");
+    return id;
+}
+
+void assignTask(User *user, int taskID) {
+    Task *task = findTaskByID(taskID);
+    if (task) {
+        addTaskToUser(user, task);
+        printf("Task assigned to %s.\n", user->username);
+        Operation op = {"assign", taskID};
+        pushUndo(op);
+        enqueueNotification("Task assigned to user.");
+    } else {
+        printf("Task ID %d not found!\n", taskID);
+    }
+}
+
+void unassignTask(User *user, int taskID) {
+    removeTaskFromUser(user, taskID);
+    Operation op = {"remove", taskID};
+    pushUndo(op);
+    enqueueNotification("Task removed from user.");
+}
+
+// ---------------- BULK IMPORT / EXPORT ----------------
+// Same line formats as the engine's import_tasks_api / export_tasks_api:
+// NDJSON, one {"title","priority","due","status","user","assignees"} object per line,
+// or CSV with a header row naming those columns (any order, assignees ';'-separated).
+// Lines are streamed one at a time; a task is given to the CLI user when it names them
+// as its user or an assignee. New tasks are linked into the BST once, at the end, by
+// rebuilding it balanced instead of inserting one by one.
+
+// Copies the JSON value of "key" (string, number or literal) into out; 0 when absent
+int jsonField(const char *line, const char *key, char *out, int size) {
+    size_t klen = strlen(key);
+    const char *p = line;
+    while ((p = strchr(p, '"')) != NULL) {
+        p++;
+        const char *v = p + klen + 1;
+        if (strncmp(p, key, klen) == 0 && p[klen] == '"') {
+            while (*v == ' ' || *v == '\t') v++;
+        }
+        if (strncmp(p, key, klen) == 0 && p[klen] == '"' && *v == ':') {
+            v++;
+            while (*v == ' ' || *v == '\t') v++;
+            int n = 0;
+            if (*v == '"') {
+                for (v++; *v && *v != '"'; v++) {
+                    char c = *v;
+                    if (c == '\\' && v[1]) {
+                        c = *++v;
+                        if (c == 'n') c = ' ';
+                        else if (c == 't') c = ' ';
+                    }
+                    if (n < size - 1) out[n++] = c;
+                }
+            } else if (*v == '[') {
+                // assignees array: flattened to "a;b;c"
+                for (v++; *v && *v != ']'; v++) {
+                    if (*v == '"' || *v == ' ') continue;
+                    if (n < size - 1) out[n++] = (*v == ',') ? ';' : *v;
+                }
+            } else {
+                while (*v && *v != ',' && *v != '}' && *v != ' ' && *v != '\r' && *v != '\n')
+                    if (n < size - 1) out[n++] = *v++;
+                    else v++;
+            }
+            out[n] = '\0';
+            return 1;
+        }
+        // skip the rest of this string so values are not mistaken for keys
+        while (*p && *p != '"') {
+            if (*p == '\\' && p[1]) p++;
+            p++;
+        }
+        if (*p) p++;
+    }
+    return 0;
+}
+
+// Splits a CSV line in place; quoted fields may contain commas and "" escapes
+int csvSplit(char *line, char *fields[], int max) {
+    int count = 0;
+    char *p = line;
+    line[strcspn(line, "\r\n")] = '\0';
+    while (count < max) {
+        char *out = p;
+        fields[count++] = p;
+        if (*p == '"') {
+            char *in = p + 1;
+            while (*in) {
+                if (*in == '"' && in[1] == '"') { *out++ = '"'; in += 2; }
+                else if (*in == '"') { in++; break; }
+                else *out++ = *in++;
+            }
+            while (*in && *in != ',') in++;
+            p = in;
+        } else {
+            while (*p && *p != ',') p++;
+            out = p;
+        }
+        char last = *p;
+        *out = '\0';
+        if (last != ',') break;
+        p++;
+    }
+    return count;
+}
+
+// True when name appears in user or in the ';'-separated assignees
+int namesUser(const char *user, const char *assignees, const char *name) {
+    if (strcmp(user, name) == 0) return 1;
+    size_t len = strlen(name);
+    const char *p = assignees;
+    while (*p) {
+        size_t n = strcspn(p, ";");
+        if (n == len && strncmp(p, name, len) == 0) return 1;
+        p += n;
+        if (*p) p++;
+    }
+    return 0;
+}
+
+void flattenBST(Task *root, Task **out, int *count) {
+    if (root == NULL) return;
+    flattenBST(root->left, out, count);
+    out[(*count)++] = root;
+    flattenBST(root->right, out, count);
+}
+
+int compareTaskPriority(const void *a, const void *b) {
+    const Task *x = *(Task * const *)a, *y = *(Task * const *)b;
+    if (x->priority != y->priority) return x->priority < y->priority ? -1 : 1;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Returns the number of tasks imported, or -1 when the file cannot be read
+int importTasks(Task **root, User *user, int *nextTaskID, const char *path) {
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (fp == NULL) {
+        printf("Cannot open %s!\n", path);
+        return -1;
+    }
+    size_t plen = strlen(path);
+    int csv = plen > 4 && strcmp(path + plen - 4, ".csv") == 0;
+    enum { C_TITLE, C_PRIORITY, C_DUE, C_STATUS, C_USER, C_ASSIGNEES, C_COUNT };
+    const char *names[C_COUNT] = { "title", "priority", "due", "status", "user", "assignees" };
+    int column[C_COUNT];
+    char line[MAX_LINE];
+    int i, firstID = *nextTaskID, imported = 0, skipped = 0;
+
+    for (i = 0; i < C_COUNT; i++) column[i] = -1;
+    if (csv && fgets(line, sizeof(line), fp)) {
+        char *fields[MAX_FIELDS];
+        int n = csvSplit(line, fields, MAX_FIELDS);
+        for (int f = 0; f < n; f++)
+            for (i = 0; i < C_COUNT; i++)
+                if (strcmp(fields[f], names[i]) == 0) column[i] = f;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (strchr(line, '\n') == NULL && !feof(fp)) {
+            // longer than MAX_LINE: drop the rest of it
+            int c;
+            while ((c = fgetc(fp)) != EOF && c != '\n');
+            skipped++;
+            continue;
+        }
+        char value[C_COUNT][MAX_LINE / 4];
+        for (i = 0; i < C_COUNT; i++) value[i][0] = '\0';
+        if (csv) {
+            char *fields[MAX_FIELDS];
+            int n = csvSplit(line, fields, MAX_FIELDS);
+            for (i = 0; i < C_COUNT; i++)
+                if (column[i] >= 0 && column[i] < n)
+                    snprintf(value[i], sizeof(value[i]), "%s", fields[column[i]]);
+        } else {
+            for (i = 0; i < C_COUNT; i++)
+                jsonField(line, names[i], value[i], sizeof(value[i]));
+        }
+        if (value[C_TITLE][0] == '\0') {
+            // blank lines and user records carry no task
+            skipped++;
+            continue;
+        }
+        int priority = atoi(value[C_PRIORITY]);
+        Task *task = createTask((*nextTaskID)++, value[C_TITLE], priority ? priority : 2,
+                                value[C_DUE], value[C_STATUS][0] ? value[C_STATUS] : "Pending");
+        if (namesUser(value[C_USER], value[C_ASSIGNEES], user->username))
+            addTaskToUser(user, task);
+        imported++;
+    }
+    if (fp != stdin) fclose(fp);
+
+    if (imported > 0) {
+        int count = 0;
+        Task **sorted = (Task**)malloc((*nextTaskID) * sizeof(Task*));
+        if (sorted == NULL) {
+            // no room for the rebuild: fall back to inserting the new tasks
+            for (i = firstID; i < *nextTaskID; i++)
+                *root = insertTaskBST(*root, findTaskByID(i));
+        } else {
+            flattenBST(*root, sorted, &count);
+            for (i = firstID; i < *nextTaskID; i++)
+                sorted[count++] = findTaskByID(i);
+            qsort(sorted, count, sizeof(Task*), compareTaskPriority);
+            *root = buildBST(sorted, count);
+            free(sorted);
+        }
+    }
+    printf("Imported %d tasks (%d lines skipped).\n", imported, skipped);
+    enqueueNotification("Tasks imported.");
+    return imported;
+}
+
+void writeCSVField(FILE *fp, const char *s) {
+    if (strpbrk(s, ",\"\r\n") == NULL) {
+        fputs(s, fp);
+        return;
+    }
+    fputc('"', fp);
+    for (; *s; s++) {
+        if (*s == '"') fputc('"', fp);
+        fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+void writeJSONString(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', fp);
+        if ((unsigned char)*s < 0x20) fputc(' ', fp);
+        else fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+// Writes every task in id order; returns the count, or -1 when the file cannot be written
+int exportTasks(User *user, int nextTaskID, const char *path) {
+    FILE *fp = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (fp == NULL) {
+        printf("Cannot write %s!\n", path);
+        return -1;
+    }
+    size_t plen = strlen(path);
+    int csv = plen > 4 && strcmp(path + plen - 4, ".csv") == 0;
+    // mark the user's tasks once instead of walking their list per task
+    char *held = (char*)calloc(nextTaskID > 0 ? nextTaskID : 1, 1);
+    DLLNode *node;
+    int id, exported = 0;
+
+    for (node = user->taskHead; node != NULL && held != NULL; node = node->next)
+        held[node->task->id] = 1;
+    if (csv) fputs("id,user,title,priority,due,status,assignees\n", fp);
+    for (id = 1; id < nextTaskID; id++) {
+        Task *task = findTaskByID(id);
+        if (task == NULL) continue;
+        const char *owner = (held && held[id]) ? user->username : "";
+        if (csv) {
+            fprintf(fp, "%d,", task->id);
+            writeCSVField(fp, owner);
+            fputc(',', fp);
+            writeCSVField(fp, task->title);
+            fprintf(fp, ",%d,", task->priority);
+            writeCSVField(fp, task->dueDate);
+            fputc(',', fp);
+            writeCSVField(fp, task->status);
+            fputs(",\n", fp);
+        } else {
+            fprintf(fp, "{\"id\":%d,\"user\":", task->id);
+            writeJSONString(fp, owner);
+            fputs(",\"title\":", fp);
+            writeJSONString(fp, task->title);
+            fprintf(fp, ",\"priority\":%d,\"due\":", task->priority);
+            writeJSONString(fp, task->dueDate);
+            fputs(",\"status\":", fp);
+            writeJSONString(fp, task->status);
+            fputs(",\"assignees\":[]}\n", fp);
+        }
+        exported++;
+    }
+    free(held);
+    if (fp != stdout) fclose(fp);
+    else fflush(fp);
+    if (fp != stdout) printf("Exported %d tasks to %s.\n", exported, path);
+    return exported;
+}
+
+// ---------------- BATCH MODE ----------------
+// 4.c --batch <file> runs the commands in file ("-" for stdin), one per line:
+//   add <priority> <YYYY-MM-DD> <status> <title...>
+//   list | mine | assign <id> | remove <id> | undo | redo | notifications
+//   import <file> | export <file>   (".csv" selects CSV, otherwise NDJSON)
+// Blank lines and lines starting with '#' are ignored. Returns the number of failed lines.
+int runBatch(const char *path, Task **root, User *user, int *nextTaskID) {
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (fp == NULL) {
+        printf("Cannot open %s!\n", path);
+        return 1;
+    }
+    char line[MAX_LINE], cmd[20], arg[MAX_LINE];
+    int lineNo = 0, failed = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        lineNo++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#') continue;
+        if (sscanf(p, "%19s", cmd) != 1) continue;
+
+        int id, priority, used = 0;
+        char dueDate[11], status[20];
+        if (strcmp(cmd, "add") == 0 &&
+            sscanf(p, "add %d %10s %19s %n", &priority, dueDate, status, &used) == 3 && p[used]) {
+            addTask(root, nextTaskID, p + used, priority, dueDate, status);
+        } else if (strcmp(cmd, "list") == 0) {
+            inorderBST(*root);
+        } else if (strcmp(cmd, "mine") == 0) {
+            displayUserTasks(user);
+        } else if (strcmp(cmd, "assign") == 0 && sscanf(p, "assign %d", &id) == 1) {
+            assignTask(user, id);
+        } else if (strcmp(cmd, "remove") == 0 && sscanf(p, "remove %d", &id) == 1) {
+            unassignTask(user, id);
+        } else if (strcmp(cmd, "undo") == 0) {
+            undoOperation(user);
+        } else if (strcmp(cmd, "redo") == 0) {
+            redoOperation(user);
+        } else if (strcmp(cmd, "notifications") == 0) {
+            displayNotifications();
+        } else if (strcmp(cmd, "import") == 0 && sscanf(p, "import %4095s", arg) == 1) {
+            if (importTasks(root, user, nextTaskID, arg) < 0) failed++;
+        } else if (strcmp(cmd, "export") == 0 && sscanf(p, "export %4095s", arg) == 1) {
+            if (exportTasks(user, *nextTaskID, arg) < 0) failed++;
+        } else {
+            printf("%s:%d: cannot run \"%s\"\n", path, lineNo, p);
+            failed++;
+        }
+    }
+    if (fp != stdin) fclose(fp);
+    return failed;
+}
+
 // ---------------- MAIN ----------------
-int main() {
+int main(int argc, char *argv[]) {
     Task *root = NULL;
     User user1;
     strcpy(user1.username, "Alice");
@@ -285,6 +686,9 @@ int main() {
     char title[MAX_TITLE], dueDate[11], status[20];
     int nextTaskID = 1;
 
+    if (argc == 3 && strcmp(argv[1], "--batch") == 0)
+        return runBatch(argv[2], &root, &user1, &nextTaskID) ? 1 : 0;
+
     while (1) {
         printf("\n===== TASK MANAGEMENT MENU =====\n");
         printf("1. Add Task (to BST)\n");
@@ -315,9 +719,7 @@ int main() {
                 fgets(status, 20, stdin);
                 status[strcspn(status, "\n")] = '\0';
 
-                root = insertTaskBST(root, createTask(nextTaskID++, title, priority, dueDate, status));
-                printf("Task added successfully with ID %d!\n", nextTaskID - 1);
-                enqueueNotification("New task added.");
+                addTask(&root, &nextTaskID, title, priority, dueDate, status);
                 break;
 
             case 2:
@@ -329,16 +731,7 @@ int main() {
                 printf("Enter Task ID to assign: ");
                 int assignID;
                 scanf("%d", &assignID);
-                Task *task = searchTaskBST(root, assignID);
-                if (task) {
-                    addTaskToUser(&user1, task);
-                    printf("Task assigned to %s.\n", user1.username);
-                    Operation op = {"assign", assignID};
-                    pushUndo(op);
-                    enqueueNotification("Task assigned to user.");
-                } else {
-                    printf("Task ID %d not found!\n", assignID);
-                }
+                assignTask(&user1, assignID);
                 break;
             }
 
@@ -346,10 +739,7 @@ int main() {
                 printf("Enter Task ID to remove from user: ");
                 int removeID;
                 scanf("%d", &removeID);
-                removeTaskFromUser(&user1, removeID);
-                Operation op = {"remove", removeID};
-                pushUndo(op);
-                enqueueNotification("Task removed from user.");
+                unassignTask(&user1, removeID);
                 break;
             }
 
@@ -358,11 +748,11 @@ int main() {
                 break;
 
             case 6:
-                undoOperation(&user1, root);
+                undoOperation(&user1);
                 break;
 
             case 7:
-                redoOperation(&user1, root);
+                redoOperation(&user1);
                 break;
 
             case 8:
@@ -377,4 +767,4 @@ int main() {
                 printf("Invalid choice!\n");
         }
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
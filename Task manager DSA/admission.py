@@ -0,0 +1,193 @@
+import collections
+import math
+import os
+import re
+import threading
+import time
+
+# Admission control for the Flask front end, as WSGI middleware around app.wsgi_app.
+# Every /api/ request is put in a lane; each lane runs at most `slots` requests at once and
+# queues at most `queue` more, first come first served:
+#   write   POST/DELETE calls that change tasks, users, teams or dependencies
+#   read    single-user GETs (the fast lane: its slots are never taken by heavy calls)
+#   heavy   whole-engine calls: manager views, export, queries, analytics, bulk assign
+#   poll    notification polling, the cheapest to retry
+#   import  bulk imports, one at a time: an import holds every shard lock until it is done,
+#           so it may take seconds to minutes and must not queue behind, or block, heavy calls
+# A request is refused with 429 and a Retry-After (seconds) when
+# - its lane's queue, or the queue for its endpoint, is full;
+# - it is a heavy call, a poll or an import and a more important lane (in the order above)
+#   has requests waiting: imports shed first, then polls, then heavy calls, so writes and
+#   single-user reads keep the engine;
+# - the expected wait (queue position x the lane's average service time / slots) exceeds
+#   the lane's deadline, or the request is still queued when the deadline passes.
+# TASK_ADMISSION=0 turns it off; TASK_ADMIT_<LANE>=slots,queue,deadline_ms overrides a lane.
+
+LANES = (
+    # name, slots, queue, deadline (s), sheddable
+    ("write", 8, 64, 2.0, False),
+    ("read", 8, 64, 1.0, False),
+    ("heavy", 2, 4, 5.0, True),
+    ("poll", 4, 16, 0.5, True),
+    ("import", 1, 2, 120.0, True),
+)
+ENDPOINT_QUEUE = int(os.environ.get("TASK_ADMIT_ENDPOINT_QUEUE", "32"))
+HEAVY_PATHS = ("/api/manager/", "/api/export", "/api/query", "/api/analytics",
+               "/api/dependencies/")
+SERVICE_EWMA = 0.1
+
+
+def classify(method, path):
+    # lane for a request, None if it is not admission-controlled
+    if not path.startswith("/api/") or path == "/api/replication":
+        return None
+    if path.startswith("/api/import"):
+        return "import"
+    if path.startswith(HEAVY_PATHS) or (method == "POST" and re.fullmatch(r"/api/teams/[^/]+/auto_assign", path)):
+        return "heavy"
+    if method == "GET":
+        return "poll" if path == "/api/notifications" else "read"
+    return "write"
+
+
+class Rejected(Exception):
+    def __init__(self, retry_after, reason):
+        super().__init__(reason)
+        self.retry_after = retry_after
+        self.reason = reason
+
+
+class Lane:
+    def __init__(self, name, rank, slots, queue, deadline, sheddable):
+        self.name, self.rank, self.sheddable = name, rank, sheddable
+        self.slots, self.queue, self.deadline = slots, queue, deadline
+        self.busy = 0
+        self.waiting = collections.deque()
+        self.service = 0.01          # average seconds a request holds a slot
+        self.admitted = 0
+        self.rejected = collections.Counter()
+
+    def estimate(self, position):
+        return position * self.service / self.slots
+
+
+class Admission:
+    def __init__(self, app):
+        self.app = app
+        self.lock = threading.Lock()
+        self.lanes = {}
+        for rank, (name, slots, queue, deadline, sheddable) in enumerate(LANES):
+            spec = os.environ.get(f"TASK_ADMIT_{name.upper()}")
+            if spec:
+                s, q, d = spec.split(",")
+                slots, queue, deadline = int(s), int(q), int(d) / 1000.0
+            self.lanes[name] = Lane(name, rank, max(1, slots), queue, deadline, sheddable)
+        self.endpoints = collections.Counter()   # requests queued per endpoint
+        self.cond = threading.Condition(self.lock)
+
+    def __call__(self, environ, start_response):
+        lane = self.lanes.get(classify(environ.get("REQUEST_METHOD", "GET"), environ.get("PATH_INFO", "")))
+        if lane is None:
+            return self.app(environ, start_response)
+        endpoint = environ["REQUEST_METHOD"] + " " + re.sub(r"/\d+(?=/|$)", "/<id>", environ["PATH_INFO"])
+        try:
+            self.enter(lane, endpoint)
+        except Rejected as r:
+            body = ('{"error":"server busy: %s"}' % r.reason).encode()
+            start_response("429 Too Many Requests", [("Content-Type", "application/json"),
+                                                     ("Content-Length", str(len(body))),
+                                                     ("Retry-After", str(r.retry_after))])
+            return [body]
+        start = time.monotonic()
+        try:
+            result = self.app(environ, start_response)
+        except BaseException:
+            self.leave(lane, start)
+            raise
+        # streamed bodies (export) keep their slot until the server closes the iterable
+        return Release(result, lambda: self.leave(lane, start))
+
+    def enter(self, lane, endpoint):
+        with self.lock:
+            if lane.sheddable and any(o.waiting for o in self.lanes.values() if o.rank < lane.rank):
+                self.reject(lane, "shed", max(o.deadline for o in self.lanes.values() if o.waiting))
+            if lane.busy < lane.slots and not lane.waiting:
+                lane.busy += 1
+                lane.admitted += 1
+                return
+            if len(lane.waiting) >= lane.queue:
+                self.reject(lane, "queue full", lane.estimate(len(lane.waiting) + 1))
+            if self.endpoints[endpoint] >= ENDPOINT_QUEUE:
+                self.reject(lane, "endpoint queue full", lane.estimate(len(lane.waiting) + 1))
+            wait = lane.estimate(len(lane.waiting) + 1)
+            if wait > lane.deadline:
+                self.reject(lane, "deadline", wait)
+            ticket = object()
+            lane.waiting.append(ticket)
+            self.endpoints[endpoint] += 1
+            end = time.monotonic() + lane.deadline
+            try:
+                while lane.waiting[0] is not ticket or lane.busy >= lane.slots:
+                    left = end - time.monotonic()
+                    if left <= 0:
+                        lane.waiting.remove(ticket)
+                        self.cond.notify_all()
+                        self.reject(lane, "deadline", lane.estimate(len(lane.waiting) + 1))
+                    self.cond.wait(left)
+                lane.waiting.popleft()
+                lane.busy += 1
+                lane.admitted += 1
+                if lane.waiting and lane.busy < lane.slots:
+                    self.cond.notify_all()   # the next in line may have a free slot too
+            finally:
+                self.endpoints[endpoint] -= 1
+                if not self.endpoints[endpoint]:
+                    del self.endpoints[endpoint]
+
+    def reject(self, lane, reason, wait):
+        lane.rejected[reason] += 1
+        raise Rejected(max(1, math.ceil(wait)), reason)
+
+    def leave(self, lane, start):
+        took = time.monotonic() - start
+        with self.lock:
+            lane.busy -= 1
+            lane.service += SERVICE_EWMA * (took - lane.service)
+            self.cond.notify_all()
+
+    def metrics(self):
+        # Prometheus text lines for the /metrics route
+        lines = ["# TYPE task_admission_admitted_total counter"]
+        with self.lock:
+            lanes = [(l.name, l.admitted, dict(l.rejected), l.busy, len(l.waiting), l.service)
+                     for l in self.lanes.values()]
+        lines += [f'task_admission_admitted_total{{lane="{n}"}} {a}' for n, a, _, _, _, _ in lanes]
+        lines.append("# TYPE task_admission_rejected_total counter")
+        for n, _, rej, _, _, _ in lanes:
+            lines += [f'task_admission_rejected_total{{lane="{n}",reason="{r}"}} {c}' for r, c in sorted(rej.items())]
+        lines.append("# TYPE task_admission_in_flight gauge")
+        lines += [f'task_admission_in_flight{{lane="{n}"}} {b}' for n, _, _, b, _, _ in lanes]
+        lines.append("# TYPE task_admission_queued gauge")
+        lines += [f'task_admission_queued{{lane="{n}"}} {w}' for n, _, _, _, w, _ in lanes]
+        lines.append("# TYPE task_admission_service_seconds gauge")
+        lines += [f'task_admission_service_seconds{{lane="{n}"}} {s:.6f}' for n, _, _, _, _, s in lanes]
+        return "\n".join(lines) + "\n"
+
+
+class Release:
+    # response iterable that runs `done` once, when the server closes it
+    def __init__(self, result, done):
+        self.result = result
+        self.done = done
+
+    def __iter__(self):
+        return iter(self.result)
+
+    def close(self):
+        try:
+            if hasattr(self.result, "close"):
+                self.result.close()
+        finally:
+            done, self.done = self.done, None
+            if done:
+                done()
@@ -0,0 +1,167 @@
+import argparse
+import json
+import random
+import sys
+
+import task_engine
+
+# Conformance check for the task_engine.h contract: runs the same seeded random call
+# sequence against two engine builds and compares every result.
+#   python conformance.py ./task_api.so ./task_manager_api.so --seed 1 --ops 3000
+# Ids are engine-specific (the treap interleaves them by shard), so the ids each add
+# returns are paired up and later calls pass every engine its own id for the same task.
+# int results must be equal; JSON results must be equal once "time" values are dropped
+# and ids are translated. notifications is left out: its content is engine-specific.
+# Both engines cut JSON results short at their 32000-byte buffer, not necessarily at
+# the same task; when either result came that close only the tasks both returned are
+# compared, and the call is counted as truncated.
+# Prints one line per entry point plus a total, and the first mismatches; the exit
+# status is 1 if any result differed.
+
+DEFAULT_MIX = ("add=25,edit=8,assign=8,remove=8,delete=4,undo=7,redo=7,"
+               "list=15,search=5,filter=5,manager=3,analytics=2,login=3")
+CRITERIA = ["", "priority", "due", "status", "created", "-priority", "-due", "-status", "-created"]
+STATUSES = ["Pending", "In Progress", "Completed"]
+SHOW_MISMATCHES = 10
+JSON_BUF = 32000
+TRUNCATION_SLACK = 1024       # more than one task's JSON
+
+
+class Side:
+    # one engine under test and its ids for the tasks of the run
+    def __init__(self, path):
+        self.lib, self.ops = task_engine.load_engine(path)
+        self.name = self.ops.name.decode()
+        self.ids = {}            # run task number -> this engine's id
+        self.tasks = {}          # this engine's id -> run task number
+
+    def call(self, op, args):
+        fn = getattr(self.ops, op)
+        enc = [self.ids.get(a.task, -1) if isinstance(a, TaskRef) else
+               a.encode() if isinstance(a, str) else a for a in args]
+        return fn(*enc)
+
+    def normalize(self, text):
+        # JSON result with "time" dropped and ids replaced by run task numbers
+        def fix(v):
+            if isinstance(v, list):
+                return [fix(x) for x in v]
+            if isinstance(v, dict):
+                return {k: (self.tasks.get(x, ("unknown id", x)) if k == "id" else fix(x))
+                        for k, x in v.items() if k != "time"}
+            return v
+        return fix(json.loads(text.decode()))
+
+
+class TaskRef:
+    # a task argument: each engine gets its own id for run task number `task`
+    def __init__(self, task):
+        self.task = task
+
+    def __repr__(self):
+        return f"task#{self.task}"
+
+
+class Run:
+    def __init__(self, args):
+        self.rng = random.Random(args.seed)
+        self.users = [f"cf-user{i}" for i in range(args.users)]
+        self.created = 0
+        mix = [item.split("=") for item in args.mix.split(",") if item]
+        self.actions = [name for name, _ in mix]
+        self.weights = [float(w) for _, w in mix]
+        unknown = set(self.actions) - set(OPS)
+        if unknown:
+            raise SystemExit(f"unknown calls in --mix: {', '.join(sorted(unknown))}")
+
+    def task(self):
+        # mostly tasks of the run; now and then one no engine has
+        if not self.created or self.rng.random() < 0.03:
+            return TaskRef(-1)
+        return TaskRef(self.rng.randrange(self.created))
+
+    def user(self):
+        return self.rng.choice(self.users)
+
+    def fields(self):
+        r = self.rng
+        title = f"task {r.randrange(1000)}{r.choice(['', ' urgent', ' review'])}"
+        due = r.choice(["", f"2026-{r.randint(1, 12):02d}-{r.randint(1, 28):02d}",
+                        f"2026-{r.randint(1, 12):02d}-{r.randint(1, 28):02d} {r.randint(0, 23):02d}:{r.randint(0, 59):02d}"])
+        return title, r.randint(1, 3), due, r.choice(STATUSES)
+
+    def next_call(self):
+        name = self.rng.choices(self.actions, self.weights)[0]
+        return name, OPS[name](self)
+
+
+# call name -> (ops field, argument maker)
+OPS = {
+    "login": lambda r: ("login_user", (r.user(), r.rng.choice(["", "pw"]))),
+    "add": lambda r: ("add_task", (r.user(),) + r.fields()),
+    "edit": lambda r: ("edit_task", (r.user(), r.task()) + tuple(
+        f if r.rng.random() < 0.6 else "" if isinstance(f, str) else f for f in r.fields())),
+    "assign": lambda r: ("assign_task", (r.user(), r.user(), r.task())),
+    "remove": lambda r: ("remove_task", (r.user(), r.task())),
+    "delete": lambda r: ("delete_task", (r.user(), r.task())),
+    "undo": lambda r: ("undo", (r.user(),)),
+    "redo": lambda r: ("redo", (r.user(),)),
+    "list": lambda r: ("list_tasks", (r.user(), r.rng.choice(CRITERIA))),
+    "search": lambda r: ("search_task", (r.user(), r.rng.choice(["task", "urgent", "1", "zz"]))),
+    "filter": lambda r: ("filter_task", (r.user(), r.rng.choice(STATUSES + [""]), r.rng.randint(0, 3))),
+    "manager": lambda r: ("manager_tasks", ()),
+    "analytics": lambda r: ("analytics", (r.user(),)),
+}
+
+
+def main():
+    p = argparse.ArgumentParser(description="Compare two engine builds on a seeded random call sequence")
+    p.add_argument("engines", nargs=2, help="engine libraries (e.g. ./task_api.so ./task_manager_api.so)")
+    p.add_argument("--seed", type=int, default=1, help="random seed (default %(default)s)")
+    p.add_argument("--ops", type=int, default=3000, help="calls to make (default %(default)s)")
+    p.add_argument("--users", type=int, default=8, help="users the calls pick from (default %(default)s)")
+    p.add_argument("--mix", default=DEFAULT_MIX, help="call weights (default %(default)s)")
+    args = p.parse_args()
+
+    a, b = Side(args.engines[0]), Side(args.engines[1])
+    run = Run(args)
+    stats = {}
+    mismatches = 0
+    for index in range(args.ops):
+        name, (op, call_args) = run.next_call()
+        ra, rb = a.call(op, call_args), b.call(op, call_args)
+        s = stats.setdefault(name, [0, 0, 0])
+        s[0] += 1
+        if op == "add_task":
+            if ra > 0 and rb > 0:
+                for side, id_ in ((a, ra), (b, rb)):
+                    side.ids[run.created] = id_
+                    side.tasks[id_] = run.created
+                run.created += 1
+            same = (ra > 0) == (rb > 0)
+        elif isinstance(ra, bytes) or isinstance(rb, bytes):
+            cut = max(len(ra or b""), len(rb or b"")) > JSON_BUF - TRUNCATION_SLACK
+            ra, rb = a.normalize(ra or b"null"), b.normalize(rb or b"null")
+            if cut and isinstance(ra, list) and isinstance(rb, list):
+                s[2] += 1
+                n = min(len(ra), len(rb))
+                ra, rb = ra[:n], rb[:n]
+            same = ra == rb
+        else:
+            same = ra == rb
+        if not same:
+            s[1] += 1
+            mismatches += 1
+            if mismatches <= SHOW_MISMATCHES:
+                print(f"call {index} {name}{call_args}:\n  {a.name}: {str(ra)[:300]}\n  {b.name}: {str(rb)[:300]}",
+                      file=sys.stderr)
+
+    print(f"{'call':<12}{'calls':>8}{'mismatches':>12}{'truncated':>11}   {a.name} vs {b.name}, seed {args.seed}")
+    for name in sorted(stats):
+        print(f"{name:<12}{stats[name][0]:>8}{stats[name][1]:>12}{stats[name][2]:>11}")
+    print(f"{'all':<12}{args.ops:>8}{mismatches:>12}{sum(s[2] for s in stats.values()):>11}")
+    return 1 if mismatches else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,375 @@
+// engine_bench.c
+// Microbenchmarks for the task_engine.h entry points of any engine build.
+// Compile:
+// Linux:   gcc -O2 -std=c11 -rdynamic -o engine_bench engine_bench.c -ldl -lm
+// Windows: gcc -O2 -std=c11 -o engine_bench.exe engine_bench.c -lpsapi
+// Run:
+//   engine_bench ./task_manager_api.so [--tasks N] [--users N] [--dist uniform|zipf] [--seconds S]
+// Without --tasks/--users it sweeps 10^3..10^7 tasks x 10..100k users under both
+// distributions, one child process per configuration: engines keep their state in
+// globals and peak RSS only ever grows, so configurations must not share a process.
+//
+// Every entry point is reported as one NDJSON line:
+//   {"engine":"treap","tasks":1000,"users":10,"dist":"zipf","op":"add","ops":1000,
+//    "ns_per_op":812.4,"allocs_per_op":3.00,"bytes_per_op":412.0,"peak_rss_kb":5120}
+// login and add run once per user/task (they build the data set); every other entry
+// point runs until --seconds (default 0.2) has passed or it has been called once per
+// task. Under "zipf" the user and task picked for each call follow a Zipf(0.99)
+// distribution, so a few hot users hold most of the tasks and take most of the calls.
+// allocs_per_op/bytes_per_op count malloc, calloc and realloc calls made by the engine;
+// they are null on builds without glibc, where the allocator cannot be interposed.
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "task_engine.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <dlfcn.h>
+#include <sys/resource.h>
+#endif
+
+#define ZIPF_S 0.99
+#define DEFAULT_SECONDS 0.2
+
+// ----- Allocation counting -----
+// glibc lets the executable replace malloc for every library it loads (with -rdynamic,
+// so a dlopen'ed engine binds to these); the real allocator stays reachable as __libc_*.
+#if defined(__GLIBC__)
+#define COUNTS_ALLOCS 1
+extern void *__libc_malloc(size_t n);
+extern void *__libc_calloc(size_t count, size_t n);
+extern void *__libc_realloc(void *p, size_t n);
+
+static long long allocCount = 0, allocBytes = 0;
+
+static void count_alloc(size_t n){
+    __atomic_fetch_add(&allocCount, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&allocBytes, (long long)n, __ATOMIC_RELAXED);
+}
+void *malloc(size_t n){ count_alloc(n); return __libc_malloc(n); }
+void *calloc(size_t count, size_t n){ count_alloc(count * n); return __libc_calloc(count, n); }
+void *realloc(void *p, size_t n){ count_alloc(n); return __libc_realloc(p, n); }
+#else
+#define COUNTS_ALLOCS 0
+static long long allocCount = 0, allocBytes = 0;
+#endif
+
+// ----- Platform helpers -----
+static double now_ns(void){
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if(!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+#endif
+}
+
+static long peak_rss_kb(void){
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return -1;
+    return (long)(pmc.PeakWorkingSetSize / 1024);
+#else
+    struct rusage ru;
+    if(getrusage(RUSAGE_SELF, &ru) != 0) return -1;
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024; // bytes on macOS
+#else
+    return ru.ru_maxrss;
+#endif
+#endif
+}
+
+static const TaskEngineOps* load_engine(const char *path){
+    TaskEngineOpsFn fn = NULL;
+#ifdef _WIN32
+    HMODULE lib = LoadLibraryA(path);
+    if(lib) fn = (TaskEngineOpsFn)(void*)GetProcAddress(lib, "task_engine_ops");
+#else
+    void *lib = dlopen(path, RTLD_NOW);
+    if(!lib) fprintf(stderr, "%s\n", dlerror());
+    // POSIX guarantees function pointers round-trip through void*
+    if(lib) *(void**)&fn = dlsym(lib, "task_engine_ops");
+#endif
+    if(!fn) return NULL;
+    const TaskEngineOps *ops = fn();
+    if(!ops || ops->abi != TASK_ENGINE_ABI){
+        fprintf(stderr, "%s: engine ABI %d, expected %d\n", path, ops ? ops->abi : -1, TASK_ENGINE_ABI);
+        return NULL;
+    }
+    return ops;
+}
+
+// ----- Workload -----
+typedef struct {
+    const TaskEngineOps *ops;
+    int tasks, users, zipf;
+    double seconds;
+    char (*names)[16];   // usernames, "user<n>"
+    int *ids;            // ids handed out by add, in order
+    int *owner;          // user index that added ids[i]
+    uint64_t rng;
+} Bench;
+
+static uint64_t next_rand(Bench *b){
+    // xorshift64*
+    b->rng ^= b->rng >> 12;
+    b->rng ^= b->rng << 25;
+    b->rng ^= b->rng >> 27;
+    return b->rng * 2685821657736338717ULL;
+}
+
+// Index in [0, n): uniform, or Zipf by inverting the continuous approximation of the
+// distribution's CDF. Ranks are scattered over the range so the hot keys are not
+// simply the lowest ids.
+static int pick(Bench *b, int n){
+    double u = (next_rand(b) >> 11) * (1.0 / 9007199254740992.0);
+    if(!b->zipf) return (int)(u * n);
+    double rank = pow((pow((double)n, 1.0 - ZIPF_S) - 1.0) * u + 1.0, 1.0 / (1.0 - ZIPF_S));
+    long long r = (long long)rank - 1;
+    if(r < 0) r = 0;
+    if(r >= n) r = n - 1;
+    return (int)((r * 2654435761LL) % n);
+}
+
+typedef struct {
+    const char *op;
+    long long ops;
+    double start, allocs, bytes;
+} Timer;
+
+static void timer_start(Timer *t, const char *op){
+    t->op = op;
+    t->ops = 0;
+    t->allocs = (double)__atomic_load_n(&allocCount, __ATOMIC_RELAXED);
+    t->bytes = (double)__atomic_load_n(&allocBytes, __ATOMIC_RELAXED);
+    t->start = now_ns();
+}
+
+// Budgeted loops check the clock every 64 calls and stop after one call per task
+static int timer_more(const Bench *b, const Timer *t){
+    if(t->ops >= b->tasks) return 0;
+    if(t->ops & 63) return 1;
+    return t->ops == 0 || now_ns() - t->start < b->seconds * 1e9;
+}
+
+static void timer_report(const Bench *b, const Timer *t){
+    double elapsed = now_ns() - t->start;
+    double n = t->ops > 0 ? (double)t->ops : 1.0;
+    printf("{\"engine\":\"%s\",\"tasks\":%d,\"users\":%d,\"dist\":\"%s\",\"op\":\"%s\",\"ops\":%lld,\"ns_per_op\":%.1f,",
+           b->ops->name, b->tasks, b->users, b->zipf ? "zipf" : "uniform", t->op, t->ops, elapsed / n);
+    if(COUNTS_ALLOCS){
+        printf("\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f,",
+               ((double)__atomic_load_n(&allocCount, __ATOMIC_RELAXED) - t->allocs) / n,
+               ((double)__atomic_load_n(&allocBytes, __ATOMIC_RELAXED) - t->bytes) / n);
+    } else {
+        printf("\"allocs_per_op\":null,\"bytes_per_op\":null,");
+    }
+    printf("\"peak_rss_kb\":%ld}\n", peak_rss_kb());
+    fflush(stdout);
+}
+
+static int run_config(Bench *b){
+    const TaskEngineOps *ops = b->ops;
+    Timer t;
+    char title[64], due[16];
+    int i;
+
+    b->names = malloc((size_t)b->users * sizeof(*b->names));
+    b->ids = malloc((size_t)b->tasks * sizeof(int));
+    b->owner = malloc((size_t)b->tasks * sizeof(int));
+    if(!b->names || !b->ids || !b->owner){
+        fprintf(stderr, "out of memory for %d tasks / %d users\n", b->tasks, b->users);
+        return 1;
+    }
+    for(i = 0; i < b->users; i++) snprintf(b->names[i], sizeof(b->names[i]), "user%d", i);
+
+    if(ops->login_user){
+        timer_start(&t, "login");
+        for(i = 0; i < b->users; i++, t.ops++) ops->login_user(b->names[i], "pw");
+        timer_report(b, &t);
+    }
+
+    // add builds the data set, so it always runs to completion
+    timer_start(&t, "add");
+    for(i = 0; i < b->tasks; i++, t.ops++){
+        int u = pick(b, b->users);
+        snprintf(title, sizeof(title), "Task %d", i);
+        snprintf(due, sizeof(due), "2026-%02d-%02d", 1 + i % 12, 1 + i % 28);
+        b->owner[i] = u;
+        b->ids[i] = ops->add_task(b->names[u], title, 1 + i % 3, due, (i & 3) ? "Pending" : "Done");
+    }
+    timer_report(b, &t);
+
+    if(ops->edit_task){
+        timer_start(&t, "edit");
+        while(timer_more(b, &t)){
+            int k = pick(b, b->tasks);
+            ops->edit_task(b->names[b->owner[k]], b->ids[k], "Edited", 1 + (int)(t.ops % 3), "2027-01-01", "In Progress");
+            t.ops++;
+        }
+        timer_report(b, &t);
+    }
+    if(ops->assign_task){
+        timer_start(&t, "assign");
+        while(timer_more(b, &t)){
+            int k = pick(b, b->tasks);
+            ops->assign_task(b->names[b->owner[k]], b->names[pick(b, b->users)], b->ids[k]);
+            t.ops++;
+        }
+        timer_report(b, &t);
+    }
+    if(ops->remove_task){
+        timer_start(&t, "remove");
+        while(timer_more(b, &t)){
+            int k = pick(b, b->tasks);
+            ops->remove_task(b->names[b->owner[k]], b->ids[k]);
+            t.ops++;
+        }
+        timer_report(b, &t);
+    }
+    if(ops->undo){
+        timer_start(&t, "undo");
+        while(timer_more(b, &t)){ ops->undo(b->names[pick(b, b->users)]); t.ops++; }
+        timer_report(b, &t);
+    }
+    if(ops->redo){
+        timer_start(&t, "redo");
+        while(timer_more(b, &t)){ ops->redo(b->names[pick(b, b->users)]); t.ops++; }
+        timer_report(b, &t);
+    }
+    if(ops->list_tasks){
+        static const char *criteria[] = { "priority", "due", "-created" };
+        timer_start(&t, "list");
+        while(timer_more(b, &t)){
+            ops->list_tasks(b->names[pick(b, b->users)], criteria[t.ops % 3]);
+            t.ops++;
+        }
+        timer_report(b, &t);
+    }
+    if(ops->manager_tasks){
+        timer_start(&t, "manager");
+        while(timer_more(b, &t)){ ops->manager_tasks(); t.ops++; }
+        timer_report(b, &t);
+    }
+    if(ops->search_task){
+        timer_start(&t, "search");
+        while(timer_more(b, &t)){
+            snprintf(title, sizeof(title), "Task %d", pick(b, b->tasks));
+            ops->search_task(b->names[pick(b, b->users)], title);
+            t.ops++;
+        }
+        timer_report(b, &t);
+    }
+    if(ops->filter_task){
+        timer_start(&t, "filter");
+        while(timer_more(b, &t)){
+            ops->filter_task(b->names[pick(b, b->users)], (t.ops & 1) ? "Pending" : "Done", 1 + (int)(t.ops % 3));
+            t.ops++;
+        }
+        timer_report(b, &t);
+    }
+    if(ops->notifications){
+        timer_start(&t, "notifications");
+        while(timer_more(b, &t)){ ops->notifications(b->names[pick(b, b->users)]); t.ops++; }
+        timer_report(b, &t);
+    }
+    if(ops->analytics){
+        timer_start(&t, "analytics");
+        while(timer_more(b, &t)){ ops->analytics(b->names[pick(b, b->users)]); t.ops++; }
+        timer_report(b, &t);
+    }
+    // last, since it empties the data set the other entry points read
+    if(ops->delete_task){
+        timer_start(&t, "delete");
+        while(timer_more(b, &t)){
+            ops->delete_task(b->names[b->owner[t.ops]], b->ids[t.ops]);
+            t.ops++;
+        }
+        timer_report(b, &t);
+    }
+
+    free(b->names);
+    free(b->ids);
+    free(b->owner);
+    return 0;
+}
+
+// Runs every configuration of the default matrix in its own process
+static int sweep(const char *self, const char *engine, const char *seconds){
+    static const int taskSizes[] = { 1000, 10000, 100000, 1000000, 10000000 };
+    static const int userSizes[] = { 10, 1000, 100000 };
+    static const char *dists[] = { "uniform", "zipf" };
+    char cmd[1024];
+    int failed = 0;
+    for(size_t d = 0; d < sizeof(dists) / sizeof(dists[0]); d++)
+        for(size_t u = 0; u < sizeof(userSizes) / sizeof(userSizes[0]); u++)
+            for(size_t t = 0; t < sizeof(taskSizes) / sizeof(taskSizes[0]); t++){
+                int n = snprintf(cmd, sizeof(cmd), "\"%s\" \"%s\" --tasks %d --users %d --dist %s",
+                                 self, engine, taskSizes[t], userSizes[u], dists[d]);
+                if(seconds && n > 0 && n < (int)sizeof(cmd))
+                    snprintf(cmd + n, sizeof(cmd) - n, " --seconds %s", seconds);
+                fflush(stdout);
+                if(system(cmd) != 0){
+                    fprintf(stderr, "failed: %s\n", cmd);
+                    failed = 1;
+                }
+            }
+    return failed;
+}
+
+int main(int argc, char **argv){
+    Bench b;
+    const char *engine = NULL, *seconds = NULL;
+    int i;
+
+    memset(&b, 0, sizeof(b));
+    b.rng = 0x9E3779B97F4A7C15ULL;
+    b.seconds = DEFAULT_SECONDS;
+    for(i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--tasks") == 0 && i + 1 < argc) b.tasks = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--users") == 0 && i + 1 < argc) b.users = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--dist") == 0 && i + 1 < argc) b.zipf = strcmp(argv[++i], "zipf") == 0;
+        else if(strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) b.seconds = atof(seconds = argv[++i]);
+        else if(!engine && argv[i][0] != '-') engine = argv[i];
+        else {
+            fprintf(stderr, "unknown argument %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if(!engine){
+        fprintf(stderr, "usage: %s <engine library> [--tasks N] [--users N] [--dist uniform|zipf] [--seconds S]\n", argv[0]);
+        return 2;
+    }
+    if(!b.tasks && !b.users) return sweep(argv[0], engine, seconds);
+    if(b.tasks <= 0) b.tasks = 1000;
+    if(b.users <= 0) b.users = 10;
+
+    b.ops = load_engine(engine);
+    if(!b.ops){
+        fprintf(stderr, "%s: cannot load task_engine_ops\n", engine);
+        return 1;
+    }
+    if(!b.ops->add_task){
+        fprintf(stderr, "%s: engine has no add_task\n", engine);
+        return 1;
+    }
+    return run_config(&b);
+}
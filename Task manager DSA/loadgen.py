@@ -0,0 +1,256 @@
+import argparse
+import asyncio
+import json
+import math
+import random
+import socket
+import sys
+import time
+from urllib.parse import quote, urlsplit
+
+# Open-loop HTTP load generator replaying the traffic static/script.js produces.
+#   python loadgen.py --url http://127.0.0.1:5000 --rate 200 --users 5000 --duration 30
+# Actions arrive as a Poisson process at --rate per second regardless of how fast the
+# server answers, so a slow server builds a queue instead of slowing the load down.
+# Every request's latency is measured from the moment its action was scheduled to start,
+# which keeps time spent waiting for a free connection in the numbers.
+# Each action is one UI interaction for a random simulated user:
+#   add     POST /api/tasks, then loadTasks (GET /api/tasks)
+#   load    GET /api/tasks (loadTasks)
+#   undo    POST /api/undo, then loadTasks and loadNotifications concurrently
+#   redo    POST /api/redo, then loadTasks and loadNotifications concurrently
+#   notify  GET /api/notifications (notification polling)
+# The result is a latency histogram per endpoint plus throughput, printed as a table; --json
+# also writes it to a file (histogram buckets included) so runs can be compared.
+
+DEFAULT_MIX = "add=30,load=30,notify=25,undo=7.5,redo=7.5"
+BUCKET_GROWTH = 1.02          # histogram bucket width: ~2% relative error
+PERCENTILES = (50, 90, 99, 99.9)
+
+
+class Histogram:
+    # log-spaced latency buckets in microseconds
+    def __init__(self):
+        self.buckets = {}
+        self.count = 0
+        self.errors = 0
+        self.max = 0.0
+
+    def record(self, seconds):
+        us = max(seconds * 1e6, 1.0)
+        b = int(math.log(us) / math.log(BUCKET_GROWTH))
+        self.buckets[b] = self.buckets.get(b, 0) + 1
+        self.count += 1
+        self.max = max(self.max, us)
+
+    def merge(self, other):
+        for b, n in other.buckets.items():
+            self.buckets[b] = self.buckets.get(b, 0) + n
+        self.count += other.count
+        self.errors += other.errors
+        self.max = max(self.max, other.max)
+
+    def percentile(self, p):
+        # upper edge of the bucket holding the p-th percentile, in milliseconds
+        if not self.count:
+            return 0.0
+        rank = math.ceil(self.count * p / 100.0)
+        seen = 0
+        for b in sorted(self.buckets):
+            seen += self.buckets[b]
+            if seen >= rank:
+                return min(BUCKET_GROWTH ** (b + 1), self.max) / 1000.0
+        return self.max / 1000.0
+
+    def to_json(self):
+        return {"count": self.count, "errors": self.errors, "max_ms": round(self.max / 1000.0, 3),
+                **{f"p{p:g}_ms": round(self.percentile(p), 3) for p in PERCENTILES},
+                "buckets_us": {str(round(BUCKET_GROWTH ** (b + 1))): n for b, n in sorted(self.buckets.items())}}
+
+
+class Connection:
+    def __init__(self, reader, writer):
+        self.reader = reader
+        self.writer = writer
+
+    async def request(self, method, host, path, body=None):
+        data = b"" if body is None else json.dumps(body).encode()
+        head = f"{method} {path} HTTP/1.1\r\nHost: {host}\r\nConnection: keep-alive\r\nContent-Length: {len(data)}\r\n"
+        if body is not None:
+            head += "Content-Type: application/json\r\n"
+        self.writer.write(head.encode() + b"\r\n" + data)
+        await self.writer.drain()
+
+        status_line = await self.reader.readline()
+        if not status_line:
+            raise ConnectionError("connection closed")
+        status = int(status_line.split()[1])
+        length, chunked, close = None, False, False
+        while True:
+            line = await self.reader.readline()
+            if line in (b"\r\n", b"\n", b""):
+                break
+            name, _, value = line.decode("latin-1").partition(":")
+            name, value = name.strip().lower(), value.strip().lower()
+            if name == "content-length":
+                length = int(value)
+            elif name == "transfer-encoding" and "chunked" in value:
+                chunked = True
+            elif name == "connection" and value == "close":
+                close = True
+        if chunked:
+            while True:
+                size = int((await self.reader.readline()).split(b";")[0], 16)
+                await self.reader.readexactly(size + 2)
+                if size == 0:
+                    break
+        elif length is not None:
+            await self.reader.readexactly(length)
+        else:
+            await self.reader.read()
+            close = True
+        return status, close
+
+    def close(self):
+        self.writer.close()
+
+
+class Pool:
+    # keep-alive connections, at most `size` open; callers queue for a free one
+    def __init__(self, host, port, size):
+        self.host, self.port = host, port
+        self.idle = []
+        self.slots = asyncio.Semaphore(size)
+
+    async def request(self, method, path, body=None):
+        async with self.slots:
+            conn = self.idle.pop() if self.idle else None
+            for attempt in (0, 1):
+                if conn is None:
+                    reader, writer = await asyncio.open_connection(self.host, self.port)
+                    writer.get_extra_info("socket").setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                    conn = Connection(reader, writer)
+                try:
+                    status, close = await conn.request(method, f"{self.host}:{self.port}", path, body)
+                except (ConnectionError, asyncio.IncompleteReadError, IndexError, ValueError):
+                    conn.close()
+                    conn = None
+                    if attempt:
+                        raise
+                    continue  # a kept-alive connection the server already closed: retry once
+                if close:
+                    conn.close()
+                else:
+                    self.idle.append(conn)
+                return status
+
+
+class LoadGen:
+    def __init__(self, args):
+        url = urlsplit(args.url)
+        self.pool = Pool(url.hostname or "127.0.0.1", url.port or 80, args.connections)
+        self.args = args
+        self.users = [f"lg-user{i}" for i in range(args.users)]
+        self.hist = {}
+        self.measure_from = math.inf
+        self.timeout = args.timeout
+        mix = [item.split("=") for item in args.mix.split(",") if item]
+        self.actions = [name for name, _ in mix]
+        self.weights = [float(w) for _, w in mix]
+        unknown = set(self.actions) - {"add", "load", "undo", "redo", "notify"}
+        if unknown:
+            raise SystemExit(f"unknown actions in --mix: {', '.join(sorted(unknown))}")
+
+    async def call(self, scheduled, method, path, body=None):
+        ok = False
+        try:
+            status = await asyncio.wait_for(self.pool.request(method, path, body), self.timeout)
+            ok = status < 400
+        except (OSError, ConnectionError, asyncio.TimeoutError, asyncio.IncompleteReadError):
+            pass
+        if scheduled >= self.measure_from:
+            h = self.hist.setdefault(f"{method} {path.split('?')[0]}", Histogram())
+            h.record(time.monotonic() - scheduled)
+            if not ok:
+                h.errors += 1
+
+    async def action(self, name, user, scheduled):
+        tasks = f"/api/tasks?username={quote(user)}"
+        notes = f"/api/notifications?username={quote(user)}"
+        if name == "add":
+            body = {"username": user, "title": f"load task {random.randrange(1 << 30)}",
+                    "due": f"2026-{random.randint(1, 12):02d}-{random.randint(1, 28):02d}",
+                    "priority": random.randint(1, 3), "status": "Pending"}
+            await self.call(scheduled, "POST", "/api/tasks", body)
+            # the page reloads once the POST answers; follow-up requests are timed from then
+            await self.call(time.monotonic(), "GET", tasks)
+        elif name == "load":
+            await self.call(scheduled, "GET", tasks)
+        elif name == "notify":
+            await self.call(scheduled, "GET", notes)
+        else:
+            await self.call(scheduled, "POST", f"/api/{name}", {"username": user})
+            now = time.monotonic()
+            await asyncio.gather(self.call(now, "GET", tasks), self.call(now, "GET", notes))
+
+    async def run(self):
+        args = self.args
+        pending = set()
+        start = time.monotonic()
+        self.measure_from = start + args.warmup
+        end = self.measure_from + args.duration
+        next_at = start
+        while next_at < end:
+            now = time.monotonic()
+            if next_at > now:
+                await asyncio.sleep(next_at - now)
+            name = random.choices(self.actions, self.weights)[0]
+            task = asyncio.ensure_future(self.action(name, random.choice(self.users), next_at))
+            pending.add(task)
+            task.add_done_callback(pending.discard)
+            next_at += random.expovariate(args.rate)
+        if pending:
+            await asyncio.wait(pending, timeout=self.timeout * 3)
+        return self.report(args.duration)
+
+    def report(self, elapsed):
+        # rates are per measured second; requests still running at the end are not counted
+        total = Histogram()
+        for h in self.hist.values():
+            total.merge(h)
+        rows = sorted(self.hist.items()) + [("all", total)]
+        cols = "".join(f"{'p' + format(p, 'g'):>9}" for p in PERCENTILES)
+        print(f"{'endpoint':<26}{'count':>8}{'errors':>8}{'req/s':>9}{cols}{'max':>9}   (ms)")
+        for name, h in rows:
+            pcts = "".join(f"{h.percentile(p):>9.2f}" for p in PERCENTILES)
+            print(f"{name:<26}{h.count:>8}{h.errors:>8}{h.count / elapsed:>9.1f}{pcts}{h.max / 1000.0:>9.2f}")
+        return {"url": self.args.url, "rate": self.args.rate, "users": self.args.users,
+                "duration": self.args.duration, "mix": self.args.mix,
+                "throughput": round(total.count / elapsed, 2),
+                "endpoints": {name: h.to_json() for name, h in rows}}
+
+
+def main():
+    p = argparse.ArgumentParser(description="Open-loop load generator replaying static/script.js traffic")
+    p.add_argument("--url", default="http://127.0.0.1:5000", help="front end to load (default %(default)s)")
+    p.add_argument("--rate", type=float, default=100.0, help="user actions started per second")
+    p.add_argument("--users", type=int, default=1000, help="simulated users")
+    p.add_argument("--duration", type=float, default=30.0, help="measured seconds")
+    p.add_argument("--warmup", type=float, default=5.0, help="seconds of load before measuring")
+    p.add_argument("--connections", type=int, default=256, help="max open connections")
+    p.add_argument("--timeout", type=float, default=10.0, help="per-request timeout in seconds")
+    p.add_argument("--mix", default=DEFAULT_MIX, help="action weights (default %(default)s)")
+    p.add_argument("--seed", type=int, default=None, help="random seed for a repeatable request sequence")
+    p.add_argument("--json", help="also write the results to this file")
+    args = p.parse_args()
+    random.seed(args.seed)
+    result = asyncio.run(LoadGen(args).run())
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(result, f, indent=1)
+    errors = result["endpoints"]["all"]["errors"]
+    return 1 if errors and errors == result["endpoints"]["all"]["count"] else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
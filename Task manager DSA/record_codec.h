@@ -0,0 +1,92 @@
+// record_codec.h
+// Binary record encoding shared by the treap engine's replication log and its
+// call traces, and by the tools that read them (trace_replay.c).
+// Fields are little-endian: an 'i' argument is an i32, 'q' an i64 and 's' a
+// u16 length (0xFFFF for NULL) followed by the bytes.
+
+#ifndef RECORD_CODEC_H
+#define RECORD_CODEC_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define REC_STR_MAX 0xFFFE
+
+static inline void put_u(unsigned char *p, unsigned long long v, int n){
+    for(int i=0;i<n;i++) p[i] = (unsigned char)(v >> (8*i));
+}
+
+static inline unsigned long long get_u(const unsigned char *p, int n){
+    unsigned long long v = 0;
+    for(int i=n-1;i>=0;i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static inline size_t rec_strlen(const char *s){
+    size_t n = s ? strlen(s) : 0;
+    return n > REC_STR_MAX ? REC_STR_MAX : n;
+}
+
+// write an 's' field; returns the bytes used
+static inline size_t rec_put_str(unsigned char *p, const char *s){
+    size_t n = rec_strlen(s);
+    put_u(p, s ? n : 0xFFFF, 2);
+    memcpy(p + 2, s ? s : "", n);
+    return 2 + n;
+}
+
+// ----- Call traces -----
+// File: TRACE_MAGIC | u32 engine shard count (0 if not sharded) | u32 reserved, then records
+//   u32 size | u64 start (ns since capture began) | u64 duration ns | u8 call
+//   | i32 result | u64 result hash | arguments as traceArgs[call] describes
+// Records are in the order the calls returned. For calls returning JSON the result is
+// its length (-1 for NULL) and the hash is trace_hash of the text; otherwise the result
+// is the returned int and the hash 0. Calls are the task_engine.h entry points, in
+// table order, with TRACE_CONCURRENT set if another call ran at some point meanwhile:
+// the order such calls took effect in is not known, so neither is their result.
+// A TRACE_UNTRACED record (one 's' argument: the export's name, result and hash 0)
+// marks where a mutation outside the table began, e.g. an import or a team change. The
+// trace does not hold what it did, so no result recorded after it can be checked.
+// A login's password is recorded as a stand-in derived from it (see the engine's
+// traced_login_user), so replay sees the same logins accepted and refused.
+#define TRACE_MAGIC "TMTRACE1"
+#define TRACE_FILE_HEADER 16
+#define TRACE_HEADER 33
+#define TRACE_CONCURRENT 0x80
+#define TRACE_UNTRACED 0x7F
+
+enum { TRACE_LOGIN, TRACE_ADD, TRACE_EDIT, TRACE_REMOVE, TRACE_DELETE, TRACE_ASSIGN,
+       TRACE_UNDO, TRACE_REDO, TRACE_LIST, TRACE_NOTIFICATIONS, TRACE_MANAGER_TASKS,
+       TRACE_SEARCH, TRACE_FILTER, TRACE_ANALYTICS, TRACE_CALL_COUNT };
+
+// 'd' is an i32 task id: replay maps ids handed out by add to the ones its engine returns
+static const char *const traceArgs[TRACE_CALL_COUNT] = {
+    "ss", "ssiss", "sdsiss", "sd", "sd", "ssd", "s", "s", "ss", "s", "", "ss", "ssi", "s"
+};
+
+static const char *const traceNames[TRACE_CALL_COUNT] = {
+    "login", "add", "edit", "remove", "delete", "assign", "undo", "redo",
+    "list", "notifications", "manager", "search", "filter", "analytics"
+};
+
+static inline int trace_returns_text(int call){
+    return call >= TRACE_LIST;
+}
+
+// FNV-1a over a JSON result, skipping the values of "time" keys: creation stamps
+// come from the wall clock and differ between a capture and its replay
+static inline uint64_t trace_hash(const char *s){
+    uint64_t h = 14695981039346656037ULL;
+    while(s && *s){
+        if(strncmp(s, "\"time\":\"", 8)==0){
+            s += 8;
+            while(*s && *s != '"') s++;
+            continue;
+        }
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+#endif // RECORD_CODEC_H
@@ -0,0 +1,257 @@
+import ctypes
+import hmac
+import ipaddress
+import os
+import socket
+import struct
+import tempfile
+import threading
+import time
+
+# Log shipping between engine processes.
+# The primary accepts followers on a TCP ("host:port") or Unix ("unix:/path") socket.
+# A follower connects, sends the shared secret TASK_REPL_TOKEN (u16 length | bytes, empty
+# when none is set) and the last lsn it holds (u64), then receives frames of
+#   u32 payload length | u64 primary lsn | payload (whole engine log records)
+# An empty payload is a heartbeat, sent at least every HEARTBEAT seconds, so followers
+# always know how far behind the primary they are. A follower that holds nothing (lsn 0)
+# is first sent a snapshot of the primary, then the log after it. The primary only keeps
+# the log its followers still need plus the newest TASK_REPL_RETAIN_MB; a follower that
+# has fallen behind that gets a LOG_GONE length and must start over from an empty engine.
+# Without a token the primary only listens on loopback addresses and Unix sockets. The
+# token and the log go over the wire unencrypted; run TCP links over a trusted network.
+
+FRAME = struct.Struct("<IQ")
+HEARTBEAT = 0.5
+LOG_GONE = 0xFFFFFFFF
+
+
+def declare(task_api):
+    task_api.replog_lsn_api.argtypes = []
+    task_api.replog_lsn_api.restype = ctypes.c_longlong
+    task_api.replog_wait_api.argtypes = [ctypes.c_longlong, ctypes.c_int]
+    task_api.replog_wait_api.restype = ctypes.c_longlong
+    task_api.replog_read_api.argtypes = [ctypes.c_longlong, ctypes.c_char_p, ctypes.c_int]
+    task_api.replog_read_api.restype = ctypes.c_int
+    task_api.replog_retain_api.argtypes = [ctypes.c_longlong]
+    task_api.replog_retain_api.restype = None
+    task_api.replog_snapshot_api.argtypes = [ctypes.c_char_p]
+    task_api.replog_snapshot_api.restype = ctypes.c_longlong
+    task_api.replication_enable_api.argtypes = [ctypes.c_longlong]
+    task_api.replication_enable_api.restype = ctypes.c_int
+    task_api.replog_apply_api.argtypes = [ctypes.c_char_p, ctypes.c_int]
+    task_api.replog_apply_api.restype = ctypes.c_int
+    task_api.replication_role_api.argtypes = [ctypes.c_int]
+    task_api.replication_role_api.restype = ctypes.c_int
+    task_api.replication_status_api.argtypes = []
+    task_api.replication_status_api.restype = ctypes.c_char_p
+
+
+def _socket_for(addr):
+    if addr.startswith("unix:"):
+        return socket.socket(socket.AF_UNIX, socket.SOCK_STREAM), addr[5:]
+    host, port = addr.rsplit(":", 1)
+    return socket.socket(socket.AF_INET, socket.SOCK_STREAM), (host, int(port))
+
+
+def _token():
+    return os.environ.get("TASK_REPL_TOKEN", "").encode()
+
+
+def _loopback(addr):
+    if addr.startswith("unix:"):
+        return True
+    host = addr.rsplit(":", 1)[0].strip("[]")
+    if host == "localhost":
+        return True
+    try:
+        return ipaddress.ip_address(host).is_loopback
+    except ValueError:
+        return False
+
+
+def _recv_exact(sock, n):
+    data = bytearray()
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            raise ConnectionError("connection closed")
+        data += chunk
+    return bytes(data)
+
+
+def _last_lsn(payload):
+    # walk the record headers (u32 size | u64 lsn | ...) to the final record
+    pos, lsn = 0, 0
+    while pos < len(payload):
+        size, lsn = struct.unpack_from("<IQ", payload, pos)
+        pos += size
+    return lsn
+
+
+def _records(data, limit):
+    # split a run of records into payloads of whole records of about limit bytes
+    start = pos = 0
+    while pos < len(data):
+        size = struct.unpack_from("<I", data, pos)[0]
+        if pos > start and pos + size - start > limit:
+            yield data[start:pos]
+            start = pos
+        pos += size
+    if pos > start:
+        yield data[start:pos]
+
+
+class Primary:
+    def __init__(self, task_api, addr):
+        self.task_api = task_api
+        self.addr = addr
+        self.followers = 0
+        self.keep_bytes = int(float(os.environ.get("TASK_REPL_RETAIN_MB", "64")) * (1 << 20))
+        self.sent = {}                      # follower connection -> last lsn sent to it
+        self.lock = threading.Lock()
+
+    def start(self):
+        self.token = _token()
+        if not self.token and not _loopback(self.addr):
+            raise RuntimeError("set TASK_REPL_TOKEN to accept followers on a non-loopback address")
+        if not self.task_api.replication_enable_api(self.keep_bytes):
+            raise RuntimeError("engine is a follower; cannot serve as a primary")
+        sock, where = _socket_for(self.addr)
+        if sock.family == socket.AF_INET:
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        sock.bind(where)
+        sock.listen()
+        threading.Thread(target=self._accept, args=(sock,), daemon=True).start()
+
+    def _accept(self, sock):
+        while True:
+            conn, _ = sock.accept()
+            threading.Thread(target=self._serve, args=(conn,), daemon=True).start()
+
+    def _retain(self, conn, lsn):
+        # the engine may drop the log up to the oldest lsn any follower has been sent
+        with self.lock:
+            if lsn is None:
+                self.sent.pop(conn, None)
+            else:
+                self.sent[conn] = lsn
+            self.task_api.replog_retain_api(min(self.sent.values(), default=-1))
+
+    def _send_snapshot(self, conn):
+        fd, path = tempfile.mkstemp(prefix="task-snapshot-")
+        os.close(fd)
+        try:
+            with self.lock:
+                lsn = self.task_api.replog_snapshot_api(path.encode())
+                if lsn < 0:
+                    raise ConnectionError("snapshot failed")
+                self.sent[conn] = lsn
+            with open(path, "rb") as f:
+                data = f.read()
+            for payload in _records(data, 1 << 16):
+                conn.sendall(FRAME.pack(len(payload), lsn) + payload)
+            return lsn
+        finally:
+            os.unlink(path)
+
+    def _serve(self, conn):
+        self.followers += 1
+        buf = ctypes.create_string_buffer(1 << 16)
+        try:
+            token = _recv_exact(conn, struct.unpack("<H", _recv_exact(conn, 2))[0])
+            if not hmac.compare_digest(token, self.token):
+                return
+            sent = struct.unpack("<Q", _recv_exact(conn, 8))[0]
+            if sent == 0:
+                sent = self._send_snapshot(conn)
+            self._retain(conn, sent)
+            while True:
+                # the engine call releases the GIL while it waits for new records
+                head = self.task_api.replog_wait_api(sent, int(HEARTBEAT * 1000))
+                n = self.task_api.replog_read_api(sent, buf, len(buf)) if head > sent else 0
+                if n == -1:
+                    conn.sendall(FRAME.pack(LOG_GONE, head))
+                    break
+                if n < 0:
+                    buf = ctypes.create_string_buffer(-n)
+                    continue
+                payload = buf.raw[:n]
+                conn.sendall(FRAME.pack(n, head) + payload)
+                if n:
+                    sent = _last_lsn(payload)
+                    self._retain(conn, sent)
+        except (OSError, ConnectionError):
+            pass
+        finally:
+            self.followers -= 1
+            self._retain(conn, None)
+            conn.close()
+
+    def status(self):
+        return {"followers": self.followers}
+
+
+class Follower:
+    def __init__(self, task_api, addr):
+        self.task_api = task_api
+        self.addr = addr
+        self.connected = False
+        self.primary_lsn = 0
+        self.caught_up_at = time.time()
+        self.error = None
+        self.restoring = False
+
+    def start(self):
+        if not self.task_api.replication_role_api(1):
+            raise RuntimeError("engine already has local writes; cannot become a follower")
+        threading.Thread(target=self._run, daemon=True).start()
+
+    def _run(self):
+        while True:
+            sock, where = _socket_for(self.addr)
+            try:
+                sock.connect(where)
+                token = _token()
+                sock.sendall(struct.pack("<H", len(token)) + token + struct.pack("<Q", self.task_api.replog_lsn_api()))
+                self.connected = True
+                while True:
+                    n, head = FRAME.unpack(_recv_exact(sock, FRAME.size))
+                    if n == LOG_GONE:
+                        self.error = "primary no longer holds our log; restart with an empty engine"
+                        return
+                    payload = _recv_exact(sock, n) if n else b""
+                    if payload and self.task_api.replog_lsn_api() == 0:
+                        self.restoring = True
+                    if payload and self.task_api.replog_apply_api(payload, n) < 0:
+                        # diverged or incompatible build: stop rather than serve wrong data
+                        self.error = "log apply failed"
+                        return
+                    if self.task_api.replog_lsn_api() > 0:
+                        self.restoring = False
+                    self.primary_lsn = max(self.primary_lsn, head)
+                    if self.task_api.replog_lsn_api() >= self.primary_lsn:
+                        self.caught_up_at = time.time()
+            except (OSError, ConnectionError):
+                pass
+            finally:
+                self.connected = False
+                sock.close()
+            if self.restoring:
+                # a half-applied snapshot cannot be resumed
+                self.error = "connection lost during the snapshot; restart with an empty engine"
+                return
+            time.sleep(1)
+
+    def lag(self):
+        # records behind the last lsn the primary reported, and seconds since we last matched it
+        behind = max(0, self.primary_lsn - self.task_api.replog_lsn_api())
+        seconds = time.time() - self.caught_up_at
+        if behind == 0 and self.connected:
+            seconds = 0.0
+        return behind, seconds
+
+    def status(self):
+        behind, seconds = self.lag()
+        return {"primary": self.addr, "connected": self.connected, "primary_lsn": self.primary_lsn,
+                "lag_records": behind, "lag_seconds": round(seconds, 3), "error": self.error}
@@ -1,38 +1,129 @@
+import atexit
 import ctypes
 import os
 import json
-from flask import Flask, request, jsonify, send_from_directory
+import tempfile
+from flask import Flask, Response, request, jsonify, send_from_directory
+import admission
+import replication
+import task_engine
 
 app = Flask(__name__, static_folder="static")
 
-# Load DLL (must be compiled and present)
-dll_path = os.path.join(os.getcwd(), "task_manager_api.dll")
-if not os.path.exists(dll_path):
-    raise FileNotFoundError(f"{dll_path} not found. Compile your DLL first.")
+# Bounded per-lane queues, shedding and 429/Retry-After under overload (admission.py)
+admit = None
+if os.environ.get("TASK_ADMISSION", "1") != "0":
+    admit = admission.Admission(app.wsgi_app)
+    app.wsgi_app = admit
 
-task_api = ctypes.CDLL(dll_path)
+# Load the storage engine (must be compiled and present).
+# TASK_ENGINE picks the build: task_manager_api (default, sharded treaps) or task_api
+# (per-user arrays), or a path to any library exporting task_engine_ops().
+# Core calls go through the engine's ops table (task_engine.h); the extras below
+# are only bound when the engine exports them.
+task_api, engine = task_engine.load_engine(os.environ.get("TASK_ENGINE", "task_manager_api"))
 
-# ----------------------------------------------------------------
-# Tell Python about the functions and argument/return types.
-# These names match the functions in the C file you posted.
-# ----------------------------------------------------------------
-task_api.add_task_api.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_char_p, ctypes.c_char_p]
-task_api.add_task_api.restype  = ctypes.c_int
+def has_api(name):
+    return hasattr(task_api, name)
 
-task_api.remove_task_api.argtypes = [ctypes.c_char_p, ctypes.c_int]
-task_api.remove_task_api.restype  = ctypes.c_int
+if has_api("task_assignees_api"):
+    task_api.task_assignees_api.argtypes = [ctypes.c_int]
+    task_api.task_assignees_api.restype  = ctypes.c_char_p
 
-task_api.undo_api.argtypes = [ctypes.c_char_p]
-task_api.undo_api.restype  = ctypes.c_int
+if has_api("query_tasks_api"):
+    task_api.query_tasks_api.argtypes = [ctypes.c_char_p]
+    task_api.query_tasks_api.restype  = ctypes.c_char_p
+    task_api.query_count_api.argtypes = [ctypes.c_char_p]
+    task_api.query_count_api.restype  = ctypes.c_int
 
-task_api.redo_api.argtypes = [ctypes.c_char_p]
-task_api.redo_api.restype  = ctypes.c_int
+if has_api("import_tasks_api"):
+    task_api.import_tasks_api.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+    task_api.import_tasks_api.restype  = ctypes.c_char_p
+    task_api.export_tasks_api.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_longlong), ctypes.c_char_p, ctypes.c_int]
+    task_api.export_tasks_api.restype  = ctypes.c_int
 
-task_api.list_tasks_api.argtypes = [ctypes.c_char_p]
-task_api.list_tasks_api.restype  = ctypes.c_char_p
+if has_api("auto_assign_api"):
+    task_api.team_join_api.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+    task_api.team_join_api.restype  = ctypes.c_int
+    task_api.team_leave_api.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+    task_api.team_leave_api.restype  = ctypes.c_int
+    task_api.team_members_api.argtypes = [ctypes.c_char_p]
+    task_api.team_members_api.restype  = ctypes.c_char_p
+    task_api.auto_assign_api.argtypes = [ctypes.c_int, ctypes.c_char_p]
+    task_api.auto_assign_api.restype  = ctypes.c_char_p
+    task_api.auto_assign_all_api.argtypes = [ctypes.c_char_p, ctypes.c_int]
+    task_api.auto_assign_all_api.restype  = ctypes.c_int
 
-task_api.notifications_api.argtypes = [ctypes.c_char_p]
-task_api.notifications_api.restype  = ctypes.c_char_p
+if has_api("add_dependency_api"):
+    task_api.add_dependency_api.argtypes = [ctypes.c_int, ctypes.c_int]
+    task_api.add_dependency_api.restype  = ctypes.c_int
+    task_api.remove_dependency_api.argtypes = [ctypes.c_int, ctypes.c_int]
+    task_api.remove_dependency_api.restype  = ctypes.c_int
+    task_api.task_dependencies_api.argtypes = [ctypes.c_int]
+    task_api.task_dependencies_api.restype  = ctypes.c_char_p
+    task_api.topo_order_api.argtypes = [ctypes.c_int]
+    task_api.topo_order_api.restype  = ctypes.c_char_p
+    task_api.critical_path_api.argtypes = [ctypes.c_int]
+    task_api.critical_path_api.restype  = ctypes.c_char_p
+
+if has_api("metrics_api"):
+    task_api.metrics_api.argtypes = []
+    task_api.metrics_api.restype  = ctypes.c_char_p
+
+if has_api("scheduler_start_api"):
+    task_api.scheduler_start_api.argtypes = [ctypes.c_int, ctypes.c_int]
+    task_api.scheduler_start_api.restype  = ctypes.c_int
+
+# TASK_TRACE=<path> records every engine call made by this server to a binary trace;
+# trace_replay runs it against any engine build (see README)
+if has_api("trace_start_api"):
+    task_api.trace_start_api.argtypes = [ctypes.c_char_p]
+    task_api.trace_start_api.restype  = ctypes.c_int
+    task_api.trace_stop_api.argtypes = []
+    task_api.trace_stop_api.restype  = ctypes.c_int
+if os.environ.get("TASK_TRACE"):
+    if not has_api("trace_start_api"):
+        raise RuntimeError(f"engine '{engine.name.decode()}' does not support call tracing")
+    if not task_api.trace_start_api(os.environ["TASK_TRACE"].encode('utf-8')):
+        raise RuntimeError(f"cannot write trace to {os.environ['TASK_TRACE']}")
+    atexit.register(task_api.trace_stop_api)
+
+# Replication: TASK_REPL_LISTEN=host:port (or unix:/path) makes this server a primary that
+# streams its mutation log to followers; TASK_REPL_PRIMARY=<same address> makes it a
+# read-only follower. TASK_REPL_MAX_LAG (seconds) makes a follower answer 503 while it is
+# further behind than that.
+replica = None
+if (os.environ.get("TASK_REPL_PRIMARY") or os.environ.get("TASK_REPL_LISTEN")) and not has_api("replog_apply_api"):
+    raise RuntimeError(f"engine '{engine.name.decode()}' does not support replication")
+if has_api("replog_apply_api"):
+    replication.declare(task_api)
+if os.environ.get("TASK_REPL_PRIMARY"):
+    replica = replication.Follower(task_api, os.environ["TASK_REPL_PRIMARY"])
+    replica.start()
+elif os.environ.get("TASK_REPL_LISTEN"):
+    replica = replication.Primary(task_api, os.environ["TASK_REPL_LISTEN"])
+    replica.start()
+max_lag = float(os.environ.get("TASK_REPL_MAX_LAG", "0"))
+is_follower = isinstance(replica, replication.Follower)
+
+# Due-date scheduler runs on its own thread inside the engine (followers replay the primary's events).
+# TASK_REMIND_SECONDS: lead time for "due soon" events; TASK_FLIP_OVERDUE=1 marks passed deadlines "Overdue".
+if not is_follower and has_api("scheduler_start_api"):
+    task_api.scheduler_start_api(int(os.environ.get("TASK_REMIND_SECONDS", 24*60*60)),
+                                 int(os.environ.get("TASK_FLIP_OVERDUE", "0")))
+
+# Followers are read-only and may refuse reads while too far behind the primary
+@app.before_request
+def replica_guard():
+    if not is_follower or not request.path.startswith("/api/") or request.path == "/api/replication":
+        return None
+    if request.method != "GET":
+        return jsonify({"error":"read-only replica, send writes to the primary"}), 403
+    if max_lag > 0 and replica.lag()[1] > max_lag:
+        resp = jsonify({"error":"replica is behind the primary"})
+        resp.headers["Retry-After"] = "1"
+        return resp, 503
+    return None
 
 # ---------- Routes ----------
 @app.route("/")
@@ -41,10 +132,12 @@ def index():
     return app.send_static_file("index.html")
 
 # Get tasks for a username (returns JSON array)
+# optional ?sort=priority|due|status|created (prefix "-" for descending), served from the engine's sorted views
 @app.route("/api/tasks", methods=["GET"])
 def get_tasks():
     username = request.args.get("username", "")
-    buf = task_api.list_tasks_api(username.encode('utf-8'))
+    sort = request.args.get("sort", "")
+    buf = engine.list_tasks(username.encode('utf-8'), sort.encode('utf-8'))
     if not buf:
         return jsonify([])
     # list_tasks_api returns a C string (JSON array) -> decode and parse
@@ -67,7 +160,7 @@ def add_task():
     if not username or not title:
         return jsonify({"error":"username and title required"}), 400
 
-    res = task_api.add_task_api(
+    res = engine.add_task(
         username.encode('utf-8'),
         title.encode('utf-8'),
         priority,
@@ -86,9 +179,223 @@ def delete_task():
     task_id = int(data.get("id", 0))
     if not username or task_id <= 0:
         return jsonify({"error":"username and id required"}), 400
-    ok = task_api.remove_task_api(username.encode('utf-8'), task_id)
+    ok = engine.remove_task(username.encode('utf-8'), task_id)
     return jsonify({"success": bool(ok)})
 
+# Permanently delete a task (all assignees lose it): DELETE /api/tasks/<id>?username=...
+@app.route("/api/tasks/<int:task_id>", methods=["DELETE"])
+def purge_task(task_id):
+    username = request.args.get("username","").strip()
+    if task_id <= 0:
+        return jsonify({"error":"valid id required"}), 400
+    ok = engine.delete_task(username.encode('utf-8'), task_id)
+    return jsonify({"success": bool(ok)})
+
+# Users currently holding a task (returns array of usernames)
+@app.route("/api/tasks/<int:task_id>/assignees", methods=["GET"])
+def task_assignees(task_id):
+    if not has_api("task_assignees_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    buf = task_api.task_assignees_api(task_id)
+    if not buf:
+        return jsonify([])
+    return jsonify(json.loads(buf.decode('utf-8')))
+
+# Dependencies: what a task waits on and what waits on it
+@app.route("/api/tasks/<int:task_id>/dependencies", methods=["GET"])
+def task_dependencies(task_id):
+    if not has_api("add_dependency_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    res = json.loads(task_api.task_dependencies_api(task_id).decode('utf-8'))
+    return jsonify(res), 400 if "error" in res else 200
+
+# Make a task wait on another: JSON { blocker }. 409 if that would close a cycle
+@app.route("/api/tasks/<int:task_id>/dependencies", methods=["POST"])
+def add_dependency(task_id):
+    if not has_api("add_dependency_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    data = request.get_json(force=True)
+    blocker = int(data.get("blocker", 0))
+    if blocker <= 0:
+        return jsonify({"error":"blocker id required"}), 400
+    res = task_api.add_dependency_api(task_id, blocker)
+    if res < 0:
+        return jsonify({"error":"dependency would create a cycle"}), 409
+    return jsonify({"success": bool(res)})
+
+@app.route("/api/tasks/<int:task_id>/dependencies/<int:blocker>", methods=["DELETE"])
+def remove_dependency(task_id, blocker):
+    if not has_api("add_dependency_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    return jsonify({"success": bool(task_api.remove_dependency_api(task_id, blocker))})
+
+# Open tasks in dependency order: everything ?id= waits on (then id itself), or the whole graph
+@app.route("/api/dependencies/order", methods=["GET"])
+def dependency_order():
+    if not has_api("add_dependency_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    res = json.loads(task_api.topo_order_api(request.args.get("id", 0, type=int)).decode('utf-8'))
+    return jsonify(res), 400 if isinstance(res, dict) else 200
+
+# Longest chain of open tasks ending at ?id= (or anywhere): {length, path}
+@app.route("/api/dependencies/critical_path", methods=["GET"])
+def critical_path():
+    if not has_api("add_dependency_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    res = json.loads(task_api.critical_path_api(request.args.get("id", 0, type=int)).decode('utf-8'))
+    return jsonify(res), 400 if "error" in res else 200
+
+# Teams: members are picked from by auto-assignment, least loaded first (open tasks
+# weighted by priority). Join with JSON { username }
+@app.route("/api/teams/<team>/members", methods=["POST"])
+def team_join(team):
+    if not has_api("auto_assign_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    data = request.get_json(force=True)
+    username = data.get("username","").strip()
+    if not username:
+        return jsonify({"error":"username required"}), 400
+    ok = task_api.team_join_api(team.encode('utf-8'), username.encode('utf-8'))
+    return jsonify({"success": bool(ok)})
+
+@app.route("/api/teams/<team>/members/<username>", methods=["DELETE"])
+def team_leave(team, username):
+    if not has_api("auto_assign_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    ok = task_api.team_leave_api(team.encode('utf-8'), username.encode('utf-8'))
+    return jsonify({"success": bool(ok)})
+
+# Team members with their current load, least loaded first
+@app.route("/api/teams/<team>", methods=["GET"])
+def team_members(team):
+    if not has_api("auto_assign_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    return jsonify(json.loads(task_api.team_members_api(team.encode('utf-8')).decode('utf-8')))
+
+# Assign a task to the least-loaded team member not holding it yet: JSON { team }
+@app.route("/api/tasks/<int:task_id>/auto_assign", methods=["POST"])
+def auto_assign(task_id):
+    if not has_api("auto_assign_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    data = request.get_json(force=True)
+    team = data.get("team","").strip()
+    if not team:
+        return jsonify({"error":"team required"}), 400
+    res = json.loads(task_api.auto_assign_api(task_id, team.encode('utf-8')).decode('utf-8'))
+    return jsonify(res), 400 if "error" in res else 200
+
+# Spread every open, unassigned task over the team (?limit=N caps how many)
+@app.route("/api/teams/<team>/auto_assign", methods=["POST"])
+def auto_assign_all(team):
+    if not has_api("auto_assign_all_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    limit = request.args.get("limit", 0, type=int)
+    n = task_api.auto_assign_all_api(team.encode('utf-8'), limit)
+    if n < 0:
+        return jsonify({"error":"unknown team"}), 400
+    return jsonify({"assigned": n})
+
+# Set-algebra query across users, e.g. ?q=user:alice %26 user:bob  or  ?q=unassigned %26 status:Pending  or  ?q=team:ops - status:Completed
+# (ready / blocked select tasks by whether their dependencies are Completed)
+@app.route("/api/query", methods=["GET"])
+def query_tasks():
+    if not has_api("query_tasks_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    expr = request.args.get("q","").encode('utf-8')
+    count = task_api.query_count_api(expr)
+    if count < 0:
+        return jsonify({"error":"invalid query"}), 400
+    tasks = json.loads(task_api.query_tasks_api(expr).decode('utf-8'))
+    return jsonify({"count": count, "tasks": tasks})
+
+# Manager view: every task, in creation order
+@app.route("/api/manager/tasks", methods=["GET"])
+def manager_tasks():
+    return jsonify(json.loads(engine.manager_tasks().decode('utf-8')))
+
+# Search a user's tasks by title substring: ?username=...&q=...
+@app.route("/api/search", methods=["GET"])
+def search_tasks():
+    username = request.args.get("username","").strip()
+    q = request.args.get("q","")
+    return jsonify(json.loads(engine.search_task(username.encode('utf-8'), q.encode('utf-8')).decode('utf-8')))
+
+# Engine statistics
+@app.route("/api/analytics", methods=["GET"])
+def analytics():
+    username = request.args.get("username","").strip()
+    return jsonify(json.loads(engine.analytics(username.encode('utf-8')).decode('utf-8')))
+
+# Bulk import: the request body is an NDJSON or CSV file (?format=ndjson|csv, default ndjson).
+# It is spooled to a temporary file first, then loaded by the engine in one call.
+@app.route("/api/import", methods=["POST"])
+def import_tasks():
+    if not has_api("import_tasks_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    fmt = request.args.get("format", "ndjson")
+    if fmt not in ("ndjson", "csv"):
+        return jsonify({"error":"format must be ndjson or csv"}), 400
+    fd, path = tempfile.mkstemp(suffix="." + fmt)
+    try:
+        with os.fdopen(fd, "wb") as f:
+            while True:
+                chunk = request.stream.read(1 << 20)
+                if not chunk:
+                    break
+                f.write(chunk)
+        res = json.loads(task_api.import_tasks_api(path.encode('utf-8'), fmt.encode('utf-8')).decode('utf-8'))
+    finally:
+        os.unlink(path)
+    return jsonify(res), 400 if "error" in res else 200
+
+# Bulk export, streamed: ?format=ndjson|csv. Each chunk is pulled from the engine only when
+# the previous one has been sent, so a slow client holds back the export instead of buffering it.
+EXPORT_CHUNK = 256 * 1024
+
+@app.route("/api/export", methods=["GET"])
+def export_tasks():
+    if not has_api("export_tasks_api"):
+        return jsonify({"error":"not supported by this engine"}), 501
+    fmt = request.args.get("format", "ndjson")
+    if fmt not in ("ndjson", "csv"):
+        return jsonify({"error":"format must be ndjson or csv"}), 400
+
+    def chunks():
+        cursor = ctypes.c_longlong(0)
+        buf = ctypes.create_string_buffer(EXPORT_CHUNK)
+        while cursor.value != -1:
+            n = task_api.export_tasks_api(fmt.encode('utf-8'), ctypes.byref(cursor), buf, len(buf))
+            if n < 0:
+                buf = ctypes.create_string_buffer(-n)
+                continue
+            if n:
+                yield buf.raw[:n]
+
+    mimetype = "text/csv" if fmt == "csv" else "application/x-ndjson"
+    return Response(chunks(), mimetype=mimetype,
+                    headers={"Content-Disposition": f"attachment; filename=tasks.{fmt}"})
+
+# Replication role, log position and (on followers) lag behind the primary
+@app.route("/api/replication", methods=["GET"])
+def replication_status():
+    if not has_api("replication_status_api"):
+        return jsonify({"role":"none","engine":engine.name.decode()})
+    st = json.loads(task_api.replication_status_api().decode('utf-8'))
+    if replica:
+        st.update(replica.status())
+    return jsonify(st)
+
+# Prometheus scrape target: engine call counts, latency histograms, dropped/overflowed/truncated
+# counters and bytes per structure, plus admission counters, as text exposition format
+@app.route("/metrics", methods=["GET"])
+def metrics():
+    if not has_api("metrics_api") and not admit:
+        return jsonify({"error":"not supported by this engine"}), 501
+    text = task_api.metrics_api().decode('utf-8') if has_api("metrics_api") else ""
+    if admit:
+        text += admit.metrics()
+    return Response(text, mimetype="text/plain; version=0.0.4")
+
 # Undo for a username. JSON { username }
 @app.route("/api/undo", methods=["POST"])
 def undo():
@@ -96,7 +403,7 @@ def undo():
     username = data.get("username","").strip()
     if not username:
         return jsonify({"error":"username required"}), 400
-    ok = task_api.undo_api(username.encode('utf-8'))
+    ok = engine.undo(username.encode('utf-8'))
     return jsonify({"success": bool(ok)})
 
 # Redo for a username. JSON { username }
@@ -106,14 +413,14 @@ def redo():
     username = data.get("username","").strip()
     if not username:
         return jsonify({"error":"username required"}), 400
-    ok = task_api.redo_api(username.encode('utf-8'))
+    ok = engine.redo(username.encode('utf-8'))
     return jsonify({"success": bool(ok)})
 
 # Notifications for a username (returns array)
 @app.route("/api/notifications", methods=["GET"])
 def notifications():
     username = request.args.get("username","").strip()
-    buf = task_api.notifications_api(username.encode('utf-8'))
+    buf = engine.notifications(username.encode('utf-8'))
     if not buf:
         return jsonify([])
     try:
@@ -129,5 +436,8 @@ def notifications():
 
 if __name__ == "__main__":
     # helpful reminder to the user
-    print("Starting server on http://127.0.0.1:5000/ - serving static files from ./static")
-    app.run(debug=True)
+    # TASK_PORT lets a primary and its followers run side by side on one machine
+    port = int(os.environ.get("TASK_PORT", "5000"))
+    print(f"Starting server on http://127.0.0.1:{port}/ - serving static files from ./static")
+    # the reloader would start a second process with its own engine and replication threads
+    app.run(debug=True, port=port, use_reloader=replica is None)
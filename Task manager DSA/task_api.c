@@ -3,43 +3,87 @@
 #include <string.h>
 #include <time.h>
 
+#include "task_engine.h"
+
+// "array" engine: every user keeps copies of their tasks in a growable list.
+// Assigning copies the task to the other user; edit and delete update every copy.
+// A task nobody holds any more waits in the unheld pool until it is assigned,
+// restored by undo/redo or deleted.
+// The engine is not concurrent: every exported call holds engineLock, and JSON
+// results go to per-thread buffers so a caller can read its result after the
+// lock is released.
+
 #ifdef _WIN32
-#define EXPORT __declspec(dllexport)
-#define STDCALL __stdcall
+#include <windows.h>
+static SRWLOCK engineLock = SRWLOCK_INIT;
+static void engine_lock(void){ AcquireSRWLockExclusive(&engineLock); }
+static void engine_unlock(void){ ReleaseSRWLockExclusive(&engineLock); }
 #else
-#define EXPORT
-#define STDCALL
+#include <pthread.h>
+static pthread_mutex_t engineLock = PTHREAD_MUTEX_INITIALIZER;
+static void engine_lock(void){ pthread_mutex_lock(&engineLock); }
+static void engine_unlock(void){ pthread_mutex_unlock(&engineLock); }
 #endif
 
-#define MAX_TASKS 100
-#define MAX_USERS 10
-#define MAX_HISTORY 50
+#define THREAD_LOCAL _Thread_local
+
+#define MAX_HISTORY 128
+#define JSON_BUF 32000
+#define MIN_SLOTS 16
 
 typedef struct {
-    int id;
-    char title[100];
+    int id;              // 0 marks a removed slot
+    char title[128];
     int priority;
     char dueDate[20];
-    char status[20];
-    char timestamp[30];
+    char status[32];
+    char timestamp[32];
 } Task;
 
+// Tasks in the order they were handed to their holder. Removing a task only
+// tombstones its slot, so nothing shifts; the slots are compacted once
+// tombstones outnumber live tasks. index maps task id -> slot + 1 (open
+// addressing, linear probing); entries left behind by removals stay until
+// the next rebuild and never match because their slot's id is 0.
+typedef struct {
+    Task *slots;
+    int used, cap, live;
+    int *index;
+    int indexCap;        // power of two, kept above twice used
+} TaskList;
+
 typedef struct {
     char username[50];
-    Task tasks[MAX_TASKS];
-    int taskCount;
+    char password[64];
+    TaskList tasks;
 
-    // Undo/Redo stacks
-    Task undoStack[MAX_HISTORY];
-    int undoCount;
-    Task redoStack[MAX_HISTORY];
-    int redoCount;
+    // Undo/Redo history: ids whose holding by this user was toggled; the
+    // task body is always read back from its current copy
+    int *undoStack;
+    int undoCount, undoCap;
+    int *redoStack;
+    int redoCount, redoCap;
 
 } User;
 
-static User users[MAX_USERS];
-static int userCount = 0;
+static User **users = NULL;
+static int userCount = 0, userCap = 0;
+static int *userIndex = NULL;   // username hash -> users[] position + 1
+static int userIndexCap = 0;
 static int nextTaskID = 1;
+static int liveTasks = 0;
+static TaskList unheld;         // live tasks no user currently holds
+
+// Who holds a copy of each task, indexed by id (ids are handed out in order and
+// never reused). A task with no holders sits in the unheld pool, or is deleted
+// when the pool has no copy either.
+typedef struct {
+    User **holders;      // in no particular order
+    int count, cap;
+} TaskRef;
+
+static TaskRef *refs = NULL;
+static int refCap = 0;
 
 // Utility to get current time as string
 void currentTime(char* buffer, int size) {
@@ -50,121 +94,662 @@ void currentTime(char* buffer, int size) {
             tm.tm_hour, tm.tm_min, tm.tm_sec);
 }
 
+// "YYYY-MM-DD" (end of that day) or "YYYY-MM-DD HH:MM[:SS]"; 0 if none
+static time_t parseDue(const char *s){
+    int y, mo, d, h = 23, mi = 59, sec = 59;
+    if(!s || sscanf(s, "%d-%d-%d", &y, &mo, &d) != 3) return 0;
+    if(strlen(s) > 11 && (s[10] == ' ' || s[10] == 'T')){
+        sec = 0;
+        if(sscanf(s + 11, "%d:%d:%d", &h, &mi, &sec) < 2) return 0;
+    }
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = y - 1900;
+    tm.tm_mon = mo - 1;
+    tm.tm_mday = d;
+    tm.tm_hour = h;
+    tm.tm_min = mi;
+    tm.tm_sec = sec;
+    tm.tm_isdst = -1;
+    time_t t = mktime(&tm);
+    return t == (time_t)-1 ? 0 : t;
+}
+
+static void copyField(char *dst, const char *src, int size){
+    strncpy(dst, src ? src : "", size-1);
+    dst[size-1] = 0;
+}
+
+static unsigned hashId(int id) {
+    return (unsigned)id * 2654435761u;
+}
+
+static unsigned hashName(const char *s) {
+    unsigned h = 2166136261u;
+    while(*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+// ---------- Task lists ----------
+static int listRehash(TaskList *l, int cap) {
+    int *ix = (int*)calloc(cap, sizeof(int));
+    if(!ix) return 0;
+    for(int i=0;i<l->used;i++){
+        if(!l->slots[i].id) continue;
+        unsigned h = hashId(l->slots[i].id) & (cap-1);
+        while(ix[h]) h = (h+1) & (cap-1);
+        ix[h] = i+1;
+    }
+    free(l->index);
+    l->index = ix;
+    l->indexCap = cap;
+    return 1;
+}
+
+// squeeze out tombstones, keeping order
+static void listCompact(TaskList *l) {
+    int n = 0;
+    for(int i=0;i<l->used;i++)
+        if(l->slots[i].id) l->slots[n++] = l->slots[i];
+    l->used = n;
+    listRehash(l, l->indexCap);
+}
+
+static int listFind(const TaskList *l, int id) {
+    if(!l->indexCap) return -1;
+    unsigned h = hashId(id) & (l->indexCap-1);
+    for(int e; (e = l->index[h]); h = (h+1) & (l->indexCap-1))
+        if(l->slots[e-1].id == id) return e-1;
+    return -1;
+}
+
+static int listAppend(TaskList *l, const Task *t) {
+    if(l->used == l->cap){
+        if(l->used - l->live > l->live) listCompact(l);
+        else {
+            int nc = l->cap ? l->cap * 2 : MIN_SLOTS;
+            Task *g = (Task*)realloc(l->slots, nc * sizeof(Task));
+            if(!g) return 0;
+            l->slots = g;
+            l->cap = nc;
+        }
+    }
+    if((l->used+1) * 2 > l->indexCap && !listRehash(l, l->indexCap ? l->indexCap * 2 : MIN_SLOTS * 2))
+        return 0;
+    int i = l->used++;
+    l->slots[i] = *t;
+    l->live++;
+    unsigned h = hashId(t->id) & (l->indexCap-1);
+    while(l->index[h]) h = (h+1) & (l->indexCap-1);
+    l->index[h] = i+1;
+    return 1;
+}
+
+static void listRemove(TaskList *l, int i) {
+    l->slots[i].id = 0;
+    l->live--;
+    if(l->used >= MIN_SLOTS && l->used - l->live > l->live) listCompact(l);
+}
+
+// ---------- Users ----------
+// Find user (reads never create one)
+static User* findUser(const char* username) {
+    if(!username || !userIndexCap) return NULL;
+    unsigned h = hashName(username) & (userIndexCap-1);
+    for(int e; (e = userIndex[h]); h = (h+1) & (userIndexCap-1))
+        if(strcmp(users[e-1]->username, username)==0)
+            return users[e-1];
+    return NULL;
+}
+
+static int indexUser(int k) {
+    if((userCount+1) * 2 > userIndexCap){
+        int nc = userIndexCap ? userIndexCap * 2 : 16;
+        int *ix = (int*)calloc(nc, sizeof(int));
+        if(!ix) return 0;
+        for(int j=0;j<k;j++){
+            unsigned h = hashName(users[j]->username) & (nc-1);
+            while(ix[h]) h = (h+1) & (nc-1);
+            ix[h] = j+1;
+        }
+        free(userIndex);
+        userIndex = ix;
+        userIndexCap = nc;
+    }
+    unsigned h = hashName(users[k]->username) & (userIndexCap-1);
+    while(userIndex[h]) h = (h+1) & (userIndexCap-1);
+    userIndex[h] = k+1;
+    return 1;
+}
+
 // Get or create user
 User* getUser(const char* username) {
-    for(int i=0;i<userCount;i++)
-        if(strcmp(users[i].username, username)==0)
-            return &users[i];
+    User *u = findUser(username);
+    if(u || !username) return u;
+
+    if(userCount == userCap){
+        int nc = userCap ? userCap * 2 : 8;
+        User **g = (User**)realloc(users, nc * sizeof(User*));
+        if(!g) return NULL;
+        users = g;
+        userCap = nc;
+    }
+    u = (User*)calloc(1, sizeof(User));
+    if(!u) return NULL;
+    copyField(u->username, username, sizeof(u->username));
+    users[userCount] = u;
+    if(!indexUser(userCount)){
+        free(u);
+        return NULL;
+    }
+    userCount++;
+    return u;
+}
 
-    if(userCount>=MAX_USERS) return NULL;
-    strcpy(users[userCount].username, username);
-    users[userCount].taskCount = 0;
-    users[userCount].undoCount = 0;
-    users[userCount].redoCount = 0;
-    return &users[userCount++];
+// ---------- Holders ----------
+static TaskRef* findRef(int id) {
+    return id > 0 && id < refCap ? &refs[id] : NULL;
+}
+
+// make room for id before it is handed out
+static int reserveRef(int id) {
+    if(id < refCap) return 1;
+    int nc = refCap ? refCap : 64;
+    while(nc <= id) nc *= 2;
+    TaskRef *g = (TaskRef*)realloc(refs, nc * sizeof(TaskRef));
+    if(!g) return 0;
+    memset(g + refCap, 0, (nc - refCap) * sizeof(TaskRef));
+    refs = g;
+    refCap = nc;
+    return 1;
+}
+
+static int addHolder(TaskRef *r, User *u) {
+    if(r->count == r->cap){
+        int nc = r->cap ? r->cap * 2 : 2;
+        User **g = (User**)realloc(r->holders, nc * sizeof(User*));
+        if(!g) return 0;
+        r->holders = g;
+        r->cap = nc;
+    }
+    r->holders[r->count++] = u;
+    return 1;
+}
+
+static void dropHolder(TaskRef *r, User *u) {
+    for(int k=0;k<r->count;k++)
+        if(r->holders[k] == u){
+            r->holders[k] = r->holders[--r->count];
+            return;
+        }
+}
+
+// the current copy of a live task, NULL once deleted
+static Task* findCopy(int id) {
+    TaskRef *r = findRef(id);
+    if(!r) return NULL;
+    if(r->count){
+        TaskList *l = &r->holders[0]->tasks;
+        return &l->slots[listFind(l, id)];
+    }
+    int i = listFind(&unheld, id);
+    return i >= 0 ? &unheld.slots[i] : NULL;
+}
+
+// drop u's copy; the last copy of a task moves to the unheld pool
+static void releaseTask(User *u, int i) {
+    Task t = u->tasks.slots[i];
+    TaskRef *r = findRef(t.id);
+    listRemove(&u->tasks, i);
+    dropHolder(r, u);
+    if(!r->count) listAppend(&unheld, &t);
+}
+
+// give u a copy of a live task, taking it out of the unheld pool
+static int holdTask(User *u, const Task *t) {
+    TaskRef *r = findRef(t->id);
+    if(!listAppend(&u->tasks, t)) return 0;
+    if(!addHolder(r, u)){
+        listRemove(&u->tasks, listFind(&u->tasks, t->id));
+        return 0;
+    }
+    if(r->count == 1){
+        int i = listFind(&unheld, t->id);
+        if(i >= 0) listRemove(&unheld, i);
+    }
+    return 1;
+}
+
+// history grows with use up to MAX_HISTORY entries
+static void pushId(int **stack, int *count, int *cap, int id) {
+    if(*count >= MAX_HISTORY) return;
+    if(*count == *cap){
+        int nc = *cap ? *cap * 2 : 8;
+        if(nc > MAX_HISTORY) nc = MAX_HISTORY;
+        int *g = (int*)realloc(*stack, nc * sizeof(int));
+        if(!g) return;
+        *stack = g;
+        *cap = nc;
+    }
+    (*stack)[(*count)++] = id;
+}
+
+static void pushUndo(User *u, int id) {
+    pushId(&u->undoStack, &u->undoCount, &u->undoCap, id);
+}
+
+static void pushRedo(User *u, int id) {
+    pushId(&u->redoStack, &u->redoCount, &u->redoCap, id);
+}
+
+// undo/redo toggle: drop the task if the user holds it, otherwise hand it back;
+// returns 0 when the task was deleted in the meantime
+static int toggleTask(User *u, int id) {
+    int i = listFind(&u->tasks, id);
+    if(i >= 0){
+        releaseTask(u, i);
+        return 1;
+    }
+    Task *cur = findCopy(id);
+    if(!cur) return 0;
+    Task t = *cur;
+    holdTask(u, &t);
+    return 1;
+}
+
+// ---------- Bounded JSON output ----------
+typedef struct {
+    char *buf;
+    int len, cap;
+} JsonOut;
+
+static void jsonBegin(JsonOut *o, char *buf, int cap) {
+    o->buf = buf;
+    o->cap = cap;
+    o->len = 1;
+    buf[0] = '[';
+    buf[1] = 0;
+}
+
+// append one task; returns 0 once the buffer is full
+static int jsonTask(JsonOut *o, const Task *t, int withTime) {
+    char line[512];
+    int n;
+    if(withTime)
+        n = snprintf(line, sizeof(line), "{\"id\":%d,\"title\":\"%s\",\"priority\":%d,\"due\":\"%s\",\"status\":\"%s\",\"time\":\"%s\"}",
+                     t->id, t->title, t->priority, t->dueDate, t->status, t->timestamp);
+    else
+        n = snprintf(line, sizeof(line), "{\"id\":%d,\"title\":\"%s\",\"priority\":%d,\"due\":\"%s\",\"status\":\"%s\"}",
+                     t->id, t->title, t->priority, t->dueDate, t->status);
+    if(n >= (int)sizeof(line)) n = sizeof(line) - 1;
+    if(o->len + n + 3 > o->cap) return 0;
+    if(o->len > 1) o->buf[o->len++] = ',';
+    memcpy(o->buf + o->len, line, n);
+    o->len += n;
+    return 1;
+}
+
+static const char* jsonEnd(JsonOut *o) {
+    o->buf[o->len++] = ']';
+    o->buf[o->len] = 0;
+    return o->buf;
+}
+
+// ---------- Sorting ----------
+static const char *sortNames[] = { "priority", "due", "status", "created" };
+static int sortBy;
+
+// scratch array of task pointers for sorted output
+static const Task **view = NULL;
+static int viewCap = 0;
+
+static int reserveView(int n) {
+    if(n <= viewCap) return 1;
+    int nc = viewCap ? viewCap : 64;
+    while(nc < n) nc *= 2;
+    const Task **g = (const Task**)realloc(view, nc * sizeof(*view));
+    if(!g) return 0;
+    view = g;
+    viewCap = nc;
+    return 1;
+}
+
+static int collect(const TaskList *l, int n) {
+    for(int i=0;i<l->used;i++)
+        if(l->slots[i].id) view[n++] = &l->slots[i];
+    return n;
+}
+
+// sorts arrays of Task pointers
+static int compareTasks(const void *pa, const void *pb) {
+    const Task *a = *(const Task* const*)pa, *b = *(const Task* const*)pb;
+    int c = 0;
+    if(sortBy == 0) c = (a->priority > b->priority) - (a->priority < b->priority);
+    else if(sortBy == 1) {
+        time_t da = parseDue(a->dueDate), db = parseDue(b->dueDate);
+        c = (da == 0) - (db == 0);
+        if(!c) c = (da > db) - (da < db);
+    }
+    else if(sortBy == 2) c = strcmp(a->status, b->status);
+    if(c) return c;
+    return (a->id > b->id) - (a->id < b->id);
+}
+
+// Login: create user if not exists, otherwise check the password when one is set
+static int loginUser(const char* username, const char* password) {
+    User* u = findUser(username);
+    if(!u){
+        u = getUser(username);
+        if(!u) return 0;
+        if(password) copyField(u->password, password, sizeof(u->password));
+        return 1;
+    }
+    if(password && strlen(u->password)>0) return strcmp(u->password, password)==0;
+    return 1;
 }
 
 // Add task
-EXPORT int STDCALL add_task_api(const char* username, const char* title, int priority, const char* dueDate, const char* status) {
+static int addTask(const char* username, const char* title, int priority, const char* dueDate, const char* status) {
+    if(!title) return -1;
     User* u = getUser(username);
-    if(!u) 
-        return -1;
-    if(u->taskCount>=MAX_TASKS) 
+    if(!u)
         return -1;
 
-    Task* t = &u->tasks[u->taskCount++];
-    t->id = nextTaskID++;
-    strncpy(t->title, title, 99);
-    t->priority = priority;
-    strncpy(t->dueDate, dueDate, 19);
-    strncpy(t->status, status, 19);
-    currentTime(t->timestamp, 30);
+    Task t;
+    t.id = nextTaskID;
+    copyField(t.title, title, sizeof(t.title));
+    t.priority = priority;
+    copyField(t.dueDate, dueDate, sizeof(t.dueDate));
+    copyField(t.status, status, sizeof(t.status));
+    currentTime(t.timestamp, sizeof(t.timestamp));
+    if(!reserveRef(t.id) || !holdTask(u, &t))
+        return -1;
+    nextTaskID++;
+    liveTasks++;
 
     // Push to undo stack
-    if(u->undoCount<MAX_HISTORY) u->undoStack[u->undoCount++] = *t;
-    u->redoCount = 0; // Clear redo
+    pushUndo(u, t.id);
 
-    return t->id;
+    return t.id;
+}
+
+// Edit task: every copy of it, whoever holds it
+static int editTask(const char* username, int id, const char* title, int priority, const char* dueDate, const char* status) {
+    (void)username;
+    Task *cur = findCopy(id);
+    if(!cur) return -1;
+    Task t = *cur;
+    if(title && strlen(title)>0) copyField(t.title, title, sizeof(t.title));
+    t.priority = priority;
+    if(dueDate && strlen(dueDate)>0) copyField(t.dueDate, dueDate, sizeof(t.dueDate));
+    if(status && strlen(status)>0) copyField(t.status, status, sizeof(t.status));
+    currentTime(t.timestamp, sizeof(t.timestamp));
+    TaskRef *r = findRef(id);
+    for(int k=0;k<r->count;k++){
+        TaskList *l = &r->holders[k]->tasks;
+        l->slots[listFind(l, id)] = t;
+    }
+    int i = listFind(&unheld, id);
+    if(i >= 0) unheld.slots[i] = t;
+    return 0;
 }
 
 // Remove task
-EXPORT int STDCALL remove_task_api(const char* username, int taskID) {
-    User* u = getUser(username);
+static int removeTask(const char* username, int taskID) {
+    User* u = findUser(username);
     if(!u) return 0;
-    for(int i=0;i<u->taskCount;i++){
-        if(u->tasks[i].id == taskID){
-            // push to undo
-            if(u->undoCount<MAX_HISTORY) u->undoStack[u->undoCount++] = u->tasks[i];
-            u->redoCount = 0;
-
-            // shift tasks
-            for(int j=i;j<u->taskCount-1;j++)
-                u->tasks[j] = u->tasks[j+1];
-            u->taskCount--;
-            return 1;
-        }
+    int i = listFind(&u->tasks, taskID);
+    if(i < 0) return 0;
+    // push to undo
+    pushUndo(u, taskID);
+    releaseTask(u, i);
+    return 1;
+}
+
+// Delete task: drop every copy; the id is never handed out again
+static int deleteTask(const char* username, int taskID) {
+    (void)username;
+    if(!findCopy(taskID)) return 0;
+    TaskRef *r = findRef(taskID);
+    for(int k=0;k<r->count;k++){
+        TaskList *l = &r->holders[k]->tasks;
+        listRemove(l, listFind(l, taskID));
     }
-    return 0;
+    free(r->holders);
+    memset(r, 0, sizeof(*r));
+    int i = listFind(&unheld, taskID);
+    if(i >= 0) listRemove(&unheld, i);
+    liveTasks--;
+    return 1;
+}
+
+// Assign: give another user a copy of the task
+static int assignTask(const char* fromUser, const char* toUser, int id) {
+    (void)fromUser;
+    User* to = getUser(toUser);
+    Task *cur = findCopy(id);
+    if(!to || !cur) return 0;
+    Task t = *cur;
+    if(listFind(&to->tasks, id) < 0 && !holdTask(to, &t)) return 0;
+    pushUndo(to, id);
+    return 1;
 }
 
 // Undo
-EXPORT int STDCALL undo_api(const char* username) {
-    User* u = getUser(username);
+static int undoTask(const char* username) {
+    User* u = findUser(username);
     if(!u || u->undoCount==0) return 0;
 
-    Task t = u->undoStack[--u->undoCount];
+    int id = u->undoStack[--u->undoCount];
 
     // push to redo
-    if(u->redoCount<MAX_HISTORY) u->redoStack[u->redoCount++] = t;
-
-    // remove from task list if exists
-    for(int i=0;i<u->taskCount;i++)
-        if(u->tasks[i].id==t.id){
-            for(int j=i;j<u->taskCount-1;j++) u->tasks[j]=u->tasks[j+1];
-            u->taskCount--;
-            break;
-        }
-
+    if(toggleTask(u, id)) pushRedo(u, id);
     return 1;
 }
 
 // Redo
-EXPORT int STDCALL redo_api(const char* username) {
-    User* u = getUser(username);
+static int redoTask(const char* username) {
+    User* u = findUser(username);
     if(!u || u->redoCount==0) return 0;
 
-    Task t = u->redoStack[--u->redoCount];
+    int id = u->redoStack[--u->redoCount];
 
     // push to undo
-    if(u->undoCount<MAX_HISTORY) u->undoStack[u->undoCount++] = t;
-
-    // add to tasks
-    if(u->taskCount<MAX_TASKS) u->tasks[u->taskCount++] = t;
+    if(toggleTask(u, id)) pushUndo(u, id);
     return 1;
 }
 
-// List tasks as JSON
-EXPORT const char* STDCALL list_tasks_api(const char* username) {
-    static char buffer[10000];
-    buffer[0]=0;
-    User* u = getUser(username);
+// List tasks as JSON, in assignment order or by a criterion ("-" prefix: descending)
+static const char* listTasks(const char* username, const char* criterion) {
+    static THREAD_LOCAL char buffer[JSON_BUF];
+    User* u = findUser(username);
     if(!u) return "[]";
 
-    strcat(buffer,"[");
-    for(int i=0;i<u->taskCount;i++){
-        char line[300];
-        snprintf(line, 300,
-                "{\"id\":%d,\"title\":\"%s\",\"priority\":%d,\"due\":\"%s\",\"status\":\"%s\",\"time\":\"%s\"}%s",
-                u->tasks[i].id, u->tasks[i].title, u->tasks[i].priority,
-                u->tasks[i].dueDate, u->tasks[i].status, u->tasks[i].timestamp,
-                (i==u->taskCount-1)?"":",");
-        strcat(buffer,line);
-    }
-    strcat(buffer,"]");
-    return buffer;
+    int desc = criterion && criterion[0] == '-';
+    const char *name = desc ? criterion + 1 : criterion;
+    if(!reserveView(u->tasks.live)) return "[]";
+    int n = collect(&u->tasks, 0);
+    for(sortBy = 0; sortBy < 4 && !(name && strcmp(name, sortNames[sortBy])==0); sortBy++);
+    if(sortBy < 4)
+        qsort(view, n, sizeof(*view), compareTasks);
+    else desc = 0;
+
+    JsonOut o;
+    jsonBegin(&o, buffer, JSON_BUF);
+    for(int i=0;i<n;i++)
+        if(!jsonTask(&o, view[desc ? n-1-i : i], 1)) break;
+    return jsonEnd(&o);
 }
 
 // Notifications (all tasks for simplicity)
+static const char* notifications(const char* username) {
+    return listTasks(username, NULL);
+}
+
+// Manager view: every task anyone holds, once, in id order
+static const char* managerTasks(void) {
+    static THREAD_LOCAL char buffer[JSON_BUF];
+    int total = unheld.live, n = 0;
+    for(int k=0;k<userCount;k++)
+        total += users[k]->tasks.live;
+    if(!reserveView(total)) return "[]";
+    for(int k=0;k<userCount;k++)
+        n = collect(&users[k]->tasks, n);
+    n = collect(&unheld, n);
+    sortBy = 3;
+    qsort(view, n, sizeof(*view), compareTasks);
+    JsonOut o;
+    jsonBegin(&o, buffer, JSON_BUF);
+    for(int i=0;i<n;i++)
+        if((i == 0 || view[i]->id != view[i-1]->id) && !jsonTask(&o, view[i], 1)) break;
+    return jsonEnd(&o);
+}
+
+// Search a user's tasks by title substring
+static const char* searchTasks(const char* username, const char* q) {
+    static THREAD_LOCAL char buffer[JSON_BUF];
+    JsonOut o;
+    jsonBegin(&o, buffer, JSON_BUF);
+    User* u = findUser(username);
+    if(!u || !q) return jsonEnd(&o);
+    for(int i=0;i<u->tasks.used;i++){
+        const Task *t = &u->tasks.slots[i];
+        if(t->id && strstr(t->title, q) && !jsonTask(&o, t, 0)) break;
+    }
+    return jsonEnd(&o);
+}
+
+// Filter a user's tasks by status and/or priority (empty / 0 matches all)
+static const char* filterTasks(const char* username, const char* status, int priority) {
+    static THREAD_LOCAL char buffer[JSON_BUF];
+    JsonOut o;
+    jsonBegin(&o, buffer, JSON_BUF);
+    User* u = findUser(username);
+    if(!u) return jsonEnd(&o);
+    for(int i=0;i<u->tasks.used;i++){
+        const Task *t = &u->tasks.slots[i];
+        if(!t->id) continue;
+        int ok = 1;
+        if(status && strlen(status)>0) ok &= (strcmp(t->status, status)==0);
+        if(priority>0) ok &= (t->priority == priority);
+        if(ok && !jsonTask(&o, t, 0)) break;
+    }
+    return jsonEnd(&o);
+}
+
+// Basic stats
+static const char* analytics(const char* username) {
+    static THREAD_LOCAL char buffer[256];
+    (void)username;
+    snprintf(buffer, sizeof(buffer), "{\"users\":%d,\"tasks_total_estimate\":%d,\"tasks_live\":%d}", userCount, nextTaskID-1, liveTasks);
+    return buffer;
+}
+
+// ---------- Exported entry points (serialized on engineLock) ----------
+EXPORT int STDCALL login_user_api(const char* username, const char* password) {
+    engine_lock();
+    int r = loginUser(username, password);
+    engine_unlock();
+    return r;
+}
+
+EXPORT int STDCALL add_task_api(const char* username, const char* title, int priority, const char* dueDate, const char* status) {
+    engine_lock();
+    int r = addTask(username, title, priority, dueDate, status);
+    engine_unlock();
+    return r;
+}
+
+EXPORT int STDCALL edit_task_api(const char* username, int id, const char* title, int priority, const char* dueDate, const char* status) {
+    engine_lock();
+    int r = editTask(username, id, title, priority, dueDate, status);
+    engine_unlock();
+    return r;
+}
+
+EXPORT int STDCALL remove_task_api(const char* username, int taskID) {
+    engine_lock();
+    int r = removeTask(username, taskID);
+    engine_unlock();
+    return r;
+}
+
+EXPORT int STDCALL delete_task_api(const char* username, int taskID) {
+    engine_lock();
+    int r = deleteTask(username, taskID);
+    engine_unlock();
+    return r;
+}
+
+EXPORT int STDCALL assign_task_api(const char* fromUser, const char* toUser, int id) {
+    engine_lock();
+    int r = assignTask(fromUser, toUser, id);
+    engine_unlock();
+    return r;
+}
+
+EXPORT int STDCALL undo_api(const char* username) {
+    engine_lock();
+    int r = undoTask(username);
+    engine_unlock();
+    return r;
+}
+
+EXPORT int STDCALL redo_api(const char* username) {
+    engine_lock();
+    int r = redoTask(username);
+    engine_unlock();
+    return r;
+}
+
+EXPORT const char* STDCALL list_tasks_api(const char* username, const char* criterion) {
+    engine_lock();
+    const char* r = listTasks(username, criterion);
+    engine_unlock();
+    return r;
+}
+
 EXPORT const char* STDCALL notifications_api(const char* username) {
-    return list_tasks_api(username);
+    engine_lock();
+    const char* r = notifications(username);
+    engine_unlock();
+    return r;
+}
+
+EXPORT const char* STDCALL manager_tasks_api(void) {
+    engine_lock();
+    const char* r = managerTasks();
+    engine_unlock();
+    return r;
+}
+
+EXPORT const char* STDCALL search_task_api(const char* username, const char* q) {
+    engine_lock();
+    const char* r = searchTasks(username, q);
+    engine_unlock();
+    return r;
+}
+
+EXPORT const char* STDCALL filter_task_api(const char* username, const char* status, int priority) {
+    engine_lock();
+    const char* r = filterTasks(username, status, priority);
+    engine_unlock();
+    return r;
+}
+
+EXPORT const char* STDCALL analytics_api(const char* username) {
+    engine_lock();
+    const char* r = analytics(username);
+    engine_unlock();
+    return r;
+}
+static const TaskEngineOps arrayOps = {
+    TASK_ENGINE_ABI, "array",
+    login_user_api, add_task_api, edit_task_api, remove_task_api, delete_task_api, assign_task_api,
+    undo_api, redo_api, list_tasks_api, notifications_api, manager_tasks_api,
+    search_task_api, filter_task_api, analytics_api
+};
+
+EXPORT const TaskEngineOps* STDCALL task_engine_ops(void) {
+    return &arrayOps;
 }
@@ -0,0 +1,65 @@
+// task_engine.h
+// Storage-engine interface shared by the task engines:
+//   task_api.c          "array": growable per-user lists of task copies
+//   task_manager_api.c  "treap": sharded task treaps with per-user lists
+// Each engine library exports task_engine_ops(), a table of its entry points,
+// so a host (server.py, tools) can load any engine build and call it the same
+// way. Entries an engine does not provide are NULL; anything beyond this
+// table (queries, replication, ...) stays an engine-specific export.
+
+#ifndef TASK_ENGINE_H
+#define TASK_ENGINE_H
+
+#ifdef _WIN32
+#define EXPORT __declspec(dllexport)
+#define STDCALL __stdcall
+#else
+#define EXPORT
+#define STDCALL
+#endif
+
+// bumped whenever the table below changes layout
+#define TASK_ENGINE_ABI 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shared contract (what a conforming engine must reproduce):
+// - ids are positive and never reused; add assigns the task to its creator
+// - list/search/manager return JSON arrays of
+//   {"id","title","priority","due","status"[,"time"]} objects; manager lists
+//   tasks in creation order
+// - list criterion: "", "priority", "due", "status" or "created", "-" prefix
+//   for descending; ties break by creation order and undated tasks sort last
+//   on "due". Ids need not follow creation order (the treap's interleave by shard)
+// - add, remove and assign push the task id on the user's undo stack; undo
+//   and redo toggle whether the user holds that task and return 1 when a
+//   stack entry was consumed
+// - unknown users read as empty and are not created by reads
+typedef struct TaskEngineOps {
+    int abi;                 // TASK_ENGINE_ABI the engine was built against
+    const char *name;
+    int (STDCALL *login_user)(const char *username, const char *password);
+    int (STDCALL *add_task)(const char *username, const char *title, int priority, const char *dueDate, const char *status);
+    int (STDCALL *edit_task)(const char *username, int id, const char *title, int priority, const char *dueDate, const char *status);
+    int (STDCALL *remove_task)(const char *username, int id);
+    int (STDCALL *delete_task)(const char *username, int id);
+    int (STDCALL *assign_task)(const char *fromUser, const char *toUser, int id);
+    int (STDCALL *undo)(const char *username);
+    int (STDCALL *redo)(const char *username);
+    const char* (STDCALL *list_tasks)(const char *username, const char *criterion);
+    const char* (STDCALL *notifications)(const char *username);
+    const char* (STDCALL *manager_tasks)(void);
+    const char* (STDCALL *search_task)(const char *username, const char *q);
+    const char* (STDCALL *filter_task)(const char *username, const char *status, int priority);
+    const char* (STDCALL *analytics)(const char *username);
+} TaskEngineOps;
+
+typedef const TaskEngineOps* (STDCALL *TaskEngineOpsFn)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TASK_ENGINE_H
@@ -0,0 +1,53 @@
+import ctypes
+import os
+
+# Python mirror of task_engine.h: loads an engine library and binds the table
+# returned by its task_engine_ops() export. Keep the field order in sync.
+
+TASK_ENGINE_ABI = 1
+
+_S = ctypes.c_char_p
+_I = ctypes.c_int
+_FN = ctypes.WINFUNCTYPE if os.name == "nt" else ctypes.CFUNCTYPE
+
+
+class TaskEngineOps(ctypes.Structure):
+    _fields_ = [
+        ("abi", _I),
+        ("name", _S),
+        ("login_user", _FN(_I, _S, _S)),
+        ("add_task", _FN(_I, _S, _S, _I, _S, _S)),
+        ("edit_task", _FN(_I, _S, _I, _S, _I, _S, _S)),
+        ("remove_task", _FN(_I, _S, _I)),
+        ("delete_task", _FN(_I, _S, _I)),
+        ("assign_task", _FN(_I, _S, _S, _I)),
+        ("undo", _FN(_I, _S)),
+        ("redo", _FN(_I, _S)),
+        ("list_tasks", _FN(_S, _S, _S)),
+        ("notifications", _FN(_S, _S)),
+        ("manager_tasks", _FN(_S)),
+        ("search_task", _FN(_S, _S, _S)),
+        ("filter_task", _FN(_S, _S, _S, _I)),
+        ("analytics", _FN(_S, _S)),
+    ]
+
+
+def library_path(name):
+    # "task_manager_api" -> ./task_manager_api.dll / .so; a path with an extension is used as is
+    if os.path.splitext(name)[1]:
+        return name
+    return os.path.join(os.getcwd(), name + (".dll" if os.name == "nt" else ".so"))
+
+
+def load_engine(name):
+    """Returns (library, ops) for an engine build; extras stay reachable on the library."""
+    path = library_path(name)
+    if not os.path.exists(path):
+        raise FileNotFoundError(f"{path} not found. Compile your DLL first.")
+    lib = ctypes.CDLL(path)
+    lib.task_engine_ops.argtypes = []
+    lib.task_engine_ops.restype = ctypes.POINTER(TaskEngineOps)
+    ops = lib.task_engine_ops().contents
+    if ops.abi != TASK_ENGINE_ABI:
+        raise RuntimeError(f"{path}: engine ABI {ops.abi}, expected {TASK_ENGINE_ABI}")
+    return lib, ops
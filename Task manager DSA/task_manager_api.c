@@ -1,18 +1,109 @@
 // task_manager_api.c
 // Compile (MinGW-w64 64-bit):
 // gcc -shared -o task_manager_api.dll task_manager_api.c -Wl,--add-stdcall-alias -O2 -std=c11 -m64
+// Linux/macOS:
+// gcc -shared -fPIC -o task_manager_api.so task_manager_api.c -O2 -std=c11 -pthread
+// Add -DENGINE_SHARDS=<n> (1..64, default 8) to change the number of shards.
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdarg.h>
 #include <time.h>
 
+#include "task_engine.h"
+#include "record_codec.h"
+
+#define THREAD_LOCAL _Thread_local
+
+// ----- Threads, locks and condition variables (Win32 / pthreads) -----
 #ifdef _WIN32
-#define EXPORT __declspec(dllexport)
-#define STDCALL __stdcall
+#include <windows.h>
+typedef SRWLOCK EngineMutex;
+typedef CONDITION_VARIABLE EngineCond;
+typedef HANDLE EngineThread;
+typedef INIT_ONCE EngineOnce;
+#define ENGINE_MUTEX_INIT SRWLOCK_INIT
+#define ENGINE_COND_INIT CONDITION_VARIABLE_INIT
+#define ENGINE_ONCE_INIT INIT_ONCE_STATIC_INIT
+#define THREAD_FN(name) static DWORD WINAPI name(LPVOID arg)
+typedef LPTHREAD_START_ROUTINE EngineThreadFn;
+#define THREAD_RETURN return 0
+static void mutex_init(EngineMutex *m){ InitializeSRWLock(m); }
+static void mutex_lock(EngineMutex *m){ AcquireSRWLockExclusive(m); }
+static void mutex_unlock(EngineMutex *m){ ReleaseSRWLockExclusive(m); }
+static void cond_init(EngineCond *c){ InitializeConditionVariable(c); }
+static void cond_signal(EngineCond *c){ WakeAllConditionVariable(c); }
+// wait up to ms milliseconds (ms < 0: forever)
+static void cond_wait_ms(EngineCond *c, EngineMutex *m, long ms){
+    SleepConditionVariableSRW(c, m, ms < 0 ? INFINITE : (DWORD)ms, 0);
+}
+static int thread_start(EngineThread *t, EngineThreadFn fn, void *arg){
+    *t = CreateThread(NULL, 0, fn, arg, 0, NULL);
+    return *t != NULL;
+}
+static void thread_join(EngineThread t){
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+static BOOL CALLBACK once_trampoline(PINIT_ONCE once, PVOID fn, PVOID *ctx){
+    (void)once; (void)ctx;
+    ((void (*)(void))fn)();
+    return TRUE;
+}
+static void run_once(EngineOnce *o, void (*fn)(void)){ InitOnceExecuteOnce(o, once_trampoline, (PVOID)fn, NULL); }
+static void local_tm(time_t t, struct tm *out){ localtime_s(out, &t); }
+static long long mono_ns(void){
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if(!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (long long)((double)t.QuadPart * 1e9 / (double)freq.QuadPart);
+}
 #else
-#define EXPORT
-#define STDCALL
+#include <pthread.h>
+typedef pthread_mutex_t EngineMutex;
+typedef pthread_cond_t EngineCond;
+typedef pthread_t EngineThread;
+typedef pthread_once_t EngineOnce;
+#define ENGINE_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#define ENGINE_COND_INIT PTHREAD_COND_INITIALIZER
+#define ENGINE_ONCE_INIT PTHREAD_ONCE_INIT
+#define THREAD_FN(name) static void* name(void *arg)
+typedef void *(*EngineThreadFn)(void*);
+#define THREAD_RETURN return NULL
+static void mutex_init(EngineMutex *m){ pthread_mutex_init(m, NULL); }
+static void mutex_lock(EngineMutex *m){ pthread_mutex_lock(m); }
+static void mutex_unlock(EngineMutex *m){ pthread_mutex_unlock(m); }
+static void cond_init(EngineCond *c){ pthread_cond_init(c, NULL); }
+static void cond_signal(EngineCond *c){ pthread_cond_broadcast(c); }
+static void cond_wait_ms(EngineCond *c, EngineMutex *m, long ms){
+    if(ms < 0){ pthread_cond_wait(c, m); return; }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (ms % 1000) * 1000000L;
+    if(ts.tv_nsec >= 1000000000L){ ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+    pthread_cond_timedwait(c, m, &ts);
+}
+static int thread_start(EngineThread *t, EngineThreadFn fn, void *arg){
+    return pthread_create(t, NULL, fn, arg) == 0;
+}
+static void thread_join(EngineThread t){ pthread_join(t, NULL); }
+static void run_once(EngineOnce *o, void (*fn)(void)){ pthread_once(o, fn); }
+static void local_tm(time_t t, struct tm *out){ localtime_r(&t, out); }
+static long long mono_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 #endif
 
 #ifdef __cplusplus
@@ -20,34 +111,412 @@ extern "C" {
 #endif
 
 // ----- Constants -----
-#define MAX_USERS 20
+#ifndef ENGINE_SHARDS
+#define ENGINE_SHARDS 8
+#endif
+#if ENGINE_SHARDS < 1 || ENGINE_SHARDS > 64
+#error "ENGINE_SHARDS must be between 1 and 64 (shard sets are 64-bit masks)"
+#endif
 #define MAX_USERNAME 50
 #define MAX_NOTIF 200
 #define MAX_NOTIF_MSG 256
 #define JSON_BUF 32000
+#define TASK_POOL_MAX 1024 // deleted TaskNodes kept (per shard) for reuse before going back to the allocator
+#define REMIND_BEFORE_DEFAULT (24*60*60) // seconds before the deadline a "due soon" event fires
+#define CLOSED_STATUS "Completed"
+#define OVERDUE_STATUS "Overdue"
+
+// ---------- Compressed task-id sets (roaring-style bitmaps) ----------
+// Ids are split into a 16-bit container key and 16-bit low bits. Sparse
+// containers hold a sorted uint16 array, dense ones a 65536-bit bitmap, so
+// set algebra runs word-at-a-time over dense ranges and by merge elsewhere.
+#define RB_ARRAY_MAX 4096
+#define RB_WORDS 1024
+
+typedef struct {
+    uint16_t key;
+    int card;
+    int cap;            // allocated array slots (array containers only)
+    uint16_t *array;    // sorted low bits, used while card <= RB_ARRAY_MAX
+    uint64_t *bits;     // RB_WORDS words otherwise (kept by rb_remove down to RB_ARRAY_MAX/2)
+} RBContainer;
+
+typedef struct {
+    RBContainer *c;     // sorted by key
+    int n, cap;
+} Roaring;
+
+static void rbc_free(RBContainer *c){
+    free(c->array);
+    free(c->bits);
+    c->array = NULL;
+    c->bits = NULL;
+    c->card = c->cap = 0;
+}
+
+static void rb_free(Roaring *r){
+    for(int i=0;i<r->n;i++) rbc_free(&r->c[i]);
+    free(r->c);
+    r->c = NULL;
+    r->n = r->cap = 0;
+}
+
+// build a container from a full bitmap, choosing the smaller representation
+static int rbc_from_bits(RBContainer *out, uint16_t key, uint64_t *bits){
+    int card = 0;
+    for(int i=0;i<RB_WORDS;i++) card += __builtin_popcountll(bits[i]);
+    out->key = key;
+    out->card = card;
+    out->array = NULL;
+    out->bits = NULL;
+    out->cap = 0;
+    if(card == 0) return 0;
+    if(card > RB_ARRAY_MAX){
+        out->bits = (uint64_t*)malloc(RB_WORDS * sizeof(uint64_t));
+        if(!out->bits) return 0;
+        memcpy(out->bits, bits, RB_WORDS * sizeof(uint64_t));
+        return 1;
+    }
+    out->array = (uint16_t*)malloc(card * sizeof(uint16_t));
+    if(!out->array) return 0;
+    out->cap = card;
+    int k = 0;
+    for(int i=0;i<RB_WORDS;i++){
+        uint64_t w = bits[i];
+        while(w){
+            int b = __builtin_ctzll(w);
+            out->array[k++] = (uint16_t)(i*64 + b);
+            w &= w - 1;
+        }
+    }
+    return 1;
+}
+
+static void rbc_to_bits(const RBContainer *c, uint64_t *bits){
+    if(c->bits){
+        memcpy(bits, c->bits, RB_WORDS * sizeof(uint64_t));
+        return;
+    }
+    memset(bits, 0, RB_WORDS * sizeof(uint64_t));
+    for(int i=0;i<c->card;i++) bits[c->array[i] >> 6] |= 1ULL << (c->array[i] & 63);
+}
+
+static int rb_find(const Roaring *r, uint16_t key, int *pos){
+    int lo = 0, hi = r->n;
+    while(lo < hi){
+        int mid = (lo + hi) / 2;
+        if(r->c[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    *pos = lo;
+    return lo < r->n && r->c[lo].key == key;
+}
+
+// append a container known to sort after every existing key (used by set ops)
+static void rb_push(Roaring *r, RBContainer *c){
+    if(c->card == 0) return;
+    if(r->n == r->cap){
+        int nc = r->cap ? r->cap * 2 : 4;
+        RBContainer *g = (RBContainer*)realloc(r->c, nc * sizeof(RBContainer));
+        if(!g){ rbc_free(c); return; }
+        r->c = g;
+        r->cap = nc;
+    }
+    r->c[r->n++] = *c;
+}
+
+static void rb_add(Roaring *r, int id){
+    if(id < 0) return;
+    uint16_t key = (uint16_t)((unsigned)id >> 16), lo = (uint16_t)(id & 0xFFFF);
+    int pos;
+    if(!rb_find(r, key, &pos)){
+        if(r->n == r->cap){
+            int nc = r->cap ? r->cap * 2 : 4;
+            RBContainer *g = (RBContainer*)realloc(r->c, nc * sizeof(RBContainer));
+            if(!g) return;
+            r->c = g;
+            r->cap = nc;
+        }
+        memmove(&r->c[pos+1], &r->c[pos], (r->n - pos) * sizeof(RBContainer));
+        r->n++;
+        RBContainer *c = &r->c[pos];
+        c->key = key;
+        c->card = c->cap = 0;
+        c->array = NULL;
+        c->bits = NULL;
+    }
+    RBContainer *c = &r->c[pos];
+    if(c->bits){
+        uint64_t m = 1ULL << (lo & 63);
+        if(!(c->bits[lo >> 6] & m)){ c->bits[lo >> 6] |= m; c->card++; }
+        return;
+    }
+    int a = 0, b = c->card;
+    while(a < b){
+        int m = (a + b) / 2;
+        if(c->array[m] < lo) a = m + 1;
+        else b = m;
+    }
+    if(a < c->card && c->array[a] == lo) return;
+    if(c->card == RB_ARRAY_MAX){
+        // array is full: switch to a bitmap
+        uint64_t *bits = (uint64_t*)calloc(RB_WORDS, sizeof(uint64_t));
+        if(!bits) return;
+        for(int i=0;i<c->card;i++) bits[c->array[i] >> 6] |= 1ULL << (c->array[i] & 63);
+        bits[lo >> 6] |= 1ULL << (lo & 63);
+        free(c->array);
+        c->array = NULL;
+        c->cap = 0;
+        c->bits = bits;
+        c->card++;
+        return;
+    }
+    if(c->card == c->cap){
+        int nc = c->cap ? c->cap * 2 : 4;
+        if(nc > RB_ARRAY_MAX) nc = RB_ARRAY_MAX;
+        uint16_t *g = (uint16_t*)realloc(c->array, nc * sizeof(uint16_t));
+        if(!g) return;
+        c->array = g;
+        c->cap = nc;
+    }
+    memmove(&c->array[a+1], &c->array[a], (c->card - a) * sizeof(uint16_t));
+    c->array[a] = lo;
+    c->card++;
+}
+
+static void rb_remove(Roaring *r, int id){
+    int pos;
+    uint16_t lo = (uint16_t)(id & 0xFFFF);
+    if(id < 0 || !rb_find(r, (uint16_t)((unsigned)id >> 16), &pos)) return;
+    RBContainer *c = &r->c[pos];
+    if(c->bits){
+        uint64_t m = 1ULL << (lo & 63);
+        if(!(c->bits[lo >> 6] & m)) return;
+        c->bits[lo >> 6] &= ~m;
+        c->card--;
+        // shrink only well below the point rb_add grows at, so a set that hovers
+        // around RB_ARRAY_MAX does not convert back and forth on every change
+        if(c->card <= RB_ARRAY_MAX / 2){
+            RBContainer small;
+            if(rbc_from_bits(&small, c->key, c->bits)){
+                rbc_free(c);
+                *c = small;
+            }
+        }
+    } else {
+        int a = 0, b = c->card;
+        while(a < b){
+            int m = (a + b) / 2;
+            if(c->array[m] < lo) a = m + 1;
+            else b = m;
+        }
+        if(a >= c->card || c->array[a] != lo) return;
+        memmove(&c->array[a], &c->array[a+1], (c->card - a - 1) * sizeof(uint16_t));
+        c->card--;
+    }
+    if(c->card == 0){
+        rbc_free(c);
+        memmove(&r->c[pos], &r->c[pos+1], (r->n - pos - 1) * sizeof(RBContainer));
+        r->n--;
+    }
+}
+
+static int rb_cardinality(const Roaring *r){
+    int n = 0;
+    for(int i=0;i<r->n;i++) n += r->c[i].card;
+    return n;
+}
+
+// visit ids in ascending order; stops early when fn returns 0
+static void rb_foreach(const Roaring *r, int (*fn)(int id, void *ctx), void *ctx){
+    for(int i=0;i<r->n;i++){
+        const RBContainer *c = &r->c[i];
+        int base = (int)c->key << 16;
+        if(c->bits){
+            for(int w=0; w<RB_WORDS; w++){
+                uint64_t bits = c->bits[w];
+                while(bits){
+                    if(!fn(base + w*64 + __builtin_ctzll(bits), ctx)) return;
+                    bits &= bits - 1;
+                }
+            }
+        } else {
+            for(int k=0;k<c->card;k++)
+                if(!fn(base + c->array[k], ctx)) return;
+        }
+    }
+}
+
+static void rbc_copy(RBContainer *out, const RBContainer *c){
+    *out = *c;
+    out->array = NULL;
+    out->bits = NULL;
+    if(c->bits){
+        out->bits = (uint64_t*)malloc(RB_WORDS * sizeof(uint64_t));
+        if(out->bits) memcpy(out->bits, c->bits, RB_WORDS * sizeof(uint64_t));
+        else out->card = 0;
+    } else {
+        out->cap = c->card;
+        out->array = (uint16_t*)malloc((c->card ? c->card : 1) * sizeof(uint16_t));
+        if(out->array) memcpy(out->array, c->array, c->card * sizeof(uint16_t));
+        else out->card = 0;
+    }
+}
+
+static void rb_copy(Roaring *out, const Roaring *a){
+    out->c = NULL;
+    out->n = out->cap = 0;
+    for(int i=0;i<a->n;i++){
+        RBContainer c;
+        rbc_copy(&c, &a->c[i]);
+        rb_push(out, &c);
+    }
+}
+
+enum { RB_AND, RB_OR, RB_ANDNOT };
+
+// combine two containers with the same key. Sorted arrays are merged; any
+// bitmap operand makes the op a straight word loop the compiler vectorizes.
+static void rbc_op(RBContainer *out, const RBContainer *a, const RBContainer *b, int op){
+    out->key = a->key;
+    out->card = out->cap = 0;
+    out->array = NULL;
+    out->bits = NULL;
+    if(!a->bits && !b->bits){
+        int cap = (op == RB_OR) ? a->card + b->card : a->card;
+        if(cap > RB_ARRAY_MAX){
+            // a large union may spill into a bitmap
+            uint64_t wa[RB_WORDS];
+            rbc_to_bits(a, wa);
+            for(int i=0;i<b->card;i++) wa[b->array[i] >> 6] |= 1ULL << (b->array[i] & 63);
+            rbc_from_bits(out, a->key, wa);
+            return;
+        }
+        uint16_t *res = (uint16_t*)malloc((cap ? cap : 1) * sizeof(uint16_t));
+        if(!res) return;
+        int i = 0, j = 0, k = 0;
+        while(i < a->card && j < b->card){
+            if(a->array[i] < b->array[j]){
+                if(op != RB_AND) res[k++] = a->array[i];
+                i++;
+            } else if(a->array[i] > b->array[j]){
+                if(op == RB_OR) res[k++] = b->array[j];
+                j++;
+            } else {
+                if(op != RB_ANDNOT) res[k++] = a->array[i];
+                i++; j++;
+            }
+        }
+        if(op != RB_AND) while(i < a->card) res[k++] = a->array[i++];
+        if(op == RB_OR) while(j < b->card) res[k++] = b->array[j++];
+        out->array = res;
+        out->card = k;
+        out->cap = cap;
+        return;
+    }
+    if(op == RB_AND && (!a->bits || !b->bits)){
+        // array AND bitmap: probe the bitmap for each array entry
+        const RBContainer *arr = a->bits ? b : a, *bm = a->bits ? a : b;
+        uint16_t *res = (uint16_t*)malloc((arr->card ? arr->card : 1) * sizeof(uint16_t));
+        if(!res) return;
+        int k = 0;
+        for(int i=0;i<arr->card;i++){
+            uint16_t v = arr->array[i];
+            if((bm->bits[v >> 6] >> (v & 63)) & 1) res[k++] = v;
+        }
+        out->array = res;
+        out->card = k;
+        out->cap = arr->card;
+        return;
+    }
+    uint64_t wa[RB_WORDS], wb[RB_WORDS];
+    rbc_to_bits(a, wa);
+    rbc_to_bits(b, wb);
+    switch(op){
+    case RB_AND:    for(int i=0;i<RB_WORDS;i++) wa[i] &= wb[i]; break;
+    case RB_OR:     for(int i=0;i<RB_WORDS;i++) wa[i] |= wb[i]; break;
+    default:        for(int i=0;i<RB_WORDS;i++) wa[i] &= ~wb[i]; break;
+    }
+    rbc_from_bits(out, a->key, wa);
+}
+
+static void rb_op(Roaring *out, const Roaring *a, const Roaring *b, int op){
+    out->c = NULL;
+    out->n = out->cap = 0;
+    int i = 0, j = 0;
+    while(i < a->n || j < b->n){
+        RBContainer c;
+        if(j >= b->n || (i < a->n && a->c[i].key < b->c[j].key)){
+            if(op != RB_AND){ rbc_copy(&c, &a->c[i]); rb_push(out, &c); }
+            i++;
+        } else if(i >= a->n || b->c[j].key < a->c[i].key){
+            if(op == RB_OR){ rbc_copy(&c, &b->c[j]); rb_push(out, &c); }
+            j++;
+        } else {
+            rbc_op(&c, &a->c[i], &b->c[j], op);
+            if(c.card) rb_push(out, &c);
+            else rbc_free(&c);
+            i++; j++;
+        }
+    }
+}
+
+struct TaskDLL;
+struct User;
 
-// ----- Task node for global BST -----
+// ----- Task node for a shard's BST (treap: ordered by id, heap-ordered by heapKey) -----
 typedef struct TaskNode {
     int id;
+    unsigned long long created;  // creation order across shards (ids interleave by shard)
     char title[128];
     int priority;
     char dueDate[20];
     char status[32];
     char timestamp[32];
+    unsigned heapKey;            // random treap priority, keeps depth O(log n) for sequential ids
+    time_t dueAt;                // parsed dueDate, 0 if none
+    int dueState;                // DUE_PENDING / DUE_REMINDED / DUE_FIRED
+    int schedIdx;                // slot in the shard's deadline heap, -1 when not scheduled
+    struct TaskDLL *assignees;   // reverse index: every user holding this task
+    int assigneeCount;
+    struct DepNode *dep;         // dependency-graph node, NULL until the task has an edge
     struct TaskNode *left, *right;
 } TaskNode;
 
 // ----- Doubly-linked list node to hold pointers to TaskNode (per-user assigned tasks) -----
+// Each node sits on two lists: the owner's task list (prev/next) and the
+// task's assignee list (tprev/tnext), so a task can be detached from all
+// of its holders without scanning every user.
 typedef struct TaskDLL {
     TaskNode *task;
+    struct User *owner;
     struct TaskDLL *prev, *next;
+    struct TaskDLL *tprev, *tnext;
 } TaskDLL;
 
+// ----- Node of a per-user sorted view (treap ordered by a sort criterion) -----
+enum { SORT_PRIORITY, SORT_DUE, SORT_STATUS, SORT_CREATED, SORT_COUNT };
+
+typedef struct ViewNode {
+    TaskNode *task;
+    unsigned heapKey;
+    struct ViewNode *left, *right;
+} ViewNode;
+
 // ----- Per-user structure -----
-typedef struct {
+typedef struct User {
     char username[MAX_USERNAME];
-    char password[64]; // optional (can be empty)
+    char password[65]; // password_hash of the password, hex; empty when none is set
+    int shard;            // home shard (hash of username)
     TaskDLL *head, *tail; // assigned tasks list
+    Roaring assigned;     // ids of assigned tasks, for cross-user set queries
+    ViewNode *views[SORT_COUNT];       // sorted views, materialized on first use
+    unsigned char viewActive[SORT_COUNT];
+    int heldPerShard[ENGINE_SHARDS];   // assigned tasks by the shard that owns them
+    uint64_t heldMask;                 // shards with heldPerShard > 0
+    long long load;                    // summed task_weight of the tasks held
+    struct TeamMember **teams;         // teams this user is a member of
+    int teamCount, teamCap;
     // undo/redo stacks (store task IDs)
     int undoStack[128];
     int undoTop;
@@ -55,79 +524,724 @@ typedef struct {
     int redoTop;
 } User;
 
+// ----- Teams: members in a min-heap by load, for auto-assignment -----
+// A member's heap entry caches the user's load, so the heap is only ever read
+// and written under the team's own lock, never the users' shard locks.
+typedef struct Team {
+    char name[MAX_USERNAME];
+    EngineMutex lock;                  // leaf lock: taken inside shard locks
+    struct TeamMember **heap;
+    int count, cap;
+    unsigned nextSeq;
+} Team;
+
+typedef struct TeamMember {
+    User *u;
+    Team *team;
+    long long load;                    // u->load as of its last change
+    unsigned seq;                      // join order, breaks load ties
+    int pos;                           // index in team->heap
+} TeamMember;
+
+// Set indexes over live task ids: every task, tasks with at least one
+// assignee, and one set per distinct status string / priority value
+typedef struct {
+    char status[32];
+    int priority;
+    Roaring set;
+} TaskClass;
+
+// Notification queue (circular); an empty recipient means "everyone".
+// Each shard has its own ring behind a leaf lock; seq orders entries across rings.
+typedef struct {
+    EngineMutex lock;
+    char msg[MAX_NOTIF][MAX_NOTIF_MSG];
+    char to[MAX_NOTIF][MAX_USERNAME];
+    unsigned long long seq[MAX_NOTIF];
+    int front, rear, count;
+} NotifRing;
+
+// ----- Shard: one partition of users and the tasks they create -----
+// A task lives in the shard of the user who created it; its id encodes the
+// shard (id % ENGINE_SHARDS). Users hash to a shard by name. Everything in a
+// shard is guarded by its lock, except the notification ring (own leaf lock).
+typedef struct {
+    EngineMutex lock;
+    TaskNode *taskRoot;                // BST of this shard's tasks
+    int nextSeq;                       // next id is nextSeq * ENGINE_SHARDS + shard index
+    int liveTaskCount;
+    TaskNode *freeTasks;               // recycled TaskNodes (linked through ->right)
+    int freeTaskCount;
+    User **users;                      // users homed here, in creation order
+    int userCount, userCap;
+    int *userIndex;                    // open-addressing table of users[] index + 1
+    int userIndexCap;
+    Roaring allTasks, assignedTasks;
+    TaskClass *statusClasses, *priorityClasses;
+    int statusClassCount, priorityClassCount;
+    TaskNode **schedHeap;              // deadline min-heap
+    int schedCount, schedCap;
+    EngineCond schedWake;
+    EngineThread schedThread;
+    NotifRing notif;
+} Shard;
+
+// ----- Replication log -----
+// While replication is on, every mutating call appends a record to this log
+// while its shard locks are still held. Calls that conflict share a shard lock,
+// so the log order is an order the primary could have run them in, and a
+// follower that applies the records one by one ends up with the same users,
+// tasks, ids and timestamps.
+// An engine that nobody replicates keeps no log at all (REPL_OFF). A primary
+// (replication_enable_api) keeps records only as long as a connected follower
+// still needs them, plus the newest keepBytes; a new follower starts from a
+// snapshot of the whole engine (replog_snapshot_api) and the records after it.
+// A follower only counts lsns (REPL_COUNT), to know where it is.
+//
+// Record (little-endian): u32 size | u64 lsn | i64 time | u8 op | arguments,
+// where an 'i' argument is an i32, 'q' an i64 and 's' a u16 length
+// (0xFFFF for NULL) followed by the bytes. Snapshot records (REC_HELLO to
+// REC_SNAP_END) all carry the lsn the snapshot was taken at.
+enum { REC_HELLO = 1, REC_LOGIN, REC_ADD, REC_EDIT, REC_REMOVE, REC_DELETE, REC_ASSIGN,
+       REC_UNDO, REC_REDO, REC_CLEAR_NOTIF, REC_DUE_FIRE, REC_IMPORT, REC_TEAM, REC_DEP,
+       REC_SNAP_USER, REC_SNAP_TASK, REC_SNAP_SHARD, REC_SNAP_HOLD, REC_SNAP_HOLDERS,
+       REC_SNAP_DEP, REC_SNAP_NOTIF, REC_SNAP_END, REC_OP_COUNT };
+#define REC_HEADER 21
+#define REC_LIST_MAX 60000   // ','/'\n'-separated lists are split into records below this
+
+static const char *recArgs[REC_OP_COUNT] = {
+    [REC_HELLO] = "i",                // shard count: ids only line up between equal builds
+    [REC_LOGIN] = "ss",               // username, password hash ("" for none)
+    [REC_ADD] = "ssissq",             // username, title, priority, due, status, creation number
+    [REC_EDIT] = "sisiss",            // username, id, title, priority, due, status
+    [REC_REMOVE] = "si",
+    [REC_DELETE] = "si",
+    [REC_ASSIGN] = "ssi",             // from, to, id
+    [REC_UNDO] = "s",
+    [REC_REDO] = "s",
+    [REC_CLEAR_NOTIF] = "s",
+    [REC_DUE_FIRE] = "iqi",           // id, time, flip status
+    [REC_IMPORT] = "ssisssq",         // user, title, priority, due, status, '\n'-separated assignees,
+                                      // creation number
+    [REC_TEAM] = "ssi",               // team, user, 1 join / 0 leave
+    [REC_DEP] = "iii",                // task, blocker, 1 add / 0 remove
+    [REC_SNAP_USER] = "ssss",         // username, password hash, undo stack, redo stack (ids, ',')
+    [REC_SNAP_TASK] = "iqsisssi",     // id, creation number, title, priority, due, status,
+                                      // timestamp, due state
+    [REC_SNAP_SHARD] = "ii",          // shard, next id sequence
+    [REC_SNAP_HOLD] = "ss",           // user, ids appended to their task list (',')
+    [REC_SNAP_HOLDERS] = "iis",       // task, position, holders from there on ('\n'), newest first
+    [REC_SNAP_DEP] = "iis",           // task, 0 node / 1 blockers / 2 blocked tasks, ids (',')
+    [REC_SNAP_NOTIF] = "iqss",        // shard, seq, recipient, message
+    [REC_SNAP_END] = "qq",            // creation numbers and notification seqs handed out
+};
+
+enum { REPL_OFF, REPL_COUNT, REPL_KEEP };
+
+typedef struct {
+    EngineMutex lock;                 // leaf lock: taken inside shard locks
+    EngineCond grew;
+    unsigned char *buf;               // records first..lsn
+    size_t len, cap;
+    size_t *offs;                     // offs[l-first]: where record l starts in buf
+    long long lsn, first, offCap;
+    long long retainFrom;             // a follower still needs the records after this
+    long long keepBytes;              // newest bytes kept whatever followers need
+    time_t lastTime;                  // time of the newest record
+} RepLog;
+
+static RepLog replog = { .lock = ENGINE_MUTEX_INIT, .grew = ENGINE_COND_INIT, .first = 1, .retainFrom = LLONG_MAX };
+static atomic_int replMode;              // REPL_OFF / REPL_COUNT / REPL_KEEP
+static int replicaRole = 0;              // follower: only replog_apply_api may mutate
+static THREAD_LOCAL int applying = 0;    // set while this thread applies records
+static THREAD_LOCAL time_t opNow = 0;    // clock of the call being run or applied
+static THREAD_LOCAL unsigned long long opCreated = 0; // creation number a replayed add reuses
+static atomic_ullong tasksCreated;       // creation numbers handed out
+
+// the clock of the current call: latched on first use so the timestamps a call
+// writes and the time stored in its record agree; replay supplies the primary's
+static time_t engine_now(void){
+    if(!opNow) opNow = time(NULL);
+    return opNow;
+}
+
+// followers reject mutating calls unless they come from the log
+static int read_only(void){
+    return replicaRole && !applying;
+}
+
+static size_t rec_size(const char *f, va_list ap){
+    size_t size = REC_HEADER;
+    for(const char *c = f; *c; c++){
+        if(*c == 'i'){ (void)va_arg(ap, int); size += 4; }
+        else if(*c == 'q'){ (void)va_arg(ap, long long); size += 8; }
+        else size += 2 + rec_strlen(va_arg(ap, const char*));
+    }
+    return size;
+}
+
+static void rec_write(unsigned char *p, size_t size, long long lsn, time_t when, int op, va_list ap){
+    put_u(p, size, 4);
+    put_u(p + 4, (unsigned long long)lsn, 8);
+    put_u(p + 12, (unsigned long long)(long long)when, 8);
+    p[20] = (unsigned char)op;
+    p += REC_HEADER;
+    for(const char *c = recArgs[op]; *c; c++){
+        if(*c == 'i'){ put_u(p, (unsigned)va_arg(ap, int), 4); p += 4; }
+        else if(*c == 'q'){ put_u(p, (unsigned long long)va_arg(ap, long long), 8); p += 8; }
+        else p += rec_put_str(p, va_arg(ap, const char*));
+    }
+}
+
+// drop the records no follower needs once they outweigh what is left, so each
+// byte is moved at most once on average (caller holds replog.lock)
+static void replog_trim(void){
+    long long upto = replog.retainFrom < replog.lsn ? replog.retainFrom : replog.lsn;
+    if(upto < replog.first || replog.len <= (size_t)replog.keepBytes) return;
+    size_t keepFrom = replog.len - (size_t)replog.keepBytes;
+    // the newest record l <= upto that ends at or before keepFrom
+    long long lo = replog.first - 1, hi = upto;
+    while(lo < hi){
+        long long mid = lo + (hi - lo + 1) / 2;
+        size_t endOff = mid < replog.lsn ? replog.offs[mid + 1 - replog.first] : replog.len;
+        if(endOff <= keepFrom) lo = mid;
+        else hi = mid - 1;
+    }
+    if(lo < replog.first) return;
+    size_t cut = lo < replog.lsn ? replog.offs[lo + 1 - replog.first] : replog.len;
+    if(cut < replog.len - cut) return;
+    long long dropped = lo + 1 - replog.first;
+    memmove(replog.buf, replog.buf + cut, replog.len - cut);
+    memmove(replog.offs, replog.offs + dropped, (size_t)(replog.lsn - lo) * sizeof(size_t));
+    for(long long i=0;i<replog.lsn - lo;i++) replog.offs[i] -= cut;
+    replog.len -= cut;
+    replog.first = lo + 1;
+    if(replog.cap > 4 * replog.len + 65536){
+        size_t nc = 2 * replog.len + 65536;
+        unsigned char *g = (unsigned char*)realloc(replog.buf, nc);
+        if(g){ replog.buf = g; replog.cap = nc; }
+    }
+}
+
+// append a record with the arguments recArgs[op] describes; returns its lsn, 0 if
+// nothing is logged
+static long long replog_append(int op, ...){
+    long long lsn = 0;
+    va_list ap;
+    if(atomic_load_explicit(&replMode, memory_order_relaxed) == REPL_OFF){
+        if(!applying) opNow = 0;
+        return 0;
+    }
+    va_start(ap, op);
+    size_t size = rec_size(recArgs[op], ap);
+    va_end(ap);
+    mutex_lock(&replog.lock);
+    int keep = atomic_load(&replMode) == REPL_KEEP;
+    if(keep){
+        if(replog.len + size > replog.cap){
+            size_t nc = replog.cap ? replog.cap * 2 : 65536;
+            while(nc < replog.len + size) nc *= 2;
+            unsigned char *g = (unsigned char*)realloc(replog.buf, nc);
+            if(!g) goto out;
+            replog.buf = g;
+            replog.cap = nc;
+        }
+        if(replog.lsn + 1 - replog.first >= replog.offCap){
+            long long nc = replog.offCap ? replog.offCap * 2 : 4096;
+            size_t *g = (size_t*)realloc(replog.offs, nc * sizeof(size_t));
+            if(!g) goto out;
+            replog.offs = g;
+            replog.offCap = nc;
+        }
+    }
+    lsn = ++replog.lsn;
+    replog.lastTime = engine_now();
+    if(keep){
+        replog.offs[lsn - replog.first] = replog.len;
+        va_start(ap, op);
+        rec_write(replog.buf + replog.len, size, lsn, replog.lastTime, op, ap);
+        va_end(ap);
+        replog.len += size;
+        replog_trim();
+    }
+    cond_signal(&replog.grew);
+out:
+    mutex_unlock(&replog.lock);
+    if(!applying) opNow = 0;
+    return lsn;
+}
+
+// decoded arguments of one record: strings and numbers in argument order
+typedef struct {
+    const char *s[6];
+    long long n[4];
+} RecArgs;
+
+// scratch must hold size bytes; returns the op, or 0 if the record is malformed
+static int rec_decode(const unsigned char *p, size_t size, char *scratch, RecArgs *a){
+    const unsigned char *end = p + size;
+    int op = size >= REC_HEADER ? p[20] : 0;
+    int ns = 0, nn = 0;
+    if(op <= 0 || op >= REC_OP_COUNT) return 0;
+    memset(a, 0, sizeof(*a));
+    p += REC_HEADER;
+    for(const char *c = recArgs[op]; *c; c++){
+        if(*c == 'i' || *c == 'q'){
+            int w = *c == 'i' ? 4 : 8;
+            if(end - p < w) return 0;
+            a->n[nn++] = w == 4 ? (long long)(int32_t)get_u(p, 4) : (long long)get_u(p, 8);
+            p += w;
+        } else {
+            if(end - p < 2) return 0;
+            size_t n = (size_t)get_u(p, 2);
+            p += 2;
+            if(n == 0xFFFF){ a->s[ns++] = NULL; continue; }
+            if((size_t)(end - p) < n) return 0;
+            memcpy(scratch, p, n);
+            scratch[n] = 0;
+            a->s[ns++] = scratch;
+            scratch += n + 1;
+            p += n;
+        }
+    }
+    return p == end ? op : 0;
+}
+
 // ----- Global storage -----
-static TaskNode *taskRoot = NULL;      // BST of all tasks (global pool)
-static int nextTaskID = 1;
-static User users[MAX_USERS];
-static int userCount = 0;
+static Shard shards[ENGINE_SHARDS];
+static EngineOnce shardsOnce = ENGINE_ONCE_INIT;
+static atomic_ullong notifSeq;
+
+#define ALL_SHARDS (ENGINE_SHARDS == 64 ? ~0ULL : ((1ULL << ENGINE_SHARDS) - 1))
+#define SHARD_BIT(i) (1ULL << (i))
+
+static void init_shards(void){
+    for(int i=0;i<ENGINE_SHARDS;i++){
+        memset(&shards[i], 0, sizeof(Shard));
+        mutex_init(&shards[i].lock);
+        mutex_init(&shards[i].notif.lock);
+        cond_init(&shards[i].schedWake);
+        shards[i].nextSeq = 1;
+        shards[i].notif.rear = -1;
+    }
+}
+
+static void engine_init(void){ run_once(&shardsOnce, init_shards); }
+
+static uint32_t name_hash(const char *s){
+    uint32_t h = 2166136261u; // FNV-1a
+    while(*s){ h ^= (unsigned char)*s++; h *= 16777619u; }
+    return h;
+}
+
+static int user_shard(const char *username){ return (int)(name_hash(username) % ENGINE_SHARDS); }
+static int task_shard(int id){ return (id > 0 ? id : -id) % ENGINE_SHARDS; }
+
+// take the given shard locks in ascending order (the global lock order)
+static void lock_shards(uint64_t mask){
+    for(int i=0;i<ENGINE_SHARDS;i++) if(mask & SHARD_BIT(i)) mutex_lock(&shards[i].lock);
+}
+
+static void unlock_shards(uint64_t mask){
+    for(int i=ENGINE_SHARDS-1;i>=0;i--) if(mask & SHARD_BIT(i)) mutex_unlock(&shards[i].lock);
+}
+
+// ---------- Metrics ----------
+// Every exported call counts itself and its latency into one of METRIC_STRIPES
+// stripes, picked once per thread, with relaxed atomic adds: no locks, and
+// threads only share a stripe (and its cache lines) once there are more of
+// them than stripes. metrics_api sums the stripes when it is scraped.
+// Latency buckets are powers of two from 1us to 2^(LATENCY_BUCKETS-1)us (~8s).
+#define METRIC_STRIPES 16
+#define LATENCY_BUCKETS 24
+
+enum { API_LOGIN, API_ADD, API_EDIT, API_REMOVE, API_DELETE, API_ASSIGN, API_ASSIGNEES,
+       API_UNDO, API_REDO, API_LIST, API_NOTIFICATIONS, API_MANAGER_TASKS, API_MANAGER_NOTIFICATIONS,
+       API_LIST_USERS, API_SEARCH, API_FILTER, API_QUERY_COUNT, API_QUERY_TASKS, API_ANALYTICS,
+       API_SORT, API_CLEAR_NOTIFICATIONS, API_IMPORT, API_EXPORT, API_REPLOG_READ, API_REPLOG_APPLY,
+       API_TEAM_JOIN, API_TEAM_LEAVE, API_TEAM_MEMBERS, API_AUTO_ASSIGN, API_AUTO_ASSIGN_ALL,
+       API_DEP_ADD, API_DEP_REMOVE, API_DEPS, API_TOPO_ORDER, API_CRITICAL_PATH,
+       API_COUNT };
+
+static const char *apiNames[API_COUNT] = {
+    "login_user_api", "add_task_api", "edit_task_api", "remove_task_api", "delete_task_api",
+    "assign_task_api", "task_assignees_api", "undo_api", "redo_api", "list_tasks_api",
+    "notifications_api", "manager_tasks_api", "manager_notifications_api", "list_users_api",
+    "search_task_api", "filter_task_api", "query_count_api", "query_tasks_api", "analytics_api",
+    "sort_tasks_api", "clear_notifications_api", "import_tasks_api", "export_tasks_api",
+    "replog_read_api", "replog_apply_api", "team_join_api", "team_leave_api", "team_members_api",
+    "auto_assign_api", "auto_assign_all_api", "add_dependency_api", "remove_dependency_api",
+    "task_dependencies_api", "topo_order_api", "critical_path_api",
+};
 
-// Notification queue (circular)
-static char notifQ[MAX_NOTIF][MAX_NOTIF_MSG];
-static int notifFront = 0, notifRear = -1, notifCount = 0;
+typedef struct {
+    atomic_ullong calls[API_COUNT];
+    atomic_ullong nanos[API_COUNT];
+    atomic_ullong buckets[API_COUNT][LATENCY_BUCKETS + 1]; // last one: slower than every bound
+} MetricStripe;
+
+static MetricStripe metricStripes[METRIC_STRIPES];
+static atomic_uint nextStripe;
+static THREAD_LOCAL int myStripe = -1;
+
+// rare events, counted globally
+static atomic_ullong notifDropped;     // oldest notification overwritten by a full ring
+static atomic_ullong undoOverflows;    // undo entries lost to a full stack
+static atomic_ullong redoOverflows;
+static atomic_ullong jsonTruncations;  // JSON results cut short by their buffer
+static atomic_ullong traceDropped;     // trace records lost to a full capture buffer
+
+static void metric_count(atomic_ullong *c){ atomic_fetch_add_explicit(c, 1, memory_order_relaxed); }
+
+typedef struct {
+    int api;
+    long long start;
+} MetricTimer;
+
+static MetricTimer metric_start(int api){
+    MetricTimer t = { api, mono_ns() };
+    return t;
+}
+
+static void metric_stop(MetricTimer *t){
+    long long ns = mono_ns() - t->start;
+    if(myStripe < 0) myStripe = (int)(atomic_fetch_add(&nextStripe, 1) % METRIC_STRIPES);
+    MetricStripe *st = &metricStripes[myStripe];
+    int b = 0;
+    for(long long bound = 1000; b < LATENCY_BUCKETS && ns > bound; bound <<= 1) b++;
+    atomic_fetch_add_explicit(&st->calls[t->api], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&st->nanos[t->api], (unsigned long long)ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&st->buckets[t->api][b], 1, memory_order_relaxed);
+}
+
+// METERED(api) at the top of an exported function times it up to whichever return it takes
+#if defined(__GNUC__)
+#define METERED(api) MetricTimer metricTimer __attribute__((cleanup(metric_stop))) = metric_start(api)
+#else
+#define METERED(api) ((void)0) // no scope-exit hook: calls go unmetered
+#endif
 
 // ---------- Utility ----------
 static void currentTimeStr(char *buf, int n) {
-    time_t t = time(NULL);
-    struct tm tm = *localtime(&t);
-    snprintf(buf, n, "%04d-%02d-%02d %02d:%02d:%02d",
-             tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday,
-             tm.tm_hour, tm.tm_min, tm.tm_sec);
+    // formatted once per second and thread: a bulk import stamps millions of tasks
+    static THREAD_LOCAL time_t last = -1;
+    static THREAD_LOCAL char text[32];
+    time_t now = engine_now();
+    if(now != last){
+        struct tm tm;
+        local_tm(now, &tm);
+        snprintf(text, sizeof(text), "%04d-%02d-%02d %02d:%02d:%02d",
+                 tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday,
+                 tm.tm_hour, tm.tm_min, tm.tm_sec);
+        last = now;
+    }
+    snprintf(buf, n, "%s", text);
+}
+
+// SHA-256 (FIPS 180-4), for password_hash
+static void sha256(const unsigned char *data, size_t len, unsigned char out[32]){
+    static const uint32_t k[64] = {
+        0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+        0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+        0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+        0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+        0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+        0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+        0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+        0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2 };
+    uint32_t h[8] = { 0x6a09e667,0xbb67ae85,0x3c6ef372,0xa54ff53a,0x510e527f,0x9b05688c,0x1f83d9ab,0x5be0cd19 };
+    #define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+    size_t total = (len + 9 + 63) / 64 * 64; // data, 0x80, zeros, 64-bit bit length
+    for(size_t done = 0; done < total; done += 64){
+        unsigned char block[64];
+        for(int i=0;i<64;i++){
+            size_t at = done + i;
+            if(at < len) block[i] = data[at];
+            else if(at == len) block[i] = 0x80;
+            else if(at >= total - 8) block[i] = (unsigned char)((uint64_t)len * 8 >> (8 * (total - 1 - at)));
+            else block[i] = 0;
+        }
+        uint32_t w[64], v[8];
+        for(int i=0;i<16;i++) w[i] = (uint32_t)block[4*i] << 24 | (uint32_t)block[4*i+1] << 16 | (uint32_t)block[4*i+2] << 8 | block[4*i+3];
+        for(int i=16;i<64;i++){
+            uint32_t s0 = ROR(w[i-15], 7) ^ ROR(w[i-15], 18) ^ (w[i-15] >> 3);
+            uint32_t s1 = ROR(w[i-2], 17) ^ ROR(w[i-2], 19) ^ (w[i-2] >> 10);
+            w[i] = w[i-16] + s0 + w[i-7] + s1;
+        }
+        memcpy(v, h, sizeof(v));
+        for(int i=0;i<64;i++){
+            uint32_t t1 = v[7] + (ROR(v[4], 6) ^ ROR(v[4], 11) ^ ROR(v[4], 25)) + ((v[4] & v[5]) ^ (~v[4] & v[6])) + k[i] + w[i];
+            uint32_t t2 = (ROR(v[0], 2) ^ ROR(v[0], 13) ^ ROR(v[0], 22)) + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+            memmove(v + 1, v, 7 * sizeof(uint32_t));
+            v[4] += t1;
+            v[0] = t1 + t2;
+        }
+        for(int i=0;i<8;i++) h[i] += v[i];
+    }
+    #undef ROR
+    for(int i=0;i<32;i++) out[i] = (unsigned char)(h[i/4] >> (24 - 8 * (i % 4)));
+}
+
+// what the engine keeps and replicates instead of a password: hex SHA-256 of
+// "username:password" (the username salts it)
+static void password_hash(const char *username, const char *password, char out[65]){
+    char text[MAX_USERNAME + 1024];
+    unsigned char d[32];
+    int n = snprintf(text, sizeof(text), "%s:%s", username, password);
+    sha256((const unsigned char*)text, n < (int)sizeof(text) ? (size_t)n : sizeof(text) - 1, d);
+    for(int i=0;i<32;i++) snprintf(out + 2*i, 3, "%02x", d[i]);
+}
+
+// "YYYY-MM-DD" (due at the end of that day) or "YYYY-MM-DD HH:MM[:SS]", local time
+static time_t parse_due(const char *s){
+    int y, mo, d, h = 23, mi = 59, sec = 59;
+    if(!s || sscanf(s, "%d-%d-%d", &y, &mo, &d) != 3) return 0;
+    if(strlen(s) > 11 && (s[10] == ' ' || s[10] == 'T')){
+        sec = 0;
+        if(sscanf(s + 11, "%d:%d:%d", &h, &mi, &sec) < 2) return 0;
+    }
+    // mktime re-reads the time zone on every call and bulk loads repeat the same days:
+    // remember each day's local midnight and add the time of day, unless DST changes that day
+    static THREAD_LOCAL struct { int y, mo, d, plain; time_t midnight; } memo[1024];
+    unsigned slot = ((unsigned)(y * 372 + mo * 31 + d) * 2654435761u) >> 22;
+    struct tm tm;
+    if(memo[slot].y != y || memo[slot].mo != mo || memo[slot].d != d){
+        memset(&tm, 0, sizeof(tm));
+        tm.tm_year = y - 1900;
+        tm.tm_mon = mo - 1;
+        tm.tm_mday = d;
+        tm.tm_isdst = -1;
+        time_t midnight = mktime(&tm);
+        memset(&tm, 0, sizeof(tm));
+        tm.tm_year = y - 1900;
+        tm.tm_mon = mo - 1;
+        tm.tm_mday = d + 1;
+        tm.tm_isdst = -1;
+        time_t next = mktime(&tm);
+        memo[slot].y = y;
+        memo[slot].mo = mo;
+        memo[slot].d = d;
+        memo[slot].midnight = midnight;
+        memo[slot].plain = midnight != (time_t)-1 && next - midnight == 24*60*60;
+    }
+    if(memo[slot].plain) return memo[slot].midnight + h*3600 + mi*60 + sec;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = y - 1900;
+    tm.tm_mon = mo - 1;
+    tm.tm_mday = d;
+    tm.tm_hour = h;
+    tm.tm_min = mi;
+    tm.tm_sec = sec;
+    tm.tm_isdst = -1;
+    time_t t = mktime(&tm);
+    return t == (time_t)-1 ? 0 : t;
 }
 
-static void enqueueNotif(const char *msg){
-    if(notifCount >= MAX_NOTIF) {
+// to == NULL broadcasts; a user's messages go to the ring of their home shard
+static void enqueueShardNotif(Shard *s, const char *to, const char *msg){
+    NotifRing *q = &s->notif;
+    mutex_lock(&q->lock);
+    if(q->count >= MAX_NOTIF) {
         // drop oldest
-        notifFront = (notifFront + 1) % MAX_NOTIF;
-        notifCount--;
-    }
-    notifRear = (notifRear + 1) % MAX_NOTIF;
-    strncpy(notifQ[notifRear], msg, MAX_NOTIF_MSG-1);
-    notifQ[notifRear][MAX_NOTIF_MSG-1] = 0;
-    notifCount++;
-}
-
-static const char* dequeueAllNotifsJSON(){
-    static char buf[JSON_BUF];
-    buf[0]=0;
-    strcat(buf,"[");
-    int first = 1;
-    for(int i=0, idx=notifFront; i<notifCount; i++, idx=(idx+1)%MAX_NOTIF){
-        if(!first) strcat(buf,",");
-        first = 0;
+        metric_count(&notifDropped);
+        q->front = (q->front + 1) % MAX_NOTIF;
+        q->count--;
+    }
+    q->rear = (q->rear + 1) % MAX_NOTIF;
+    strncpy(q->msg[q->rear], msg, MAX_NOTIF_MSG-1);
+    q->msg[q->rear][MAX_NOTIF_MSG-1] = 0;
+    strncpy(q->to[q->rear], to?to:"", MAX_USERNAME-1);
+    q->to[q->rear][MAX_USERNAME-1] = 0;
+    q->seq[q->rear] = atomic_fetch_add(&notifSeq, 1);
+    q->count++;
+    mutex_unlock(&q->lock);
+}
+
+static void enqueueUserNotif(const char *to, const char *msg){
+    enqueueShardNotif(&shards[user_shard(to)], to, msg);
+}
+
+// username == NULL returns every notification (manager view), otherwise
+// broadcasts plus the ones addressed to that user. Rings are merged by seq.
+static const char* dequeueAllNotifsJSON(const char *username){
+    static THREAD_LOCAL char buf[JSON_BUF];
+    int pos[ENGINE_SHARDS];
+    int len = 1;
+    for(int i=0;i<ENGINE_SHARDS;i++){
+        mutex_lock(&shards[i].notif.lock);
+        pos[i] = 0;
+    }
+    buf[0] = '[';
+    for(;;){
+        // pick the ring whose next matching entry is oldest
+        int best = -1, bestIdx = 0;
+        for(int i=0;i<ENGINE_SHARDS;i++){
+            NotifRing *q = &shards[i].notif;
+            while(pos[i] < q->count){
+                int idx = (q->front + pos[i]) % MAX_NOTIF;
+                if(!username || !q->to[idx][0] || strcmp(q->to[idx], username)==0) break;
+                pos[i]++;
+            }
+            if(pos[i] >= q->count) continue;
+            int idx = (q->front + pos[i]) % MAX_NOTIF;
+            if(best < 0 || q->seq[idx] < shards[best].notif.seq[bestIdx]){
+                best = i;
+                bestIdx = idx;
+            }
+        }
+        if(best < 0) break;
+        pos[best]++;
         char tmp[512];
-        snprintf(tmp, sizeof(tmp), "\"%s\"", notifQ[idx]);
-        strcat(buf, tmp);
+        int n = snprintf(tmp, sizeof(tmp), "%s\"%s\"", len > 1 ? "," : "", shards[best].notif.msg[bestIdx]);
+        if(len + n + 2 > JSON_BUF){ metric_count(&jsonTruncations); break; }
+        memcpy(buf + len, tmp, n);
+        len += n;
     }
-    strcat(buf,"]");
+    for(int i=ENGINE_SHARDS-1;i>=0;i--) mutex_unlock(&shards[i].notif.lock);
+    buf[len++] = ']';
+    buf[len] = 0;
     return buf;
 }
 
-// ---------- User management ----------
+// Bounded JSON array writer: appends whole elements only and stops (setting
+// truncated) once the next one would not fit, instead of overrunning buf.
+typedef struct {
+    char *buf;
+    int len, cap;
+    int truncated;
+} JsonOut;
+
+static void json_begin(JsonOut *o, char *buf, int cap){
+    o->buf = buf;
+    o->cap = cap;
+    o->len = 1;
+    o->truncated = 0;
+    buf[0] = '[';
+    buf[1] = 0;
+}
+
+// append one pre-formatted element; returns 0 once the buffer is full
+static int json_raw(JsonOut *o, const char *elem, int n){
+    if(o->truncated) return 0;
+    if(o->len + n + 3 > o->cap){ // comma plus room for "]"
+        o->truncated = 1;
+        metric_count(&jsonTruncations);
+        return 0;
+    }
+    if(o->len > 1) o->buf[o->len++] = ',';
+    memcpy(o->buf + o->len, elem, n);
+    o->len += n;
+    return 1;
+}
+
+static int format_task(char *tmp, int size, const TaskNode *t, int withTime){
+    int n;
+    if(withTime)
+        n = snprintf(tmp, size, "{\"id\":%d,\"title\":\"%s\",\"priority\":%d,\"due\":\"%s\",\"status\":\"%s\",\"time\":\"%s\"}",
+                     t->id, t->title, t->priority, t->dueDate, t->status, t->timestamp);
+    else
+        n = snprintf(tmp, size, "{\"id\":%d,\"title\":\"%s\",\"priority\":%d,\"due\":\"%s\",\"status\":\"%s\"}",
+                     t->id, t->title, t->priority, t->dueDate, t->status);
+    return n < size ? n : size - 1;
+}
+
+// returns 0 once the buffer is full so callers can stop iterating
+static int json_task(JsonOut *o, const TaskNode *t, int withTime){
+    char tmp[512];
+    int n = format_task(tmp, sizeof(tmp), t, withTime);
+    return json_raw(o, tmp, n);
+}
+
+static const char* json_end(JsonOut *o){
+    o->buf[o->len++] = ']';
+    o->buf[o->len] = 0;
+    return o->buf;
+}
+
+// ---------- User management (caller holds the user's shard lock) ----------
 static User* findUser(const char* username){
     if(!username) return NULL;
-    for(int i=0;i<userCount;i++){
-        if(strcmp(users[i].username, username)==0) return &users[i];
+    uint32_t h = name_hash(username);
+    Shard *s = &shards[h % ENGINE_SHARDS];
+    if(!s->userIndexCap) return NULL;
+    for(uint32_t i = (h / ENGINE_SHARDS) & (s->userIndexCap - 1); s->userIndex[i]; i = (i + 1) & (s->userIndexCap - 1)){
+        User *u = s->users[s->userIndex[i] - 1];
+        if(strcmp(u->username, username)==0) return u;
     }
     return NULL;
 }
 
+static int user_index_insert(Shard *s, int slot){
+    uint32_t h = name_hash(s->users[slot]->username);
+    uint32_t i = (h / ENGINE_SHARDS) & (s->userIndexCap - 1);
+    while(s->userIndex[i]) i = (i + 1) & (s->userIndexCap - 1);
+    s->userIndex[i] = slot + 1;
+    return 1;
+}
+
 static User* createOrGetUser(const char* username){
+    if(!username) return NULL;
     User *u = findUser(username);
     if(u) return u;
-    if(userCount >= MAX_USERS) return NULL;
-    strncpy(users[userCount].username, username, MAX_USERNAME-1);
-    users[userCount].username[MAX_USERNAME-1]=0;
-    users[userCount].password[0]=0;
-    users[userCount].head = users[userCount].tail = NULL;
-    users[userCount].undoTop = users[userCount].redoTop = 0;
-    return &users[userCount++];
-}
-
-// ---------- BST operations (global tasks) ----------
-static TaskNode* createTaskNode(int id, const char* title, int priority, const char* due, const char* status){
-    TaskNode *n = (TaskNode*)malloc(sizeof(TaskNode));
+    Shard *s = &shards[user_shard(username)];
+    if(s->userCount == s->userCap){
+        int nc = s->userCap ? s->userCap * 2 : 16;
+        User **g = (User**)realloc(s->users, nc * sizeof(User*));
+        if(!g) return NULL;
+        s->users = g;
+        s->userCap = nc;
+    }
+    if((s->userCount + 1) * 2 > s->userIndexCap){
+        // keep the index at most half full
+        int nc = s->userIndexCap ? s->userIndexCap * 2 : 32;
+        int *g = (int*)calloc(nc, sizeof(int));
+        if(!g) return NULL;
+        free(s->userIndex);
+        s->userIndex = g;
+        s->userIndexCap = nc;
+        for(int i=0;i<s->userCount;i++) user_index_insert(s, i);
+    }
+    u = (User*)calloc(1, sizeof(User));
+    if(!u) return NULL;
+    strncpy(u->username, username, MAX_USERNAME-1);
+    u->shard = (int)(s - shards);
+    s->users[s->userCount] = u;
+    user_index_insert(s, s->userCount++);
+    return u;
+}
+
+// ---------- BST operations (per-shard tasks) ----------
+static unsigned nextHeapKey(void){
+    static THREAD_LOCAL unsigned s = 2463534242u; // xorshift32
+    s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+    return s;
+}
+
+#define CREATED_LATER ULLONG_MAX     // createTaskNode: the caller numbers the task itself
+
+// a task's place in creation order: c, which a follower takes from the primary's
+// record, or the next one when c is 0
+static unsigned long long take_created(unsigned long long c){
+    unsigned long long have;
+    if(!c) return atomic_fetch_add(&tasksCreated, 1) + 1;
+    have = atomic_load(&tasksCreated);
+    while(have < c && !atomic_compare_exchange_weak(&tasksCreated, &have, c)) {}
+    return c;
+}
+
+// created: see take_created, or CREATED_LATER to leave the task unnumbered (0)
+static TaskNode* createTaskNode(Shard *s, const char* title, int priority, const char* due, const char* status, unsigned long long created){
+    TaskNode *n;
+    if(s->freeTasks){
+        n = s->freeTasks;
+        s->freeTasks = n->right;
+        s->freeTaskCount--;
+    } else {
+        n = (TaskNode*)malloc(sizeof(TaskNode));
+    }
     if(!n) return NULL;
-    n->id = id;
+    n->id = s->nextSeq++ * ENGINE_SHARDS + (int)(s - shards);
+    n->created = created == CREATED_LATER ? 0 : take_created(created);
     strncpy(n->title, title?title:"", sizeof(n->title)-1);
     n->title[sizeof(n->title)-1]=0;
     n->priority = priority;
@@ -136,381 +1250,4097 @@ static TaskNode* createTaskNode(int id, const char* title, int priority, const c
     strncpy(n->status, status?status:"", sizeof(n->status)-1);
     n->status[sizeof(n->status)-1]=0;
     currentTimeStr(n->timestamp, sizeof(n->timestamp));
+    n->heapKey = nextHeapKey();
+    n->assignees = NULL;
+    n->assigneeCount = 0;
+    n->dueAt = parse_due(n->dueDate);
+    n->dueState = 0;
+    n->schedIdx = -1;
+    n->dep = NULL;
     n->left = n->right = NULL;
+    s->liveTaskCount++;
     return n;
 }
 
+// return a deleted node to the shard's pool; beyond TASK_POOL_MAX give it back to the allocator
+static void releaseTaskNode(Shard *s, TaskNode *n){
+    s->liveTaskCount--;
+    if(s->freeTaskCount >= TASK_POOL_MAX){
+        free(n);
+        return;
+    }
+    n->left = NULL;
+    n->right = s->freeTasks;
+    s->freeTasks = n;
+    s->freeTaskCount++;
+}
+
+static TaskNode* rotateRight(TaskNode *n){
+    TaskNode *l = n->left;
+    n->left = l->right;
+    l->right = n;
+    return l;
+}
+
+static TaskNode* rotateLeft(TaskNode *n){
+    TaskNode *r = n->right;
+    n->right = r->left;
+    r->left = n;
+    return r;
+}
+
 static TaskNode* bst_insert(TaskNode* root, TaskNode* node){
     if(!root) return node;
-    if(node->id < root->id) root->left = bst_insert(root->left, node);
-    else root->right = bst_insert(root->right, node);
+    if(node->id < root->id){
+        root->left = bst_insert(root->left, node);
+        if(root->left->heapKey > root->heapKey) root = rotateRight(root);
+    } else {
+        root->right = bst_insert(root->right, node);
+        if(root->right->heapKey > root->heapKey) root = rotateLeft(root);
+    }
     return root;
 }
 
 static TaskNode* bst_search(TaskNode* root, int id){
+    while(root && root->id != id)
+        root = (id < root->id) ? root->left : root->right;
+    return root;
+}
+
+// join two treaps where every id in a is smaller than every id in b
+static TaskNode* bst_merge(TaskNode *a, TaskNode *b){
+    if(!a) return b;
+    if(!b) return a;
+    if(a->heapKey > b->heapKey){
+        a->right = bst_merge(a->right, b);
+        return a;
+    }
+    b->left = bst_merge(a, b->left);
+    return b;
+}
+
+// unlink the node with this id; the detached node is returned through *out
+static TaskNode* bst_delete(TaskNode* root, int id, TaskNode **out){
     if(!root) return NULL;
-    if(root->id == id) return root;
-    if(id < root->id) return bst_search(root->left, id);
-    return bst_search(root->right, id);
+    if(id < root->id) root->left = bst_delete(root->left, id, out);
+    else if(id > root->id) root->right = bst_delete(root->right, id, out);
+    else {
+        *out = root;
+        TaskNode *rest = bst_merge(root->left, root->right);
+        root->left = root->right = NULL;
+        return rest;
+    }
+    return root;
 }
 
-// in-order traversal that appends JSON of all tasks
-static void bst_all_tasks_json(TaskNode* root, char *buf, int *first) {
-    if(!root) return;
-    bst_all_tasks_json(root->left, buf, first);
-    char tmp[512];
-    if(!(*first)) strcat(buf, ",");
-    *first = 0;
-    snprintf(tmp, sizeof(tmp),
-        "{\"id\":%d,\"title\":\"%s\",\"priority\":%d,\"due\":\"%s\",\"status\":\"%s\",\"time\":\"%s\"}",
-        root->id, root->title, root->priority, root->dueDate, root->status, root->timestamp);
-    strcat(buf, tmp);
-    bst_all_tasks_json(root->right, buf, first);
+// caller holds the lock of the task's shard
+static TaskNode* task_lookup(int id){
+    return bst_search(shards[task_shard(id)].taskRoot, id);
 }
 
-// ---------- Per-user DLL list helpers ----------
-static TaskDLL* makeDLLNode(TaskNode *task){
-    TaskDLL *n = (TaskDLL*)malloc(sizeof(TaskDLL));
-    n->task = task;
-    n->prev = n->next = NULL;
-    return n;
+static Shard* shard_of(const TaskNode *t){
+    return &shards[task_shard(t->id)];
 }
 
-static void user_add_taskdll(User *u, TaskNode *task){
-    if(!u || !task) return;
-    // check if already assigned
-    TaskDLL *iter = u->head;
-    while(iter){
-        if(iter->task == task) return; // already assigned
-        iter = iter->next;
-    }
-    TaskDLL *nd = makeDLLNode(task);
-    if(!u->head){
-        u->head = u->tail = nd;
-    } else {
-        u->tail->next = nd;
-        nd->prev = u->tail;
-        u->tail = nd;
-    }
+// ---------- Status / priority set indexes (per shard) ----------
+static Roaring* status_set(Shard *sh, const char *status, int create){
+    for(int i=0;i<sh->statusClassCount;i++)
+        if(strcmp(sh->statusClasses[i].status, status)==0) return &sh->statusClasses[i].set;
+    if(!create) return NULL;
+    TaskClass *g = (TaskClass*)realloc(sh->statusClasses, (sh->statusClassCount+1) * sizeof(TaskClass));
+    if(!g) return NULL;
+    sh->statusClasses = g;
+    TaskClass *c = &sh->statusClasses[sh->statusClassCount++];
+    memset(c, 0, sizeof(*c));
+    strncpy(c->status, status, sizeof(c->status)-1);
+    return &c->set;
 }
 
-static int user_remove_taskdll_byid(User *u, int id){
-    if(!u) return 0;
-    TaskDLL *iter = u->head;
-    while(iter){
-        if(iter->task->id == id){
-            if(iter->prev) iter->prev->next = iter->next;
-            else u->head = iter->next;
-            if(iter->next) iter->next->prev = iter->prev;
-            else u->tail = iter->prev;
-            free(iter);
-            return 1;
-        }
-        iter = iter->next;
-    }
-    return 0;
+static Roaring* priority_set(Shard *sh, int priority, int create){
+    for(int i=0;i<sh->priorityClassCount;i++)
+        if(sh->priorityClasses[i].priority == priority) return &sh->priorityClasses[i].set;
+    if(!create) return NULL;
+    TaskClass *g = (TaskClass*)realloc(sh->priorityClasses, (sh->priorityClassCount+1) * sizeof(TaskClass));
+    if(!g) return NULL;
+    sh->priorityClasses = g;
+    TaskClass *c = &sh->priorityClasses[sh->priorityClassCount++];
+    memset(c, 0, sizeof(*c));
+    c->priority = priority;
+    return &c->set;
 }
 
-// build JSON of a user's tasks (from their DLL)
-static void user_tasks_to_json(User *u, char *buf) {
-    buf[0]=0;
-    strcat(buf,"[");
-    TaskDLL *it = u->head;
-    int first = 1;
-    while(it){
-        char tmp[512];
-        if(!first) strcat(buf,",");
-        first = 0;
-        snprintf(tmp, sizeof(tmp),
-            "{\"id\":%d,\"title\":\"%s\",\"priority\":%d,\"due\":\"%s\",\"status\":\"%s\",\"time\":\"%s\"}",
-            it->task->id, it->task->title, it->task->priority, it->task->dueDate, it->task->status, it->task->timestamp);
-        strcat(buf,tmp);
-        it = it->next;
+static void index_task(TaskNode *t){
+    Shard *sh = shard_of(t);
+    rb_add(&sh->allTasks, t->id);
+    Roaring *s = status_set(sh, t->status, 1);
+    if(s) rb_add(s, t->id);
+    s = priority_set(sh, t->priority, 1);
+    if(s) rb_add(s, t->id);
+}
+
+// move a task between class sets after its status or priority changed
+static void reindex_task(TaskNode *t, const char *oldStatus, int oldPriority){
+    Shard *sh = shard_of(t);
+    if(strcmp(oldStatus, t->status)!=0){
+        Roaring *s = status_set(sh, oldStatus, 0);
+        if(s) rb_remove(s, t->id);
+        s = status_set(sh, t->status, 1);
+        if(s) rb_add(s, t->id);
+    }
+    if(oldPriority != t->priority){
+        Roaring *s = priority_set(sh, oldPriority, 0);
+        if(s) rb_remove(s, t->id);
+        s = priority_set(sh, t->priority, 1);
+        if(s) rb_add(s, t->id);
     }
-    strcat(buf,"]");
 }
 
-// ---------- Undo/Redo simple helpers ----------
-static void user_push_undo(User *u, int taskID){
-    if(!u) return;
-    if(u->undoTop < 128) u->undoStack[u->undoTop++] = taskID;
+static void unindex_task(TaskNode *t){
+    Shard *sh = shard_of(t);
+    rb_remove(&sh->allTasks, t->id);
+    Roaring *s = status_set(sh, t->status, 0);
+    if(s) rb_remove(s, t->id);
+    s = priority_set(sh, t->priority, 0);
+    if(s) rb_remove(s, t->id);
 }
 
-static int user_pop_undo(User *u){
-    if(!u || u->undoTop==0) return -1;
+// ---------- Teams and per-user load ----------
+// A user's load is the summed task_weight of the tasks they hold. It changes
+// only where holdings or a task's status/priority change (user_add_taskdll,
+// unlinkDLLNode, views_detach/views_attach), always under the user's shard
+// lock, and each change re-sifts the user's entry in every team heap they are
+// in: O(teams x log members) per update.
+static Team **teams = NULL;
+static int teamCount = 0, teamCap = 0;
+static EngineMutex teamsLock = ENGINE_MUTEX_INIT; // leaf lock over the registry; teams are never freed
+
+// open tasks weigh 3/2/1 for priority 1 (high) / 2 / 3 and lower; closed ones nothing
+static int task_weight(const TaskNode *t){
+    if(strcmp(t->status, CLOSED_STATUS)==0) return 0;
+    return t->priority <= 1 ? 3 : t->priority == 2 ? 2 : 1;
+}
+
+static int member_less(const TeamMember *a, const TeamMember *b){
+    return a->load != b->load ? a->load < b->load : a->seq < b->seq;
+}
+
+static void team_set(Team *tm, int i, TeamMember *m){
+    tm->heap[i] = m;
+    m->pos = i;
+}
+
+// restore the heap around position i (caller holds tm->lock)
+static void team_sift(Team *tm, int i){
+    TeamMember *m = tm->heap[i];
+    while(i > 0 && member_less(m, tm->heap[(i-1)/2])){
+        team_set(tm, i, tm->heap[(i-1)/2]);
+        i = (i-1)/2;
+    }
+    for(;;){
+        int c = 2*i + 1;
+        if(c >= tm->count) break;
+        if(c + 1 < tm->count && member_less(tm->heap[c+1], tm->heap[c])) c++;
+        if(!member_less(tm->heap[c], m)) break;
+        team_set(tm, i, tm->heap[c]);
+        i = c;
+    }
+    team_set(tm, i, m);
+}
+
+// caller holds u's shard lock
+static void user_load_add(User *u, long long delta){
+    if(!delta) return;
+    u->load += delta;
+    for(int i=0;i<u->teamCount;i++){
+        TeamMember *m = u->teams[i];
+        mutex_lock(&m->team->lock);
+        m->load = u->load;
+        team_sift(m->team, m->pos);
+        mutex_unlock(&m->team->lock);
+    }
+}
+
+// sign = -1 before a task's status/priority change, +1 after (caller holds its holders' shards)
+static void holders_load_add(TaskNode *t, int sign){
+    int w = task_weight(t);
+    for(TaskDLL *it = w ? t->assignees : NULL; it; it = it->tnext) user_load_add(it->owner, sign * w);
+}
+
+static Team* find_team(const char *name, int create){
+    char key[MAX_USERNAME];
+    Team *tm = NULL;
+    snprintf(key, sizeof(key), "%s", name);
+    mutex_lock(&teamsLock);
+    for(int i=0;i<teamCount && !tm;i++)
+        if(strcmp(teams[i]->name, key)==0) tm = teams[i];
+    if(!tm && create && teamCount == teamCap){
+        int nc = teamCap ? teamCap * 2 : 8;
+        Team **g = (Team**)realloc(teams, nc * sizeof(Team*));
+        if(g){ teams = g; teamCap = nc; }
+    }
+    if(!tm && create && teamCount < teamCap && (tm = (Team*)calloc(1, sizeof(Team))) != NULL){
+        strcpy(tm->name, key);
+        mutex_init(&tm->lock);
+        teams[teamCount++] = tm;
+    }
+    mutex_unlock(&teamsLock);
+    return tm;
+}
+
+// index of u's membership in tm, -1 if none (caller holds u's shard lock)
+static int user_team_slot(const User *u, const Team *tm){
+    for(int i=0;i<u->teamCount;i++) if(u->teams[i]->team == tm) return i;
+    return -1;
+}
+
+// least-loaded member that is not one of skip[]: a best-first walk from the
+// root, which visits at most nskip + 1 members (caller holds tm->lock)
+static TeamMember* team_pick(Team *tm, User **skip, int nskip){
+    TeamMember *found = NULL;
+    int n = 0;
+    int *front = (int*)malloc((nskip + 2) * sizeof(int));
+    if(!front) return NULL;
+    if(tm->count) front[n++] = 0;
+    while(n && !found){
+        int b = 0;
+        for(int i=1;i<n;i++) if(member_less(tm->heap[front[i]], tm->heap[front[b]])) b = i;
+        int i = front[b];
+        front[b] = front[--n];
+        TeamMember *m = tm->heap[i];
+        int held = 0;
+        for(int k=0;k<nskip && !held;k++) held = skip[k] == m->u;
+        if(!held) found = m;
+        if(2*i + 1 < tm->count) front[n++] = 2*i + 1;
+        if(2*i + 2 < tm->count) front[n++] = 2*i + 2;
+    }
+    free(front);
+    return found;
+}
+
+// ---------- Task dependencies ----------
+// "B blocks on A" is an edge A -> B between the two tasks' DepNodes, created
+// on a task's first edge and kept until it is deleted. The graph lives under
+// one leaf lock because edges cross shards; each node mirrors whether its task
+// is Completed, so readiness never has to look at a task under another lock.
+// - open counts a node's blockers that are not Completed; depBlocked holds the
+//   ids with open > 0 and changes only when an edge or a blocker's status does.
+// - depOrder keeps every node in a topological order, maintained on insert
+//   the Pearce-Kelly way: an edge that already points forward costs nothing,
+//   otherwise only the nodes ordered between its ends are searched (finding a
+//   cycle there) and re-slotted.
+// - chain/via cache the longest chain of open tasks ending at a node. A change
+//   marks the node and everything downstream dirty, and a query recomputes
+//   just the dirty nodes it reaches, in depOrder order. A clean node only has
+//   clean blockers, so marking stops at the first node that is already dirty.
+typedef struct DepNode {
+    int id;
+    int done;                    // task status is CLOSED_STATUS
+    int open;                    // blockers not done
+    int ord;                     // slot in depOrder: after every blocker
+    struct DepNode **blockers;   // tasks this one waits on
+    int nBlockers, capBlockers;
+    struct DepNode **blocks;     // tasks waiting on this one
+    int nBlocks, capBlocks;
+    int chain;                   // open tasks on the longest open chain ending here, 0 if done
+    struct DepNode *via;         // blocker that chain runs through
+    int dirty;
+    unsigned mark;               // visit stamp
+} DepNode;
+
+static EngineMutex depLock = ENGINE_MUTEX_INIT; // leaf lock: taken inside shard locks
+static DepNode **depOrder = NULL;               // by ord; NULL where a deleted task's node was
+static int depOrderLen = 0, depOrderCap = 0;
+static int depLive = 0;                         // nodes in depOrder that are not NULL
+static Roaring depBlocked;                      // tasks with an open blocker
+static unsigned depStamp = 0;
+
+static int dep_push(DepNode ***arr, int *n, int *cap, DepNode *x){
+    if(*n == *cap){
+        int nc = *cap ? *cap * 2 : 4;
+        DepNode **g = (DepNode**)realloc(*arr, nc * sizeof(DepNode*));
+        if(!g) return 0;
+        *arr = g;
+        *cap = nc;
+    }
+    (*arr)[(*n)++] = x;
+    return 1;
+}
+
+static int dep_unlink(DepNode **arr, int *n, DepNode *x){
+    for(int i=0;i<*n;i++) if(arr[i] == x){ arr[i] = arr[--*n]; return 1; }
+    return 0;
+}
+
+// t's node, created on first use (caller holds t's shard lock and depLock)
+static DepNode* dep_node(TaskNode *t){
+    if(t->dep) return t->dep;
+    if(depOrderLen == depOrderCap){
+        int nc = depOrderCap ? depOrderCap * 2 : 64;
+        DepNode **g = (DepNode**)realloc(depOrder, nc * sizeof(DepNode*));
+        if(!g) return NULL;
+        depOrder = g;
+        depOrderCap = nc;
+    }
+    DepNode *n = (DepNode*)calloc(1, sizeof(DepNode));
+    if(!n) return NULL;
+    n->id = t->id;
+    n->done = strcmp(t->status, CLOSED_STATUS)==0;
+    n->ord = depOrderLen;
+    n->dirty = 1;
+    depOrder[depOrderLen++] = n;
+    depLive++;
+    t->dep = n;
+    return n;
+}
+
+static void dep_open_add(DepNode *n, int delta){
+    n->open += delta;
+    if(delta > 0 && n->open == delta) rb_add(&depBlocked, n->id);
+    else if(delta < 0 && n->open == 0) rb_remove(&depBlocked, n->id);
+}
+
+// mark n and everything downstream of it dirty
+static void dep_touch(DepNode *n){
+    if(n->dirty) return;
+    DepNode **st = (DepNode**)malloc(depOrderLen * sizeof(DepNode*));
+    int sp = 0;
+    n->dirty = 1;
+    if(!st){
+        // cannot walk: conservatively dirty the whole graph
+        for(int i=0;i<depOrderLen;i++) if(depOrder[i]) depOrder[i]->dirty = 1;
+        return;
+    }
+    st[sp++] = n;
+    while(sp){
+        DepNode *x = st[--sp];
+        for(int i=0;i<x->nBlocks;i++)
+            if(!x->blocks[i]->dirty){ x->blocks[i]->dirty = 1; st[sp++] = x->blocks[i]; }
+    }
+    free(st);
+}
+
+static int compareDepOrd(const void *a, const void *b){
+    return (*(DepNode* const*)a)->ord - (*(DepNode* const*)b)->ord;
+}
+
+static int compareInt(const void *a, const void *b){
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// make room in depOrder for an edge from -> to (from first). Returns 1, 0 if the
+// edge would close a cycle, -1 out of memory
+static int dep_reorder(DepNode *from, DepNode *to){
+    if(from->ord < to->ord) return 1;
+    int lb = to->ord, ub = from->ord, nf = 0, nb = 0, sp = 0, res = 1;
+    unsigned stamp = ++depStamp;
+    DepNode **fw = (DepNode**)malloc(depOrderLen * sizeof(DepNode*));
+    DepNode **bw = (DepNode**)malloc(depOrderLen * sizeof(DepNode*));
+    DepNode **st = (DepNode**)malloc(depOrderLen * sizeof(DepNode*));
+    int *slots = (int*)malloc(depOrderLen * sizeof(int));
+    if(!fw || !bw || !st || !slots) res = -1;
+    // downstream of `to` within the window; reaching `from` closes a cycle
+    if(res == 1){ to->mark = stamp; st[sp++] = to; }
+    while(sp && res == 1){
+        DepNode *x = st[--sp];
+        fw[nf++] = x;
+        for(int i=0;i<x->nBlocks;i++){
+            DepNode *w = x->blocks[i];
+            if(w == from){ res = 0; break; }
+            if(w->mark != stamp && w->ord < ub){ w->mark = stamp; st[sp++] = w; }
+        }
+    }
+    // upstream of `from` within the window
+    if(res == 1){ from->mark = stamp; st[sp++] = from; }
+    while(sp && res == 1){
+        DepNode *x = st[--sp];
+        bw[nb++] = x;
+        for(int i=0;i<x->nBlockers;i++){
+            DepNode *w = x->blockers[i];
+            if(w->mark != stamp && w->ord > lb){ w->mark = stamp; st[sp++] = w; }
+        }
+    }
+    if(res == 1){
+        // the upstream set takes the lowest of the freed slots, in its old relative order
+        qsort(bw, nb, sizeof(DepNode*), compareDepOrd);
+        qsort(fw, nf, sizeof(DepNode*), compareDepOrd);
+        for(int i=0;i<nb;i++) slots[i] = bw[i]->ord;
+        for(int i=0;i<nf;i++) slots[nb+i] = fw[i]->ord;
+        qsort(slots, nb + nf, sizeof(int), compareInt);
+        for(int i=0;i<nb+nf;i++){
+            DepNode *x = i < nb ? bw[i] : fw[i-nb];
+            x->ord = slots[i];
+            depOrder[slots[i]] = x;
+        }
+    }
+    free(fw);
+    free(bw);
+    free(st);
+    free(slots);
+    return res;
+}
+
+static void dep_compute(DepNode *x){
+    x->chain = 0;
+    x->via = NULL;
+    if(!x->done){
+        for(int i=0;i<x->nBlockers;i++)
+            if(x->blockers[i]->chain > x->chain){ x->chain = x->blockers[i]->chain; x->via = x->blockers[i]; }
+        x->chain++;
+    }
+    x->dirty = 0;
+}
+
+// bring n's chain up to date: recompute its dirty ancestors, blockers first. 0 out of memory
+static int dep_refresh(DepNode *n){
+    if(!n->dirty) return 1;
+    DepNode **st = (DepNode**)malloc(depOrderLen * sizeof(DepNode*));
+    DepNode **set = (DepNode**)malloc(depOrderLen * sizeof(DepNode*));
+    int sp = 0, k = 0;
+    unsigned stamp = ++depStamp;
+    if(!st || !set){ free(st); free(set); return 0; }
+    n->mark = stamp;
+    st[sp++] = n;
+    while(sp){
+        DepNode *x = st[--sp];
+        set[k++] = x;
+        for(int i=0;i<x->nBlockers;i++){
+            DepNode *w = x->blockers[i];
+            if(w->dirty && w->mark != stamp){ w->mark = stamp; st[sp++] = w; }
+        }
+    }
+    qsort(set, k, sizeof(DepNode*), compareDepOrd);
+    for(int i=0;i<k;i++) dep_compute(set[i]);
+    free(st);
+    free(set);
+    return 1;
+}
+
+// t's status may have changed (caller holds its shard lock)
+static void dep_status(TaskNode *t){
+    if(!t->dep) return;
+    int done = strcmp(t->status, CLOSED_STATUS)==0;
+    mutex_lock(&depLock);
+    DepNode *n = t->dep;
+    if(n->done != done){
+        n->done = done;
+        for(int i=0;i<n->nBlocks;i++) dep_open_add(n->blocks[i], done ? -1 : 1);
+        dep_touch(n);
+    }
+    mutex_unlock(&depLock);
+}
+
+// close the NULL slots in depOrder, keeping the order
+static void dep_compact(void){
+    int n = 0;
+    for(int i=0;i<depOrderLen;i++)
+        if(depOrder[i]){
+            depOrder[n] = depOrder[i];
+            depOrder[n]->ord = n;
+            n++;
+        }
+    depOrderLen = n;
+}
+
+// t is being deleted: drop its node and edges; what it blocked no longer waits on it
+static void dep_drop(TaskNode *t){
+    if(!t->dep) return;
+    mutex_lock(&depLock);
+    DepNode *n = t->dep;
+    for(int i=0;i<n->nBlocks;i++){
+        DepNode *d = n->blocks[i];
+        dep_unlink(d->blockers, &d->nBlockers, n);
+        if(!n->done) dep_open_add(d, -1);
+        dep_touch(d);
+    }
+    for(int i=0;i<n->nBlockers;i++) dep_unlink(n->blockers[i]->blocks, &n->blockers[i]->nBlocks, n);
+    if(n->open) rb_remove(&depBlocked, n->id);
+    depOrder[n->ord] = NULL;
+    if(--depLive < depOrderLen / 2) dep_compact();
+    free(n->blockers);
+    free(n->blocks);
+    free(n);
+    t->dep = NULL;
+    mutex_unlock(&depLock);
+}
+
+// ---------- Sorted per-user views ----------
+// A user's view for a criterion is materialized the first time it is asked
+// for, then kept current: assign/unassign insert or remove one node, and an
+// edit re-positions the task in each holder's active views. Listing is an
+// in-order walk, so no call pays for an O(n log n) sort.
+static const char *sortNames[SORT_COUNT] = { "priority", "due", "status", "created" };
+
+static int sort_criterion(const char *name){
+    for(int i=0;i<SORT_COUNT;i++)
+        if(name && strcmp(name, sortNames[i])==0) return i;
+    return -1;
+}
+
+// order by criterion, ties (and SORT_CREATED) by creation; tasks without a due date sort last
+static int view_cmp(int crit, const TaskNode *a, const TaskNode *b){
+    int c = 0;
+    switch(crit){
+    case SORT_PRIORITY:
+        c = (a->priority > b->priority) - (a->priority < b->priority);
+        break;
+    case SORT_DUE:
+        c = (a->dueAt == 0) - (b->dueAt == 0);
+        if(!c) c = (a->dueAt > b->dueAt) - (a->dueAt < b->dueAt);
+        break;
+    case SORT_STATUS:
+        c = strcmp(a->status, b->status);
+        break;
+    }
+    if(c) return c;
+    return (a->created > b->created) - (a->created < b->created);
+}
+
+static ViewNode* view_insert(ViewNode *root, ViewNode *n, int crit){
+    if(!root) return n;
+    if(view_cmp(crit, n->task, root->task) < 0){
+        root->left = view_insert(root->left, n, crit);
+        if(root->left->heapKey > root->heapKey){
+            ViewNode *l = root->left;
+            root->left = l->right;
+            l->right = root;
+            root = l;
+        }
+    } else {
+        root->right = view_insert(root->right, n, crit);
+        if(root->right->heapKey > root->heapKey){
+            ViewNode *r = root->right;
+            root->right = r->left;
+            r->left = root;
+            root = r;
+        }
+    }
+    return root;
+}
+
+static ViewNode* view_merge(ViewNode *a, ViewNode *b){
+    if(!a) return b;
+    if(!b) return a;
+    if(a->heapKey > b->heapKey){
+        a->right = view_merge(a->right, b);
+        return a;
+    }
+    b->left = view_merge(a, b->left);
+    return b;
+}
+
+// the task's sort key must be unchanged since it was inserted
+static ViewNode* view_remove(ViewNode *root, const TaskNode *t, int crit){
+    if(!root) return NULL;
+    int c = view_cmp(crit, t, root->task);
+    if(c < 0) root->left = view_remove(root->left, t, crit);
+    else if(c > 0) root->right = view_remove(root->right, t, crit);
+    else {
+        ViewNode *rest = view_merge(root->left, root->right);
+        free(root);
+        return rest;
+    }
+    return root;
+}
+
+static void view_add_task(User *u, int crit, TaskNode *t){
+    ViewNode *n = (ViewNode*)malloc(sizeof(ViewNode));
+    if(!n) return;
+    n->task = t;
+    n->heapKey = nextHeapKey();
+    n->left = n->right = NULL;
+    u->views[crit] = view_insert(u->views[crit], n, crit);
+}
+
+static void user_views_add(User *u, TaskNode *t){
+    for(int c=0;c<SORT_COUNT;c++)
+        if(u->viewActive[c]) view_add_task(u, c, t);
+}
+
+static void user_views_remove(User *u, TaskNode *t){
+    for(int c=0;c<SORT_COUNT;c++)
+        if(u->viewActive[c]) u->views[c] = view_remove(u->views[c], t, c);
+}
+
+// take a task out of every holder's views (and loads) before its sort keys change...
+static void views_detach(TaskNode *t){
+    for(TaskDLL *it = t->assignees; it; it = it->tnext) user_views_remove(it->owner, t);
+    holders_load_add(t, -1);
+}
+
+// ...and put it back once they are final
+static void views_attach(TaskNode *t){
+    for(TaskDLL *it = t->assignees; it; it = it->tnext) user_views_add(it->owner, t);
+    holders_load_add(t, 1);
+}
+
+static void user_view_activate(User *u, int crit){
+    if(u->viewActive[crit]) return;
+    u->viewActive[crit] = 1;
+    for(TaskDLL *it = u->head; it; it = it->next) view_add_task(u, crit, it->task);
+}
+
+static int view_to_json(const ViewNode *n, JsonOut *o, int desc){
+    if(!n) return 1;
+    if(!view_to_json(desc ? n->right : n->left, o, desc)) return 0;
+    if(!json_task(o, n->task, 1)) return 0;
+    return view_to_json(desc ? n->left : n->right, o, desc);
+}
+
+// ---------- Per-user DLL list helpers ----------
+// When a task lives outside its owner's home shard the node spans two
+// shards: callers hold the owner's shard lock (prev/next, views, user
+// bitmap) and the task's shard lock (tprev/tnext, assignee counts).
+static TaskDLL* makeDLLNode(TaskNode *task){
+    TaskDLL *n = (TaskDLL*)malloc(sizeof(TaskDLL));
+    n->task = task;
+    n->owner = NULL;
+    n->prev = n->next = NULL;
+    n->tprev = n->tnext = NULL;
+    return n;
+}
+
+// unlink a node from both its owner's list and its task's assignee list, then free it
+static void unlinkDLLNode(TaskDLL *nd){
+    User *u = nd->owner;
+    int ts = task_shard(nd->task->id);
+    if(nd->prev) nd->prev->next = nd->next;
+    else u->head = nd->next;
+    if(nd->next) nd->next->prev = nd->prev;
+    else u->tail = nd->prev;
+    if(nd->tprev) nd->tprev->tnext = nd->tnext;
+    else nd->task->assignees = nd->tnext;
+    if(nd->tnext) nd->tnext->tprev = nd->tprev;
+    rb_remove(&u->assigned, nd->task->id);
+    user_views_remove(u, nd->task);
+    if(--u->heldPerShard[ts] == 0) u->heldMask &= ~SHARD_BIT(ts);
+    if(--nd->task->assigneeCount == 0) rb_remove(&shards[ts].assignedTasks, nd->task->id);
+    user_load_add(u, -task_weight(nd->task));
+    free(nd);
+}
+
+// find u's node for this task by walking the task's assignees: O(k), not O(tasks of u)
+static TaskDLL* task_holder_node(TaskNode *task, User *u){
+    for(TaskDLL *it = task ? task->assignees : NULL; it; it = it->tnext)
+        if(it->owner == u) return it;
+    return NULL;
+}
+
+static void user_add_taskdll(User *u, TaskNode *task){
+    if(!u || !task) return;
+    if(task_holder_node(task, u)) return; // already assigned
+    int ts = task_shard(task->id);
+    TaskDLL *nd = makeDLLNode(task);
+    nd->owner = u;
+    if(!u->head){
+        u->head = u->tail = nd;
+    } else {
+        u->tail->next = nd;
+        nd->prev = u->tail;
+        u->tail = nd;
+    }
+    // link into the task's reverse index
+    nd->tnext = task->assignees;
+    if(task->assignees) task->assignees->tprev = nd;
+    task->assignees = nd;
+    if(task->assigneeCount++ == 0) rb_add(&shards[ts].assignedTasks, task->id);
+    if(u->heldPerShard[ts]++ == 0) u->heldMask |= SHARD_BIT(ts);
+    rb_add(&u->assigned, task->id);
+    user_views_add(u, task);
+    user_load_add(u, task_weight(task));
+}
+
+static int user_remove_taskdll_byid(User *u, int id){
+    if(!u) return 0;
+    TaskDLL *nd = task_holder_node(task_lookup(id), u);
+    if(!nd) return 0;
+    unlinkDLLNode(nd);
+    return 1;
+}
+
+// send a message to every current assignee of a task
+static void notify_assignees(TaskNode *t, const char *msg){
+    for(TaskDLL *it = t->assignees; it; it = it->tnext)
+        enqueueUserNotif(it->owner->username, msg);
+}
+
+// build JSON of a user's tasks (from their DLL, i.e. assignment order)
+static const char* user_tasks_to_json(User *u, char *buf) {
+    JsonOut o;
+    json_begin(&o, buf, JSON_BUF);
+    for(TaskDLL *it = u->head; it && json_task(&o, it->task, 1); it = it->next);
+    return json_end(&o);
+}
+
+// ---------- Undo/Redo simple helpers ----------
+static void user_push_undo(User *u, int taskID){
+    if(!u) return;
+    if(u->undoTop < 128) u->undoStack[u->undoTop++] = taskID;
+    else metric_count(&undoOverflows);
+}
+
+static int user_pop_undo(User *u){
+    if(!u || u->undoTop==0) return -1;
     return u->undoStack[--u->undoTop];
 }
 static void user_push_redo(User *u, int taskID){
     if(!u) return;
     if(u->redoTop < 128) u->redoStack[u->redoTop++] = taskID;
+    else metric_count(&redoOverflows);
 }
 static int user_pop_redo(User *u){
     if(!u || u->redoTop==0) return -1;
     return u->redoStack[--u->redoTop];
 }
 
-// ---------- Exported API functions ----------
+// ---------- Lock scopes ----------
+// An operation locks every shard whose data it touches, in ascending order.
+// Which shards those are can depend on data behind the locks (a user may
+// hold tasks from other shards, a task's holders may live anywhere), so the
+// set is widened and re-locked until it stops growing. A user whose tasks
+// are all local therefore touches exactly one shard.
+enum { SCOPE_NONE, SCOPE_UNDO, SCOPE_REDO };
 
-// login_user_api: create user if not exists; simple "login" (no password required here)
-EXPORT int STDCALL login_user_api(const char* username, const char* password) {
-    if(!username) return 0;
-    User *u = findUser(username);
-    if(!u) {
-        u = createOrGetUser(username);
-        if(!u) return 0;
-        if(password && strlen(password)>0) {
-            strncpy(u->password, password, sizeof(u->password)-1);
-            u->password[sizeof(u->password)-1]=0;
+typedef struct {
+    const char *user;      // user involved, NULL if none
+    int createUser;        // create the user when missing
+    int taskId;            // task involved, 0 if none
+    int withHolders;       // also lock the home shards of the task's assignees
+    int stack;             // SCOPE_UNDO / SCOPE_REDO: include the task on top of that stack
+    User *u;               // resolved user, valid while the scope is held
+    uint64_t mask;
+} Scope;
+
+static uint64_t scope_needs(Scope *sc){
+    uint64_t need = 0;
+    sc->u = NULL;
+    if(sc->user){
+        need |= SHARD_BIT(user_shard(sc->user));
+        sc->u = sc->createUser ? createOrGetUser(sc->user) : findUser(sc->user);
+        if(sc->u){
+            User *u = sc->u;
+            need |= u->heldMask;
+            if(sc->stack == SCOPE_UNDO && u->undoTop) need |= SHARD_BIT(task_shard(u->undoStack[u->undoTop-1]));
+            if(sc->stack == SCOPE_REDO && u->redoTop) need |= SHARD_BIT(task_shard(u->redoStack[u->redoTop-1]));
         }
-        return 1; // created => considered logged in
     }
-    // If user exists and password provided, check (if password set), otherwise allow
-    if(password && strlen(u->password)>0) {
-        return strcmp(u->password, password)==0 ? 1 : 0;
+    if(sc->taskId){
+        need |= SHARD_BIT(task_shard(sc->taskId));
+        TaskNode *t = sc->withHolders ? task_lookup(sc->taskId) : NULL;
+        for(TaskDLL *it = t ? t->assignees : NULL; it; it = it->tnext) need |= SHARD_BIT(it->owner->shard);
     }
-    return 1;
+    return need;
 }
 
-// add_task_api: create a global task and automatically assign to username
-EXPORT int STDCALL add_task_api(const char* username, const char* title, int priority, const char* dueDate, const char* status) {
-    if(!username || !title) return -1;
-    User *u = createOrGetUser(username);
-    if(!u) return -1;
-    TaskNode *n = createTaskNode(nextTaskID++, title, priority, dueDate, status);
-    if(!n) return -1;
-    taskRoot = bst_insert(taskRoot, n);
-    // assign to user (make link in user's DLL)
-    user_add_taskdll(u, n);
-    // push undo (for removal)
-    user_push_undo(u, n->id);
-    // notify
-    char nm[128];
-    snprintf(nm, sizeof(nm), "Task #%d created by %s: %s", n->id, username, title);
-    enqueueNotif(nm);
-    return n->id;
+static void scope_lock(Scope *sc){
+    sc->mask = 0;
+    if(sc->user) sc->mask |= SHARD_BIT(user_shard(sc->user));
+    if(sc->taskId) sc->mask |= SHARD_BIT(task_shard(sc->taskId));
+    for(;;){
+        lock_shards(sc->mask);
+        uint64_t need = scope_needs(sc) | sc->mask;
+        if(need == sc->mask) return;
+        unlock_shards(sc->mask);
+        sc->mask = need;
+    }
 }
 
-// edit_task_api: modify global task fields (must be global)
-EXPORT int STDCALL edit_task_api(const char* username, int id, const char* title, int priority, const char* dueDate, const char* status) {
-    TaskNode *t = bst_search(taskRoot, id);
-    if(!t) return -1;
-    if(title && strlen(title)>0) strncpy(t->title, title, sizeof(t->title)-1);
-    t->priority = priority;
-    if(dueDate && strlen(dueDate)>0) strncpy(t->dueDate, dueDate, sizeof(t->dueDate)-1);
-    if(status && strlen(status)>0) strncpy(t->status, status, sizeof(t->status)-1);
-    currentTimeStr(t->timestamp, sizeof(t->timestamp));
-    char nm[128];
-    snprintf(nm, sizeof(nm), "Task #%d edited by %s", id, username?username:"unknown");
-    enqueueNotif(nm);
-    return 0;
+static void scope_unlock(Scope *sc){
+    unlock_shards(sc->mask);
 }
 
-// remove_task_api: unassign from user and remove from global BST (for simplicity we only unassign)
-EXPORT int STDCALL remove_task_api(const char* username, int id) {
-    User *u = findUser(username);
-    if(!u) return 0;
-    // remove from user's DLL
-    int removed = user_remove_taskdll_byid(u, id);
-    if(removed){
-        user_push_undo(u, id);
-        char nm[128];
-        snprintf(nm,sizeof(nm), "Task #%d removed by %s", id, username);
-        enqueueNotif(nm);
-        return 1;
+// ---------- Due-date scheduler ----------
+// Each shard keeps a min-heap of its tasks keyed on their next deadline
+// event: a "due soon" reminder remindBefore seconds ahead, then "overdue" at
+// dueAt. Add, edit and delete sift a single entry (O(log n)); one thread per
+// shard sleeps until its earliest key, so no step ever rescans the task set.
+enum { DUE_PENDING, DUE_REMINDED, DUE_FIRED };
+
+static long remindBefore = REMIND_BEFORE_DEFAULT;
+static int flipOverdue = 0;       // set status to OVERDUE_STATUS when the deadline passes
+static int schedRunning = 0;      // changed with every shard lock held
+
+static time_t sched_key(const TaskNode *t){
+    return t->dueState == DUE_PENDING ? t->dueAt - remindBefore : t->dueAt;
+}
+
+static void sched_set(Shard *s, int i, TaskNode *t){
+    s->schedHeap[i] = t;
+    t->schedIdx = i;
+}
+
+static void sched_sift_up(Shard *s, int i){
+    TaskNode *t = s->schedHeap[i];
+    while(i > 0){
+        int p = (i - 1) / 2;
+        if(sched_key(s->schedHeap[p]) <= sched_key(t)) break;
+        sched_set(s, i, s->schedHeap[p]);
+        i = p;
     }
-    return 0;
+    sched_set(s, i, t);
 }
 
-// assign_task_api: assign existing global task to another user
-EXPORT int STDCALL assign_task_api(const char* fromUser, const char* toUser, int id) {
-    TaskNode *t = bst_search(taskRoot, id);
-    if(!t) return 0;
-    User *to = createOrGetUser(toUser);
-    if(!to) return 0;
-    user_add_taskdll(to, t);
-    // push undo on target
-    user_push_undo(to, id);
-    char nm[128];
-    snprintf(nm,sizeof(nm),"Task #%d assigned to %s by %s", id, toUser?toUser:"", fromUser?fromUser:"");
-    enqueueNotif(nm);
-    return 1;
+static void sched_sift_down(Shard *s, int i){
+    TaskNode *t = s->schedHeap[i];
+    for(;;){
+        int c = 2*i + 1;
+        if(c >= s->schedCount) break;
+        if(c + 1 < s->schedCount && sched_key(s->schedHeap[c+1]) < sched_key(s->schedHeap[c])) c++;
+        if(sched_key(t) <= sched_key(s->schedHeap[c])) break;
+        sched_set(s, i, s->schedHeap[c]);
+        i = c;
+    }
+    sched_set(s, i, t);
 }
 
-// undo_api: simple undo pop (reverses last assign/remove for that user)
-EXPORT int STDCALL undo_api(const char* username) {
-    User *u = findUser(username);
-    if(!u) return 0;
-    int id = user_pop_undo(u);
-    if(id < 0) return 0;
-    // if task assigned currently => remove (undo assign), else if not assigned => re-add (undo remove)
-    TaskDLL *it = u->head;
-    int found = 0;
-    while(it){ if(it->task->id==id){ found = 1; break; } it = it->next; }
-    if(found){
-        user_remove_taskdll_byid(u, id);
-        user_push_redo(u, id);
-        enqueueNotif("Undo performed: unassigned task");
-    } else {
-        TaskNode *tn = bst_search(taskRoot, id);
-        if(tn){
-            user_add_taskdll(u, tn);
-            user_push_redo(u, id);
-            enqueueNotif("Undo performed: re-assigned task");
+static void sched_remove(TaskNode *t){
+    Shard *s = shard_of(t);
+    int i = t->schedIdx;
+    if(i < 0) return;
+    t->schedIdx = -1;
+    if(--s->schedCount == i) return;
+    TaskNode *moved = s->schedHeap[s->schedCount];
+    sched_set(s, i, moved);
+    sched_sift_up(s, i);
+    sched_sift_down(s, moved->schedIdx);
+}
+
+// (re)schedule a task after it was created or edited
+static void sched_track(TaskNode *t){
+    Shard *s = shard_of(t);
+    time_t due = parse_due(t->dueDate);
+    if(due != t->dueAt){
+        t->dueAt = due;
+        t->dueState = DUE_PENDING;
+    }
+    int want = t->dueAt != 0 && t->dueState != DUE_FIRED && strcmp(t->status, CLOSED_STATUS) != 0;
+    if(!want){
+        sched_remove(t);
+        return;
+    }
+    if(t->schedIdx < 0){
+        if(s->schedCount == s->schedCap){
+            int nc = s->schedCap ? s->schedCap * 2 : 64;
+            TaskNode **g = (TaskNode**)realloc(s->schedHeap, nc * sizeof(TaskNode*));
+            if(!g) return;
+            s->schedHeap = g;
+            s->schedCap = nc;
         }
+        sched_set(s, s->schedCount++, t);
     }
-    return 1;
+    sched_sift_up(s, t->schedIdx);
+    sched_sift_down(s, t->schedIdx);
+    if(s->schedHeap[0] == t) cond_signal(&s->schedWake);
 }
 
-// redo_api: reverse undo
-EXPORT int STDCALL redo_api(const char* username) {
-    User *u = findUser(username);
-    if(!u) return 0;
-    int id = user_pop_redo(u);
-    if(id < 0) return 0;
-    // perform redo logic similar to above
-    TaskDLL *it = u->head;
-    int found = 0;
-    while(it){ if(it->task->id==id){ found = 1; break; } it = it->next; }
-    if(found){
-        // if present, redo might remove -> remove
-        user_remove_taskdll_byid(u, id);
-        user_push_undo(u, id);
+// emit the event for a task whose key has passed and advance its state
+static void sched_fire(TaskNode *t, time_t now, int flip){
+    char nm[MAX_NOTIF_MSG];
+    if(t->dueState == DUE_PENDING && now < t->dueAt){
+        snprintf(nm, sizeof(nm), "Task #%d due soon: %s (due %s)", t->id, t->title, t->dueDate);
+        t->dueState = DUE_REMINDED;
+        sched_sift_down(shard_of(t), t->schedIdx);
     } else {
-        TaskNode *tn = bst_search(taskRoot, id);
-        if(tn){
-            user_add_taskdll(u, tn);
-            user_push_undo(u, id);
+        snprintf(nm, sizeof(nm), "Task #%d overdue: %s (was due %s)", t->id, t->title, t->dueDate);
+        t->dueState = DUE_FIRED;
+        sched_remove(t);
+        if(flip){
+            char oldStatus[32];
+            strcpy(oldStatus, t->status);
+            views_detach(t);
+            strncpy(t->status, OVERDUE_STATUS, sizeof(t->status)-1);
+            reindex_task(t, oldStatus, t->priority);
+            views_attach(t);
         }
     }
-    enqueueNotif("Redo performed");
-    return 1;
+    if(t->assignees) notify_assignees(t, nm);
+    else enqueueShardNotif(shard_of(t), NULL, nm);
 }
 
-// list_tasks_api: returns JSON array for the user's assigned tasks
-EXPORT const char* STDCALL list_tasks_api(const char* username) {
-    static char buf[JSON_BUF];
-    if(!username) return "[]";
-    User *u = findUser(username);
-    if(!u) return "[]";
-    user_tasks_to_json(u, buf);
-    return buf;
-}
+static void trace_untraced(const char *api); // with the call tracing below
 
-// notifications_api: returns notifications for a user (here we return all notifications for simplicity)
-EXPORT const char* STDCALL notifications_api(const char* username) {
-    // Could filter by user; for now return all notifications
-    return dequeueAllNotifsJSON();
-}
-
-// manager_tasks_api: returns JSON array of all tasks in global BST (manager view)
-EXPORT const char* STDCALL manager_tasks_api() {
-    static char buf[JSON_BUF];
-    buf[0]=0;
-    strcat(buf,"[");
-    int first = 1;
-    bst_all_tasks_json(taskRoot, buf, &first);
-    strcat(buf,"]");
-    return buf;
+// fire a task's due event under its full lock scope and log it; a follower
+// replaying the log passes force, since its own lead time may differ
+static void due_fire(int id, time_t now, int flip, int force){
+    if(read_only()) return; // followers get these events from the primary's log
+    Scope sc = { NULL, 0, id, 1, SCOPE_NONE, NULL, 0 };
+    scope_lock(&sc);
+    TaskNode *t = task_lookup(id);
+    if(t && t->schedIdx >= 0 && (force || sched_key(t) <= now)){
+        trace_untraced("due_fire");
+        sched_fire(t, now, flip);
+        replog_append(REC_DUE_FIRE, id, (long long)now, flip);
+    }
+    scope_unlock(&sc);
 }
 
-// manager_notifications_api: aggregated notifications (same as notifications_api)
-EXPORT const char* STDCALL manager_notifications_api() {
-    return dequeueAllNotifsJSON();
+THREAD_FN(scheduler_main){
+    Shard *s = (Shard*)arg;
+    mutex_lock(&s->lock);
+    while(schedRunning){
+        if(s->schedCount == 0){
+            cond_wait_ms(&s->schedWake, &s->lock, -1);
+            continue;
+        }
+        time_t now = time(NULL);
+        TaskNode *t = s->schedHeap[0];
+        time_t key = sched_key(t);
+        if(key > now){
+            // cap the sleep so wall-clock jumps are noticed within a minute
+            long ms = (key - now) > 60 ? 60000L : (long)(key - now) * 1000L;
+            cond_wait_ms(&s->schedWake, &s->lock, ms);
+            continue;
+        }
+        // firing may touch holders' views in other shards: re-lock in order
+        int id = t->id;
+        mutex_unlock(&s->lock);
+        due_fire(id, now, flipOverdue, 0);
+        mutex_lock(&s->lock);
+    }
+    mutex_unlock(&s->lock);
+    THREAD_RETURN;
 }
 
-// list_users_api
-EXPORT const char* STDCALL list_users_api() {
-    static char buf[1024];
-    buf[0]=0;
-    strcat(buf,"[");
-    for(int i=0;i<userCount;i++){
-        if(i) strcat(buf,",");
-        char tmp[128];
-        snprintf(tmp,sizeof(tmp),"\"%s\"", users[i].username);
-        strcat(buf,tmp);
+// ---------- Parallel fan-out across shards ----------
+// Manager-wide calls run one job per shard on a persistent pool (a worker
+// per shard beyond the first; the caller runs shard 0) and then merge the
+// per-shard results. Never call this while holding a shard lock.
+typedef void (*ShardJob)(Shard *s, void *ctx);
+
+static EngineMutex fanoutLock = ENGINE_MUTEX_INIT;   // one fan-out at a time
+static EngineMutex poolLock = ENGINE_MUTEX_INIT;
+static EngineCond poolWake = ENGINE_COND_INIT;
+static EngineCond poolDone = ENGINE_COND_INIT;
+static EngineThread poolThreads[ENGINE_SHARDS];
+static int poolSize = 0;          // workers running for shards 1..poolSize
+static unsigned poolGen = 0;
+static int poolPending = 0;
+static ShardJob poolJob;
+static void *poolCtx;
+
+THREAD_FN(pool_worker){
+    Shard *s = (Shard*)arg;
+    unsigned seen = 0;
+    mutex_lock(&poolLock);
+    for(;;){
+        while(poolGen == seen) cond_wait_ms(&poolWake, &poolLock, -1);
+        seen = poolGen;
+        ShardJob job = poolJob;
+        void *ctx = poolCtx;
+        mutex_unlock(&poolLock);
+        job(s, ctx);
+        mutex_lock(&poolLock);
+        if(--poolPending == 0) cond_signal(&poolDone);
     }
-    strcat(buf,"]");
-    return buf;
+    THREAD_RETURN;
 }
 
-// search_task_api (simple: find by substring in title across user's assigned tasks)
-EXPORT const char* STDCALL search_task_api(const char* username, const char* q) {
-    static char buf[JSON_BUF];
-    buf[0]=0;
-    strcat(buf,"[");
-    User *u = findUser(username);
-    if(!u || !q) { strcat(buf,"]"); return buf; }
-    TaskDLL *it = u->head;
-    int first=1;
-    while(it){
-        if(strstr(it->task->title, q)){
-            char tmp[512];
-            if(!first) strcat(buf,",");
-            first=0;
-            snprintf(tmp,sizeof(tmp), "{\"id\":%d,\"title\":\"%s\",\"priority\":%d,\"due\":\"%s\",\"status\":\"%s\"}",
-                     it->task->id, it->task->title, it->task->priority, it->task->dueDate, it->task->status);
-            strcat(buf,tmp);
-        }
-        it = it->next;
-    }
-    strcat(buf,"]");
-    return buf;
+static void shard_fanout(ShardJob job, void *ctx){
+    mutex_lock(&fanoutLock);
+    mutex_lock(&poolLock);
+    while(poolSize + 1 < ENGINE_SHARDS && thread_start(&poolThreads[poolSize + 1], pool_worker, &shards[poolSize + 1]))
+        poolSize++;
+    poolJob = job;
+    poolCtx = ctx;
+    poolPending = poolSize;
+    poolGen++;
+    cond_signal(&poolWake);
+    mutex_unlock(&poolLock);
+    job(&shards[0], ctx);
+    for(int i=poolSize+1;i<ENGINE_SHARDS;i++) job(&shards[i], ctx); // shards without a worker
+    mutex_lock(&poolLock);
+    while(poolPending > 0) cond_wait_ms(&poolDone, &poolLock, -1);
+    mutex_unlock(&poolLock);
+    mutex_unlock(&fanoutLock);
 }
 
-// filter_task_api (filter by status or priority for a user)
-EXPORT const char* STDCALL filter_task_api(const char* username, const char* status, int priority) {
-    static char buf[JSON_BUF];
-    buf[0]=0;
-    strcat(buf,"[");
-    User *u = findUser(username);
-    if(!u) { strcat(buf,"]"); return buf; }
-    TaskDLL *it = u->head;
-    int first=1;
-    while(it){
-        int ok = 1;
-        if(status && strlen(status)>0) ok &= (strcmp(it->task->status, status)==0);
-        if(priority>0) ok &= (it->task->priority == priority);
-        if(ok){
-            char tmp[512];
-            if(!first) strcat(buf,",");
-            first=0;
-            snprintf(tmp,sizeof(tmp), "{\"id\":%d,\"title\":\"%s\",\"priority\":%d,\"due\":\"%s\",\"status\":\"%s\"}",
-                     it->task->id, it->task->title, it->task->priority, it->task->dueDate, it->task->status);
-            strcat(buf,tmp);
-        }
-        it = it->next;
+// Per-shard slice of a manager-wide listing: task JSON in id order (within a shard,
+// also creation order) plus each element's creation number and offset, so the slices
+// can be merged into creation order afterwards.
+typedef struct {
+    char *text;
+    int len, cap;
+    unsigned long long *keys;
+    int *offs;
+    int n, ncap;
+} ShardListing;
+
+// returns 0 once the slice alone would fill the merged output
+static int listing_add(ShardListing *l, const TaskNode *t, int withTime){
+    char tmp[512];
+    if(l->len > JSON_BUF) return 0;
+    int n = format_task(tmp, sizeof(tmp), t, withTime);
+    if(l->len + n > l->cap){
+        int nc = l->cap ? l->cap * 2 : 4096;
+        while(nc < l->len + n) nc *= 2;
+        char *g = (char*)realloc(l->text, nc);
+        if(!g) return 0;
+        l->text = g;
+        l->cap = nc;
     }
-    strcat(buf,"]");
-    return buf;
+    if(l->n == l->ncap){
+        int nc = l->ncap ? l->ncap * 2 : 64;
+        unsigned long long *gk = (unsigned long long*)realloc(l->keys, nc * sizeof(unsigned long long));
+        if(!gk) return 0;
+        l->keys = gk;
+        int *go = (int*)realloc(l->offs, nc * sizeof(int));
+        if(!go) return 0;
+        l->offs = go;
+        l->ncap = nc;
+    }
+    l->keys[l->n] = t->created;
+    l->offs[l->n++] = l->len;
+    memcpy(l->text + l->len, tmp, n);
+    l->len += n;
+    return 1;
 }
 
-// analytics_api (basic stats)
-EXPORT const char* STDCALL analytics_api(const char* username) {
-    static char buf[256];
-    int total = 0;
-    int comp = 0;
-    for(int i=0;i<userCount;i++){
-        total += users[i].undoTop; // meaningless small stat: number of undo ops per user (placeholder)
+// k-way merge of the shards' slices by creation into buf (truncated to JSON_BUF)
+static const char* merge_listings(ShardListing *ls, char *buf){
+    int pos[ENGINE_SHARDS] = {0};
+    JsonOut o;
+    json_begin(&o, buf, JSON_BUF);
+    for(;;){
+        int best = -1;
+        for(int i=0;i<ENGINE_SHARDS;i++)
+            if(pos[i] < ls[i].n && (best < 0 || ls[i].keys[pos[i]] < ls[best].keys[pos[best]])) best = i;
+        if(best < 0) break;
+        ShardListing *l = &ls[best];
+        int k = pos[best]++;
+        int end = k + 1 < l->n ? l->offs[k+1] : l->len;
+        if(!json_raw(&o, l->text + l->offs[k], end - l->offs[k])) break;
     }
-    snprintf(buf,sizeof(buf), "{\"users\":%d,\"tasks_total_estimate\":%d}", userCount, nextTaskID-1);
-    return buf;
+    for(int i=0;i<ENGINE_SHARDS;i++){
+        free(ls[i].text);
+        free(ls[i].keys);
+        free(ls[i].offs);
+    }
+    return json_end(&o);
 }
 
-// sort_tasks_api placeholder (returns success)
-EXPORT int STDCALL sort_tasks_api(const char* username, const char* criterion) {
-    (void)username; (void)criterion;
-    return 1;
+// in-order traversal that appends a shard's tasks to its slice
+static int bst_all_tasks_listing(TaskNode* root, ShardListing *l) {
+    if(!root) return 1;
+    return bst_all_tasks_listing(root->left, l)
+        && listing_add(l, root, 1)
+        && bst_all_tasks_listing(root->right, l);
 }
 
-// save/load placeholders
-EXPORT int STDCALL save_data_api(const char* filename) { (void)filename; return 1; }
-EXPORT int STDCALL load_data_api(const char* filename) { (void)filename; return 1; }
+static void manager_tasks_job(Shard *s, void *ctx){
+    ShardListing *l = &((ShardListing*)ctx)[s - shards];
+    mutex_lock(&s->lock);
+    bst_all_tasks_listing(s->taskRoot, l);
+    mutex_unlock(&s->lock);
+}
 
-// clear_notifications_api
-EXPORT int STDCALL clear_notifications_api(const char* username) {
-    (void)username;
-    notifFront = 0; notifRear = -1; notifCount = 0;
-    return 1;
+// ---------- Exported API functions ----------
+
+// create the user if they do not exist, otherwise check hash against theirs when
+// both are set; hash is a password_hash, or NULL/"" for no password
+static int login_user(const char *username, const char *hash) {
+    if(!username) return 0;
+    uint64_t mask = SHARD_BIT(user_shard(username));
+    int ok = 1;
+    lock_shards(mask);
+    User *u = findUser(username);
+    if(!u && read_only()) {
+        ok = 0; // a follower cannot create users
+    } else if(!u) {
+        u = createOrGetUser(username);
+        if(!u) ok = 0;
+        else if(hash && *hash) snprintf(u->password, sizeof(u->password), "%s", hash);
+        if(u) replog_append(REC_LOGIN, username, u->password);
+        // created => considered logged in
+    } else if(hash && strlen(u->password)>0) {
+        // If user exists and password provided, check (if password set), otherwise allow
+        ok = strcmp(u->password, hash)==0 ? 1 : 0;
+    }
+    unlock_shards(mask);
+    return ok;
+}
+
+// login_user_api: create user if not exists; simple "login" (no password required here)
+EXPORT int STDCALL login_user_api(const char* username, const char* password) {
+    METERED(API_LOGIN);
+    engine_init();
+    char hash[65] = "";
+    if(password && *password) password_hash(username, password, hash);
+    return login_user(username, password ? hash : NULL);
+}
+
+// add_task_api: create a task in the user's shard and automatically assign it to them
+EXPORT int STDCALL add_task_api(const char* username, const char* title, int priority, const char* dueDate, const char* status) {
+    METERED(API_ADD);
+    engine_init();
+    if(!username || !title || read_only()) return -1;
+    Shard *s = &shards[user_shard(username)];
+    int id = -1;
+    mutex_lock(&s->lock);
+    User *u = createOrGetUser(username);
+    TaskNode *n = u ? createTaskNode(s, title, priority, dueDate, status, opCreated) : NULL;
+    if(n){
+        s->taskRoot = bst_insert(s->taskRoot, n);
+        index_task(n);
+        sched_track(n);
+        // assign to user (make link in user's DLL)
+        user_add_taskdll(u, n);
+        // push undo (for removal)
+        user_push_undo(u, n->id);
+        // notify
+        char nm[128];
+        snprintf(nm, sizeof(nm), "Task #%d created by %s: %s", n->id, username, title);
+        enqueueShardNotif(s, NULL, nm);
+        id = n->id;
+        replog_append(REC_ADD, username, title, priority, dueDate, status, (long long)n->created);
+    }
+    mutex_unlock(&s->lock);
+    return id;
+}
+
+// edit_task_api: modify task fields; locks the task's shard and its holders' shards
+EXPORT int STDCALL edit_task_api(const char* username, int id, const char* title, int priority, const char* dueDate, const char* status) {
+    METERED(API_EDIT);
+    engine_init();
+    if(read_only()) return -1;
+    Scope sc = { NULL, 0, id, 1, SCOPE_NONE, NULL, 0 };
+    scope_lock(&sc);
+    TaskNode *t = task_lookup(id);
+    if(t){
+        char oldStatus[32];
+        int oldPriority = t->priority;
+        strcpy(oldStatus, t->status);
+        views_detach(t);
+        if(title && strlen(title)>0) strncpy(t->title, title, sizeof(t->title)-1);
+        t->priority = priority;
+        if(dueDate && strlen(dueDate)>0) strncpy(t->dueDate, dueDate, sizeof(t->dueDate)-1);
+        if(status && strlen(status)>0) strncpy(t->status, status, sizeof(t->status)-1);
+        reindex_task(t, oldStatus, oldPriority);
+        sched_track(t);
+        views_attach(t);
+        dep_status(t);
+        currentTimeStr(t->timestamp, sizeof(t->timestamp));
+        char nm[128];
+        snprintf(nm, sizeof(nm), "Task #%d edited by %s", id, username?username:"unknown");
+        notify_assignees(t, nm);
+        replog_append(REC_EDIT, username, id, title, priority, dueDate, status);
+    }
+    scope_unlock(&sc);
+    return t ? 0 : -1;
+}
+
+// remove_task_api: unassign from user (undoable); use delete_task_api to drop the task itself
+EXPORT int STDCALL remove_task_api(const char* username, int id) {
+    METERED(API_REMOVE);
+    engine_init();
+    if(!username || read_only()) return 0;
+    Scope sc = { username, 0, id, 0, SCOPE_NONE, NULL, 0 };
+    scope_lock(&sc);
+    // remove from user's DLL
+    int removed = user_remove_taskdll_byid(sc.u, id);
+    if(removed){
+        user_push_undo(sc.u, id);
+        char nm[128];
+        snprintf(nm,sizeof(nm), "Task #%d removed by %s", id, username);
+        enqueueShardNotif(&shards[sc.u->shard], NULL, nm);
+        replog_append(REC_REMOVE, username, id);
+    }
+    scope_unlock(&sc);
+    return removed;
+}
+
+// delete_task_api: remove a task from its shard's BST, detach it from every assignee and recycle its node.
+// Task ids are never handed out again, so stale ids left in undo stacks simply become no-ops.
+EXPORT int STDCALL delete_task_api(const char* username, int id) {
+    METERED(API_DELETE);
+    engine_init();
+    if(read_only()) return 0;
+    Scope sc = { NULL, 0, id, 1, SCOPE_NONE, NULL, 0 };
+    scope_lock(&sc);
+    Shard *s = &shards[task_shard(id)];
+    TaskNode *t = NULL;
+    if(bst_search(s->taskRoot, id)){
+        s->taskRoot = bst_delete(s->taskRoot, id, &t);
+        char nm[128];
+        snprintf(nm, sizeof(nm), "Task #%d deleted by %s", id, username?username:"unknown");
+        notify_assignees(t, nm);
+        while(t->assignees) unlinkDLLNode(t->assignees);
+        unindex_task(t);
+        sched_remove(t);
+        dep_drop(t);
+        releaseTaskNode(s, t);
+        replog_append(REC_DELETE, username, id);
+    }
+    scope_unlock(&sc);
+    return t ? 1 : 0;
+}
+
+// hand t to u: link, push undo on the target and notify (caller holds both shards)
+static void assign_locked(const char* fromUser, User *u, TaskNode *t){
+    user_add_taskdll(u, t);
+    user_push_undo(u, t->id);
+    char nm[128];
+    snprintf(nm,sizeof(nm),"Task #%d assigned to %s by %s", t->id, u->username, fromUser?fromUser:"");
+    notify_assignees(t, nm);
+}
+
+// assign_task_api: assign existing task to another user
+EXPORT int STDCALL assign_task_api(const char* fromUser, const char* toUser, int id) {
+    METERED(API_ASSIGN);
+    engine_init();
+    if(!toUser || read_only()) return 0;
+    Scope sc = { toUser, 1, id, 0, SCOPE_NONE, NULL, 0 };
+    scope_lock(&sc);
+    TaskNode *t = task_lookup(id);
+    int ok = t && sc.u;
+    if(ok) assign_locked(fromUser, sc.u, t);
+    replog_append(REC_ASSIGN, fromUser, toUser, id); // logged even on failure: the target user was still created
+    scope_unlock(&sc);
+    return ok;
+}
+
+// task_assignees_api: JSON array of usernames currently holding the task (from the reverse index)
+EXPORT const char* STDCALL task_assignees_api(int id) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_ASSIGNEES);
+    engine_init();
+    uint64_t mask = SHARD_BIT(task_shard(id));
+    int len = 1;
+    buf[0] = '[';
+    lock_shards(mask);
+    TaskNode *t = task_lookup(id);
+    for(TaskDLL *it = t ? t->assignees : NULL; it; it = it->tnext){
+        // usernames never change once created, so the owner's shard need not be locked
+        char tmp[128];
+        int n = snprintf(tmp, sizeof(tmp), "%s\"%s\"", len > 1 ? "," : "", it->owner->username);
+        if(len + n + 2 > JSON_BUF){ metric_count(&jsonTruncations); break; }
+        memcpy(buf + len, tmp, n);
+        len += n;
+    }
+    unlock_shards(mask);
+    buf[len++] = ']';
+    buf[len] = 0;
+    return buf;
+}
+
+// undo_api: simple undo pop (reverses last assign/remove for that user)
+EXPORT int STDCALL undo_api(const char* username) {
+    METERED(API_UNDO);
+    engine_init();
+    if(!username || read_only()) return 0;
+    Scope sc = { username, 0, 0, 0, SCOPE_UNDO, NULL, 0 };
+    scope_lock(&sc);
+    User *u = sc.u;
+    int id = user_pop_undo(u);
+    if(id >= 0){
+        // if task assigned currently => remove (undo assign), else if not assigned => re-add (undo remove)
+        TaskNode *tn = task_lookup(id);
+        TaskDLL *held = task_holder_node(tn, u);
+        if(held){
+            unlinkDLLNode(held);
+            user_push_redo(u, id);
+            enqueueUserNotif(u->username, "Undo performed: unassigned task");
+        } else if(tn){
+            user_add_taskdll(u, tn);
+            user_push_redo(u, id);
+            enqueueUserNotif(u->username, "Undo performed: re-assigned task");
+        }
+        replog_append(REC_UNDO, username);
+    }
+    scope_unlock(&sc);
+    return id >= 0;
+}
+
+// redo_api: reverse undo
+EXPORT int STDCALL redo_api(const char* username) {
+    METERED(API_REDO);
+    engine_init();
+    if(!username || read_only()) return 0;
+    Scope sc = { username, 0, 0, 0, SCOPE_REDO, NULL, 0 };
+    scope_lock(&sc);
+    User *u = sc.u;
+    int id = user_pop_redo(u);
+    if(id >= 0){
+        // perform redo logic similar to above
+        TaskNode *tn = task_lookup(id);
+        TaskDLL *held = task_holder_node(tn, u);
+        if(held){
+            // if present, redo might remove -> remove
+            unlinkDLLNode(held);
+            user_push_undo(u, id);
+        } else if(tn){
+            user_add_taskdll(u, tn);
+            user_push_undo(u, id);
+        }
+        enqueueUserNotif(u->username, "Redo performed");
+        replog_append(REC_REDO, username);
+    }
+    scope_unlock(&sc);
+    return id >= 0;
+}
+
+// list_tasks_api: returns JSON array for the user's assigned tasks. criterion is
+// "priority", "due", "status" or "created" (prefix "-" for descending) and
+// streams the user's materialized view; NULL/"" keeps assignment order.
+EXPORT const char* STDCALL list_tasks_api(const char* username, const char* criterion) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_LIST);
+    engine_init();
+    if(!username) return "[]";
+    int desc = criterion && criterion[0] == '-';
+    int crit = sort_criterion(desc ? criterion + 1 : criterion);
+    const char *r = "[]";
+    Scope sc = { username, 0, 0, 0, SCOPE_NONE, NULL, 0 };
+    scope_lock(&sc);
+    if(sc.u && crit < 0) r = user_tasks_to_json(sc.u, buf);
+    else if(sc.u){
+        user_view_activate(sc.u, crit);
+        JsonOut o;
+        json_begin(&o, buf, JSON_BUF);
+        view_to_json(sc.u->views[crit], &o, desc);
+        r = json_end(&o);
+    }
+    scope_unlock(&sc);
+    return r;
+}
+
+// notifications_api: broadcasts plus notifications addressed to this user
+EXPORT const char* STDCALL notifications_api(const char* username) {
+    METERED(API_NOTIFICATIONS);
+    engine_init();
+    return dequeueAllNotifsJSON(username ? username : "");
+}
+
+// manager_tasks_api: returns JSON array of all tasks (manager view); shards are walked in parallel and merged in creation order
+EXPORT const char* STDCALL manager_tasks_api(void) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_MANAGER_TASKS);
+    ShardListing ls[ENGINE_SHARDS];
+    engine_init();
+    memset(ls, 0, sizeof(ls));
+    shard_fanout(manager_tasks_job, ls);
+    return merge_listings(ls, buf);
+}
+
+// manager_notifications_api: aggregated notifications for every user
+EXPORT const char* STDCALL manager_notifications_api(void) {
+    METERED(API_MANAGER_NOTIFICATIONS);
+    engine_init();
+    return dequeueAllNotifsJSON(NULL);
+}
+
+// list_users_api
+EXPORT const char* STDCALL list_users_api(void) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_LIST_USERS);
+    engine_init();
+    int len = 1;
+    buf[0] = '[';
+    for(int s=0;s<ENGINE_SHARDS;s++){
+        mutex_lock(&shards[s].lock);
+        for(int i=0;i<shards[s].userCount;i++){
+            char tmp[128];
+            int n = snprintf(tmp, sizeof(tmp), "%s\"%s\"", len > 1 ? "," : "", shards[s].users[i]->username);
+            if(len + n + 2 > JSON_BUF){ metric_count(&jsonTruncations); break; }
+            memcpy(buf + len, tmp, n);
+            len += n;
+        }
+        mutex_unlock(&shards[s].lock);
+    }
+    buf[len++] = ']';
+    buf[len] = 0;
+    return buf;
+}
+
+// search_task_api (simple: find by substring in title across user's assigned tasks)
+EXPORT const char* STDCALL search_task_api(const char* username, const char* q) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_SEARCH);
+    engine_init();
+    JsonOut o;
+    json_begin(&o, buf, JSON_BUF);
+    if(!username || !q) return json_end(&o);
+    Scope sc = { username, 0, 0, 0, SCOPE_NONE, NULL, 0 };
+    scope_lock(&sc);
+    for(TaskDLL *it = sc.u ? sc.u->head : NULL; it; it = it->next){
+        if(strstr(it->task->title, q) && !json_task(&o, it->task, 0)) break;
+    }
+    scope_unlock(&sc);
+    return json_end(&o);
+}
+
+// filter_task_api (filter by status or priority for a user)
+EXPORT const char* STDCALL filter_task_api(const char* username, const char* status, int priority) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_FILTER);
+    engine_init();
+    JsonOut o;
+    json_begin(&o, buf, JSON_BUF);
+    if(!username) return json_end(&o);
+    Scope sc = { username, 0, 0, 0, SCOPE_NONE, NULL, 0 };
+    scope_lock(&sc);
+    for(TaskDLL *it = sc.u ? sc.u->head : NULL; it; it = it->next){
+        int ok = 1;
+        if(status && strlen(status)>0) ok &= (strcmp(it->task->status, status)==0);
+        if(priority>0) ok &= (it->task->priority == priority);
+        if(ok && !json_task(&o, it->task, 0)) break;
+    }
+    scope_unlock(&sc);
+    return json_end(&o);
+}
+
+// ---------- Set-algebra queries over the bitmap indexes ----------
+// Grammar (evaluated left to right, parentheses group):
+//   expr := term { ('&' | '|' | '-') term }      '-' is AND NOT
+//   term := '(' expr ')' | all | assigned | unassigned | blocked | ready
+//         | user:NAME | team:NAME | status:NAME | priority:N
+// NAME ends at a space, an operator or a parenthesis, so status:done-user:bob is
+// an AND NOT; quote NAME ("...") if it has any of those, e.g. user:"mary-jo".
+// blocked: tasks with a blocker that is not Completed; ready: tasks that are
+// neither Completed nor blocked; team:NAME: tasks held by any member of the team.
+// The expression is parsed once into a small tree, then evaluated in every
+// shard against that shard's sets; user:NAME and team:NAME sets and the blocked
+// set are snapshotted up front because they span shards.
+// Parentheses nest at most QUERY_MAX_DEPTH deep and a query has at most
+// QUERY_MAX_NODES terms and operators: both the parser and q_eval recurse, and
+// the expression comes straight from the HTTP query string.
+#define QUERY_MAX_DEPTH 64
+#define QUERY_MAX_NODES 1024
+
+enum { Q_ALL, Q_ASSIGNED, Q_UNASSIGNED, Q_BLOCKED, Q_READY, Q_USER, Q_TEAM, Q_STATUS, Q_PRIORITY, Q_OP };
+
+typedef struct {
+    int kind;
+    int op, lhs, rhs;            // Q_OP: RB_AND / RB_OR / RB_ANDNOT over two nodes
+    char name[MAX_USERNAME];     // Q_USER / Q_TEAM / Q_STATUS value
+    int priority;
+    Roaring snapshot;            // Q_USER: the user's assigned set; Q_TEAM: the union of the
+                                 // members' sets; Q_BLOCKED / Q_READY: depBlocked
+} QNode;
+
+typedef struct {
+    const char *p;
+    int err;
+    QNode *nodes;
+    int n, cap;
+} QueryParser;
+
+static int q_node(QueryParser *q, int kind){
+    if(q->n >= QUERY_MAX_NODES){ q->err = 1; return -1; }
+    if(q->n == q->cap){
+        int nc = q->cap ? q->cap * 2 : 8;
+        QNode *g = (QNode*)realloc(q->nodes, nc * sizeof(QNode));
+        if(!g){ q->err = 1; return -1; }
+        q->nodes = g;
+        q->cap = nc;
+    }
+    memset(&q->nodes[q->n], 0, sizeof(QNode));
+    q->nodes[q->n].kind = kind;
+    return q->n++;
+}
+
+static void q_skip(QueryParser *q){
+    while(*q->p == ' ' || *q->p == '\t') q->p++;
+}
+
+static void q_value(QueryParser *q, char *out, int n){
+    int k = 0;
+    if(*q->p == '"'){
+        q->p++;
+        while(*q->p && *q->p != '"'){ if(k < n-1) out[k++] = *q->p; q->p++; }
+        if(*q->p == '"') q->p++;
+        else q->err = 1;
+    } else {
+        while(*q->p && !strchr(" \t&|-()", *q->p)){ if(k < n-1) out[k++] = *q->p; q->p++; }
+    }
+    out[k] = 0;
+    if(k == 0) q->err = 1;
+}
+
+static int q_expr(QueryParser *q, int depth);
+
+static int q_term(QueryParser *q, int depth){
+    char word[16], val[MAX_USERNAME];
+    int k = 0, i = -1;
+    q_skip(q);
+    if(*q->p == '('){
+        if(depth >= QUERY_MAX_DEPTH){ q->err = 1; return -1; }
+        q->p++;
+        i = q_expr(q, depth + 1);
+        q_skip(q);
+        if(*q->p == ')') q->p++;
+        else q->err = 1;
+        return i;
+    }
+    while(((*q->p >= 'a' && *q->p <= 'z') || (*q->p >= 'A' && *q->p <= 'Z')) && k < (int)sizeof(word)-1)
+        word[k++] = *q->p++;
+    word[k] = 0;
+    if(strcmp(word, "all")==0) i = q_node(q, Q_ALL);
+    else if(strcmp(word, "assigned")==0) i = q_node(q, Q_ASSIGNED);
+    else if(strcmp(word, "unassigned")==0) i = q_node(q, Q_UNASSIGNED);
+    else if(strcmp(word, "blocked")==0) i = q_node(q, Q_BLOCKED);
+    else if(strcmp(word, "ready")==0) i = q_node(q, Q_READY);
+    else if(*q->p == ':'){
+        q->p++;
+        q_value(q, val, sizeof(val));
+        if(strcmp(word, "user")==0) i = q_node(q, Q_USER);
+        else if(strcmp(word, "team")==0) i = q_node(q, Q_TEAM);
+        else if(strcmp(word, "status")==0) i = q_node(q, Q_STATUS);
+        else if(strcmp(word, "priority")==0) i = q_node(q, Q_PRIORITY);
+        else q->err = 1;
+        if(i >= 0){
+            char *end;
+            strcpy(q->nodes[i].name, val);
+            q->nodes[i].priority = (int)strtol(val, &end, 10);
+            if(q->nodes[i].kind == Q_PRIORITY && (end == val || *end)) q->err = 1;
+        }
+    } else q->err = 1;
+    return i;
+}
+
+static int q_expr(QueryParser *q, int depth){
+    int lhs = q_term(q, depth);
+    while(!q->err){
+        int op;
+        q_skip(q);
+        if(*q->p == '&') op = RB_AND;
+        else if(*q->p == '|') op = RB_OR;
+        else if(*q->p == '-') op = RB_ANDNOT;
+        else break;
+        q->p++;
+        int rhs = q_term(q, depth);
+        int i = q_node(q, Q_OP);
+        if(i < 0) break;
+        q->nodes[i].op = op;
+        q->nodes[i].lhs = lhs;
+        q->nodes[i].rhs = rhs;
+        lhs = i;
+    }
+    return lhs;
+}
+
+static void query_free(QueryParser *q){
+    for(int i=0;i<q->n;i++) rb_free(&q->nodes[i].snapshot);
+    free(q->nodes);
+}
+
+// union of the team's members' assigned sets into out. The members' shard
+// locks come before the (leaf) team lock, so the shards are read from the team
+// first and widened until they cover every member, as in scope_lock; holding
+// them all plus the team lock, membership and holdings cannot move underneath.
+static void team_snapshot(const char *name, Roaring *out){
+    Team *tm = find_team(name, 0);
+    uint64_t mask = 0;
+    for(;;){
+        uint64_t need = mask;
+        if(!tm) return;
+        lock_shards(mask);
+        mutex_lock(&tm->lock);
+        for(int i=0;i<tm->count;i++) need |= SHARD_BIT(tm->heap[i]->u->shard);
+        for(int i=0;i<tm->count && need == mask;i++){
+            Roaring r;
+            rb_op(&r, out, &tm->heap[i]->u->assigned, RB_OR);
+            rb_free(out);
+            *out = r;
+        }
+        mutex_unlock(&tm->lock);
+        unlock_shards(mask);
+        if(need == mask) return;
+        mask = need;
+    }
+}
+
+// parse expr and snapshot the user and team sets it names; returns the root node or -1
+static int query_prepare(QueryParser *q, const char *expr){
+    memset(q, 0, sizeof(*q));
+    q->p = expr ? expr : "";
+    int root = q_expr(q, 0);
+    q_skip(q);
+    if(q->err || *q->p || root < 0) return -1;
+    for(int i=0;i<q->n;i++){
+        QNode *nd = &q->nodes[i];
+        if(nd->kind == Q_BLOCKED || nd->kind == Q_READY){
+            mutex_lock(&depLock);
+            rb_copy(&nd->snapshot, &depBlocked);
+            mutex_unlock(&depLock);
+        }
+        if(nd->kind == Q_TEAM) team_snapshot(nd->name, &nd->snapshot);
+        if(nd->kind != Q_USER) continue;
+        Shard *s = &shards[user_shard(nd->name)];
+        mutex_lock(&s->lock);
+        User *u = findUser(nd->name);
+        if(u) rb_copy(&nd->snapshot, &u->assigned);
+        mutex_unlock(&s->lock);
+    }
+    return root;
+}
+
+// evaluate node i against shard s (caller holds its lock)
+static void q_eval(const QueryParser *q, int i, Shard *s, Roaring *out){
+    const QNode *nd = &q->nodes[i];
+    Roaring *src = NULL;
+    memset(out, 0, sizeof(*out));
+    switch(nd->kind){
+    case Q_ALL: src = &s->allTasks; break;
+    case Q_ASSIGNED: src = &s->assignedTasks; break;
+    case Q_UNASSIGNED: rb_op(out, &s->allTasks, &s->assignedTasks, RB_ANDNOT); return;
+    case Q_BLOCKED: rb_op(out, &s->allTasks, &nd->snapshot, RB_AND); return;
+    case Q_READY: {
+        Roaring open, none;
+        Roaring *closed = status_set(s, CLOSED_STATUS, 0);
+        memset(&none, 0, sizeof(none));
+        rb_op(&open, &s->allTasks, closed ? closed : &none, RB_ANDNOT);
+        rb_op(out, &open, &nd->snapshot, RB_ANDNOT);
+        rb_free(&open);
+        return;
+    }
+    case Q_USER:
+    case Q_TEAM: src = (Roaring*)&nd->snapshot; break;
+    case Q_STATUS: src = status_set(s, nd->name, 0); break;
+    case Q_PRIORITY: src = priority_set(s, nd->priority, 0); break;
+    case Q_OP: {
+        Roaring a, b;
+        q_eval(q, nd->lhs, s, &a);
+        q_eval(q, nd->rhs, s, &b);
+        rb_op(out, &a, &b, nd->op);
+        rb_free(&a);
+        rb_free(&b);
+        return;
+    }
+    }
+    if(src) rb_copy(out, src);
+}
+
+typedef struct {
+    QueryParser *q;
+    int root;
+    int count[ENGINE_SHARDS];
+    ShardListing *ls;             // NULL: count only
+} QueryRun;
+
+static int listing_add_by_id(int id, void *ctx){
+    Shard *s = (Shard*)((void**)ctx)[0];
+    TaskNode *t = bst_search(s->taskRoot, id);
+    return t ? listing_add((ShardListing*)((void**)ctx)[1], t, 0) : 1;
+}
+
+static void query_job(Shard *s, void *ctx){
+    QueryRun *run = (QueryRun*)ctx;
+    int si = (int)(s - shards);
+    Roaring r, mine;
+    mutex_lock(&s->lock);
+    q_eval(run->q, run->root, s, &r);
+    rb_op(&mine, &r, &s->allTasks, RB_AND); // user snapshots hold ids of every shard
+    run->count[si] = rb_cardinality(&mine);
+    if(run->ls){
+        void *args[2] = { s, &run->ls[si] };
+        rb_foreach(&mine, listing_add_by_id, args);
+    }
+    mutex_unlock(&s->lock);
+    rb_free(&r);
+    rb_free(&mine);
+}
+
+// query_count_api: number of tasks matching a set expression, -1 if it does not parse
+EXPORT int STDCALL query_count_api(const char* expr) {
+    METERED(API_QUERY_COUNT);
+    QueryParser q;
+    QueryRun run;
+    engine_init();
+    int n = -1;
+    memset(&run, 0, sizeof(run));
+    run.root = query_prepare(&q, expr);
+    if(run.root >= 0){
+        run.q = &q;
+        shard_fanout(query_job, &run);
+        n = 0;
+        for(int i=0;i<ENGINE_SHARDS;i++) n += run.count[i];
+    }
+    query_free(&q);
+    return n;
+}
+
+// query_tasks_api: tasks matching a set expression, in creation order (truncated to the JSON buffer)
+EXPORT const char* STDCALL query_tasks_api(const char* expr) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_QUERY_TASKS);
+    ShardListing ls[ENGINE_SHARDS];
+    QueryParser q;
+    QueryRun run;
+    engine_init();
+    const char *r = "[]";
+    memset(&run, 0, sizeof(run));
+    memset(ls, 0, sizeof(ls));
+    run.root = query_prepare(&q, expr);
+    if(run.root >= 0){
+        run.q = &q;
+        run.ls = ls;
+        shard_fanout(query_job, &run);
+        r = merge_listings(ls, buf);
+    }
+    query_free(&q);
+    return r;
+}
+
+typedef struct {
+    int users[ENGINE_SHARDS];
+    int created[ENGINE_SHARDS];
+    int live[ENGINE_SHARDS];
+} AnalyticsRun;
+
+static void analytics_job(Shard *s, void *ctx){
+    AnalyticsRun *run = (AnalyticsRun*)ctx;
+    int si = (int)(s - shards);
+    mutex_lock(&s->lock);
+    run->users[si] = s->userCount;
+    run->created[si] = s->nextSeq - 1;
+    run->live[si] = s->liveTaskCount;
+    mutex_unlock(&s->lock);
+}
+
+// analytics_api (basic stats, summed over the shards)
+EXPORT const char* STDCALL analytics_api(const char* username) {
+    static THREAD_LOCAL char buf[256];
+    METERED(API_ANALYTICS);
+    AnalyticsRun run;
+    int users = 0, created = 0, live = 0;
+    (void)username;
+    engine_init();
+    shard_fanout(analytics_job, &run);
+    for(int i=0;i<ENGINE_SHARDS;i++){
+        users += run.users[i];
+        created += run.created[i];
+        live += run.live[i];
+    }
+    snprintf(buf,sizeof(buf), "{\"users\":%d,\"tasks_total_estimate\":%d,\"tasks_live\":%d}", users, created, live);
+    return buf;
+}
+
+// sort_tasks_api: materialize (and from then on maintain) a sorted view for the
+// user so list_tasks can stream it; 0 for an unknown user or criterion
+EXPORT int STDCALL sort_tasks_api(const char* username, const char* criterion) {
+    METERED(API_SORT);
+    engine_init();
+    int crit = sort_criterion(criterion && criterion[0] == '-' ? criterion + 1 : criterion);
+    if(!username || crit < 0) return 0;
+    Scope sc = { username, 0, 0, 0, SCOPE_NONE, NULL, 0 };
+    scope_lock(&sc);
+    if(sc.u) user_view_activate(sc.u, crit);
+    scope_unlock(&sc);
+    return sc.u != NULL;
+}
+
+// save/load placeholders
+EXPORT int STDCALL save_data_api(const char* filename) { (void)filename; return 1; }
+EXPORT int STDCALL load_data_api(const char* filename) { (void)filename; return 1; }
+
+// clear_notifications_api: empty every shard's ring
+EXPORT int STDCALL clear_notifications_api(const char* username) {
+    METERED(API_CLEAR_NOTIFICATIONS);
+    engine_init();
+    if(read_only()) return 0;
+    trace_untraced("clear_notifications_api");
+    lock_shards(ALL_SHARDS); // keeps a snapshot from landing between the record and the clear
+    replog_append(REC_CLEAR_NOTIF, username);
+    for(int i=0;i<ENGINE_SHARDS;i++){
+        NotifRing *q = &shards[i].notif;
+        mutex_lock(&q->lock);
+        q->front = 0; q->rear = -1; q->count = 0;
+        mutex_unlock(&q->lock);
+    }
+    unlock_shards(ALL_SHARDS);
+    return 1;
+}
+
+// scheduler_start_api: start one due-date thread per shard. remind_before_seconds < 0
+// keeps the current lead time; flip_status != 0 marks overdue tasks OVERDUE_STATUS.
+// Returns 0 on a follower, which replays the primary's due-date events instead.
+EXPORT int STDCALL scheduler_start_api(int remind_before_seconds, int flip_status) {
+    engine_init();
+    if(read_only()) return 0;
+    lock_shards(ALL_SHARDS);
+    if(remind_before_seconds >= 0) remindBefore = remind_before_seconds;
+    flipOverdue = flip_status != 0;
+    int ok = 1;
+    for(int s=0;s<ENGINE_SHARDS;s++){
+        // keys depend on remindBefore: rebuild the heap order
+        for(int i = shards[s].schedCount/2 - 1; i >= 0; i--) sched_sift_down(&shards[s], i);
+        cond_signal(&shards[s].schedWake);
+    }
+    if(!schedRunning){
+        int started = 0;
+        schedRunning = 1;
+        while(started < ENGINE_SHARDS && thread_start(&shards[started].schedThread, scheduler_main, &shards[started]))
+            started++;
+        if(started < ENGINE_SHARDS){
+            // could not start them all: stop the ones that did
+            ok = 0;
+            schedRunning = 0;
+            unlock_shards(ALL_SHARDS);
+            for(int s=0;s<started;s++){
+                cond_signal(&shards[s].schedWake);
+                thread_join(shards[s].schedThread);
+            }
+            return ok;
+        }
+    }
+    unlock_shards(ALL_SHARDS);
+    return ok;
+}
+
+// scheduler_stop_api: stop and join the due-date threads
+EXPORT int STDCALL scheduler_stop_api(void) {
+    engine_init();
+    lock_shards(ALL_SHARDS);
+    int wasRunning = schedRunning;
+    schedRunning = 0;
+    for(int s=0;s<ENGINE_SHARDS;s++) cond_signal(&shards[s].schedWake);
+    unlock_shards(ALL_SHARDS);
+    if(wasRunning) for(int s=0;s<ENGINE_SHARDS;s++) thread_join(shards[s].schedThread);
+    return wasRunning;
+}
+
+// ---------- Teams and load-aware assignment ----------
+// A team is a named set of users; auto_assign_api hands a task to the member
+// with the least load (see task_weight) who does not already hold it, and
+// auto_assign_all_api spreads a team's share of the unassigned backlog.
+// Membership is logged (REC_TEAM) and the assignments themselves go out as
+// ordinary REC_ASSIGN records, so a follower ends up with the same holders.
+
+// team_join_api: add a user (created when missing) to a team, creating the team
+// on first use. Returns 1, or 0 if the user already is a member
+EXPORT int STDCALL team_join_api(const char* team, const char* username) {
+    METERED(API_TEAM_JOIN);
+    engine_init();
+    if(!team || !*team || !username || read_only()) return 0;
+    trace_untraced("team_join_api");
+    Team *tm = find_team(team, 1);
+    Shard *s = &shards[user_shard(username)];
+    int ok = 0;
+    mutex_lock(&s->lock);
+    User *u = createOrGetUser(username);
+    if(tm && u && user_team_slot(u, tm) < 0){
+        TeamMember *m = (TeamMember*)calloc(1, sizeof(TeamMember));
+        if(m && u->teamCount == u->teamCap){
+            int nc = u->teamCap ? u->teamCap * 2 : 2;
+            TeamMember **g = (TeamMember**)realloc(u->teams, nc * sizeof(TeamMember*));
+            if(g){ u->teams = g; u->teamCap = nc; }
+        }
+        mutex_lock(&tm->lock);
+        if(m && tm->count == tm->cap){
+            int nc = tm->cap ? tm->cap * 2 : 8;
+            TeamMember **g = (TeamMember**)realloc(tm->heap, nc * sizeof(TeamMember*));
+            if(g){ tm->heap = g; tm->cap = nc; }
+        }
+        if(m && u->teamCount < u->teamCap && tm->count < tm->cap){
+            m->u = u;
+            m->team = tm;
+            m->load = u->load;
+            m->seq = tm->nextSeq++;
+            u->teams[u->teamCount++] = m;
+            team_set(tm, tm->count++, m);
+            team_sift(tm, m->pos);
+            ok = 1;
+        }
+        mutex_unlock(&tm->lock);
+        if(!ok) free(m);
+    }
+    replog_append(REC_TEAM, team, username, 1);
+    mutex_unlock(&s->lock);
+    return ok;
+}
+
+// team_leave_api: take a user out of a team; their tasks stay assigned. Returns 1 if they were a member
+EXPORT int STDCALL team_leave_api(const char* team, const char* username) {
+    METERED(API_TEAM_LEAVE);
+    engine_init();
+    if(!team || !username || read_only()) return 0;
+    trace_untraced("team_leave_api");
+    Team *tm = find_team(team, 0);
+    Shard *s = &shards[user_shard(username)];
+    int ok = 0;
+    mutex_lock(&s->lock);
+    User *u = findUser(username);
+    int slot = tm && u ? user_team_slot(u, tm) : -1;
+    if(slot >= 0){
+        TeamMember *m = u->teams[slot];
+        mutex_lock(&tm->lock);
+        TeamMember *last = tm->heap[--tm->count];
+        if(last != m){
+            team_set(tm, m->pos, last);
+            team_sift(tm, last->pos);
+        }
+        mutex_unlock(&tm->lock);
+        u->teams[slot] = u->teams[--u->teamCount];
+        free(m);
+        ok = 1;
+    }
+    replog_append(REC_TEAM, team, username, 0);
+    mutex_unlock(&s->lock);
+    return ok;
+}
+
+typedef struct { const char *user; long long load; unsigned seq; } MemberRow;
+
+static int compareMemberRow(const void *a, const void *b){
+    const MemberRow *x = (const MemberRow*)a, *y = (const MemberRow*)b;
+    if(x->load != y->load) return x->load < y->load ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+// team_members_api: JSON array of {"user","load"}, least loaded first (truncated to the JSON buffer)
+EXPORT const char* STDCALL team_members_api(const char* team) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_TEAM_MEMBERS);
+    engine_init();
+    Team *tm = team ? find_team(team, 0) : NULL;
+    MemberRow *rows = NULL;
+    int n = 0, len = 1;
+    if(tm){
+        mutex_lock(&tm->lock);
+        rows = (MemberRow*)malloc((tm->count ? tm->count : 1) * sizeof(MemberRow));
+        for(int i=0; rows && i<tm->count; i++){
+            // usernames never change once created, so the members' shards need not be locked
+            rows[n].user = tm->heap[i]->u->username;
+            rows[n].load = tm->heap[i]->load;
+            rows[n++].seq = tm->heap[i]->seq;
+        }
+        mutex_unlock(&tm->lock);
+        qsort(rows, n, sizeof(MemberRow), compareMemberRow);
+    }
+    buf[0] = '[';
+    for(int i=0;i<n;i++){
+        char tmp[128];
+        int w = snprintf(tmp, sizeof(tmp), "%s{\"user\":\"%s\",\"load\":%lld}", i ? "," : "", rows[i].user, rows[i].load);
+        if(len + w + 2 > JSON_BUF){ metric_count(&jsonTruncations); break; }
+        memcpy(buf + len, tmp, w);
+        len += w;
+    }
+    buf[len++] = ']';
+    buf[len] = 0;
+    free(rows);
+    return buf;
+}
+
+// auto_assign_api: assign a task to the least-loaded member of a team who does not hold it
+// yet. Returns {"id","user"} or {"error":...}. The pick and the assignment are two steps,
+// so calls racing on one team may pick the same member.
+EXPORT const char* STDCALL auto_assign_api(int id, const char* team) {
+    static THREAD_LOCAL char buf[128];
+    METERED(API_AUTO_ASSIGN);
+    engine_init();
+    if(read_only()) return "{\"error\":\"read-only replica\"}";
+    Team *tm = team ? find_team(team, 0) : NULL;
+    if(!tm) return "{\"error\":\"unknown team\"}";
+    // the task's current holders are not eligible; users are never freed, so
+    // the pointers stay valid after the shard is unlocked
+    uint64_t mask = SHARD_BIT(task_shard(id));
+    int nheld = 0;
+    lock_shards(mask);
+    TaskNode *t = task_lookup(id);
+    int exists = t != NULL;
+    User **held = t ? (User**)malloc((t->assigneeCount + 1) * sizeof(User*)) : NULL;
+    for(TaskDLL *it = held ? t->assignees : NULL; it; it = it->tnext) held[nheld++] = it->owner;
+    unlock_shards(mask);
+    if(!exists) return "{\"error\":\"unknown task\"}";
+    if(!held) return "{\"error\":\"out of memory\"}";
+    char chosen[MAX_USERNAME] = "";
+    mutex_lock(&tm->lock);
+    TeamMember *m = team_pick(tm, held, nheld);
+    if(m) strcpy(chosen, m->u->username);
+    mutex_unlock(&tm->lock);
+    free(held);
+    if(!*chosen) return "{\"error\":\"no eligible member\"}";
+    trace_untraced("auto_assign_api");
+    if(!assign_task_api(tm->name, chosen, id)) return "{\"error\":\"unknown task\"}";
+    snprintf(buf, sizeof(buf), "{\"id\":%d,\"user\":\"%s\"}", id, chosen);
+    return buf;
+}
+
+typedef struct { int *ids; int n, cap; } IdList;
+
+static int collect_open(int id, void *ctx){
+    IdList *l = (IdList*)ctx;
+    if(l->n == l->cap){
+        int nc = l->cap ? l->cap * 2 : 256;
+        int *g = (int*)realloc(l->ids, nc * sizeof(int));
+        if(!g) return 0;
+        l->ids = g;
+        l->cap = nc;
+    }
+    l->ids[l->n++] = id;
+    return 1;
+}
+
+// auto_assign_all_api: give every open, unassigned task to the team, each to the member that
+// is least loaded at that point, heaviest tasks first. limit > 0 caps how many are handed out.
+// Each assignment is a heap read plus one sift: O(n log members). Holds every shard lock.
+// Returns the number assigned, or -1 for an unknown team or a read-only replica.
+EXPORT int STDCALL auto_assign_all_api(const char* team, int limit) {
+    METERED(API_AUTO_ASSIGN_ALL);
+    engine_init();
+    Team *tm = team ? find_team(team, 0) : NULL;
+    if(!tm || read_only()) return -1;
+    trace_untraced("auto_assign_all_api");
+    IdList open[4];                      // by task_weight: 3, 2, 1
+    memset(open, 0, sizeof(open));
+    int done = 0;
+    lock_shards(ALL_SHARDS);
+    for(int i=0;i<ENGINE_SHARDS;i++){
+        Roaring un;
+        rb_op(&un, &shards[i].allTasks, &shards[i].assignedTasks, RB_ANDNOT);
+        IdList l = { NULL, 0, 0 };
+        rb_foreach(&un, collect_open, &l);
+        for(int k=0;k<l.n;k++){
+            int w = task_weight(task_lookup(l.ids[k]));
+            if(w) collect_open(l.ids[k], &open[w]);
+        }
+        free(l.ids);
+        rb_free(&un);
+    }
+    // joining and leaving take a shard lock, so the membership is fixed from here on
+    for(int w=3; w>=1; w--){
+        for(int k=0; k<open[w].n && (limit <= 0 || done < limit); k++){
+            mutex_lock(&tm->lock);
+            User *u = tm->count ? tm->heap[0]->u : NULL;
+            mutex_unlock(&tm->lock);
+            if(!u) break;
+            assign_locked(tm->name, u, task_lookup(open[w].ids[k]));
+            replog_append(REC_ASSIGN, tm->name, u->username, open[w].ids[k]);
+            done++;
+        }
+    }
+    unlock_shards(ALL_SHARDS);
+    for(int w=1; w<=3; w++) free(open[w].ids);
+    return done;
+}
+
+// ---------- Dependency API ----------
+// add_dependency_api: task waits on blocker. Returns 1, 0 if either task is unknown, they
+// are the same or the edge exists, -1 if blocker already (transitively) waits on task
+EXPORT int STDCALL add_dependency_api(int id, int blocker) {
+    METERED(API_DEP_ADD);
+    engine_init();
+    if(id == blocker || read_only()) return 0;
+    trace_untraced("add_dependency_api");
+    uint64_t mask = SHARD_BIT(task_shard(id)) | SHARD_BIT(task_shard(blocker));
+    int res = 0;
+    lock_shards(mask);
+    TaskNode *t = task_lookup(id), *b = task_lookup(blocker);
+    if(t && b){
+        mutex_lock(&depLock);
+        DepNode *tn = dep_node(t), *bn = dep_node(b);
+        int dup = 0;
+        for(int i=0; tn && i<tn->nBlockers && !dup; i++) dup = tn->blockers[i] == bn;
+        if(tn && bn && !dup){
+            int r = dep_reorder(bn, tn);
+            res = r == 0 ? -1 : r == 1;
+            if(res == 1 && !dep_push(&bn->blocks, &bn->nBlocks, &bn->capBlocks, tn)) res = 0;
+            if(res == 1 && !dep_push(&tn->blockers, &tn->nBlockers, &tn->capBlockers, bn)){
+                bn->nBlocks--;
+                res = 0;
+            }
+            if(res == 1){
+                if(!bn->done) dep_open_add(tn, 1);
+                dep_touch(tn);
+            }
+        }
+        mutex_unlock(&depLock);
+    }
+    if(res == 1) replog_append(REC_DEP, id, blocker, 1);
+    unlock_shards(mask);
+    return res;
+}
+
+// remove_dependency_api: task no longer waits on blocker. Returns 1 if the edge existed
+EXPORT int STDCALL remove_dependency_api(int id, int blocker) {
+    METERED(API_DEP_REMOVE);
+    engine_init();
+    if(read_only()) return 0;
+    trace_untraced("remove_dependency_api");
+    uint64_t mask = SHARD_BIT(task_shard(id)) | SHARD_BIT(task_shard(blocker));
+    int res = 0;
+    lock_shards(mask);
+    TaskNode *t = task_lookup(id), *b = task_lookup(blocker);
+    if(t && b && t->dep && b->dep){
+        mutex_lock(&depLock);
+        DepNode *tn = t->dep, *bn = b->dep;
+        if(dep_unlink(tn->blockers, &tn->nBlockers, bn)){
+            dep_unlink(bn->blocks, &bn->nBlocks, tn);
+            if(!bn->done) dep_open_add(tn, -1);
+            dep_touch(tn);
+            res = 1;
+        }
+        mutex_unlock(&depLock);
+    }
+    if(res) replog_append(REC_DEP, id, blocker, 0);
+    unlock_shards(mask);
+    return res;
+}
+
+static int dep_ids_json(char *buf, int len, DepNode **nodes, int n){
+    for(int i=0;i<n;i++){
+        char tmp[16];
+        int w = snprintf(tmp, sizeof(tmp), "%s%d", i ? "," : "", nodes[i]->id);
+        if(len + w + 8 > JSON_BUF){ metric_count(&jsonTruncations); break; }
+        memcpy(buf + len, tmp, w);
+        len += w;
+    }
+    return len;
+}
+
+// task_dependencies_api: {"id","blocked","blockers":[ids],"blocks":[ids]}, or {"error":...}
+EXPORT const char* STDCALL task_dependencies_api(int id) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_DEPS);
+    engine_init();
+    uint64_t mask = SHARD_BIT(task_shard(id));
+    const char *r = buf;
+    lock_shards(mask);
+    TaskNode *t = task_lookup(id);
+    if(t){
+        mutex_lock(&depLock);
+        DepNode *n = t->dep;
+        int len = snprintf(buf, JSON_BUF, "{\"id\":%d,\"blocked\":%s,\"blockers\":[", id, n && n->open ? "true" : "false");
+        if(n) len = dep_ids_json(buf, len, n->blockers, n->nBlockers);
+        len += snprintf(buf + len, JSON_BUF - len, "],\"blocks\":[");
+        if(n) len = dep_ids_json(buf, len, n->blocks, n->nBlocks);
+        snprintf(buf + len, JSON_BUF - len, "]}");
+        mutex_unlock(&depLock);
+    } else r = "{\"error\":\"unknown task\"}";
+    unlock_shards(mask);
+    return r;
+}
+
+// the node of task id, NULL if it has none (takes and drops the task's shard lock)
+static DepNode* dep_lookup(int id, int *exists){
+    uint64_t mask = SHARD_BIT(task_shard(id));
+    lock_shards(mask);
+    TaskNode *t = task_lookup(id);
+    DepNode *n = t ? t->dep : NULL;
+    *exists = t != NULL;
+    if(n) mutex_lock(&depLock);   // handed over locked, so the node cannot be dropped in between
+    unlock_shards(mask);
+    return n;
+}
+
+// topo_order_api: open tasks in an order that never starts one before its blockers. For
+// id > 0, the open tasks id transitively waits on, ending with id itself; for 0, every open
+// task with dependencies. JSON array of ids, or {"error":...}
+EXPORT const char* STDCALL topo_order_api(int id) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_TOPO_ORDER);
+    engine_init();
+    DepNode *n = NULL;
+    int exists = 1, k = 0;
+    if(id > 0){
+        n = dep_lookup(id, &exists);
+        if(!exists) return "{\"error\":\"unknown task\"}";
+        if(!n) return "[]";
+    } else mutex_lock(&depLock);
+    DepNode **set = (DepNode**)malloc((depOrderLen + 1) * sizeof(DepNode*));
+    DepNode **st = n ? (DepNode**)malloc((depOrderLen + 1) * sizeof(DepNode*)) : NULL;
+    const char *r = buf;
+    if(!set || (n && !st)) r = "{\"error\":\"out of memory\"}";
+    else if(n){
+        // upstream of n through open tasks only: a done blocker holds nothing up
+        int sp = 0;
+        unsigned stamp = ++depStamp;
+        n->mark = stamp;
+        if(!n->done) st[sp++] = n;
+        while(sp){
+            DepNode *x = st[--sp];
+            set[k++] = x;
+            for(int i=0;i<x->nBlockers;i++){
+                DepNode *w = x->blockers[i];
+                if(!w->done && w->mark != stamp){ w->mark = stamp; st[sp++] = w; }
+            }
+        }
+        qsort(set, k, sizeof(DepNode*), compareDepOrd);
+    } else {
+        for(int i=0;i<depOrderLen;i++) if(depOrder[i] && !depOrder[i]->done) set[k++] = depOrder[i];
+    }
+    if(r == buf){
+        buf[0] = '[';
+        int len = dep_ids_json(buf, 1, set, k);
+        buf[len++] = ']';
+        buf[len] = 0;
+    }
+    mutex_unlock(&depLock);
+    free(set);
+    free(st);
+    return r;
+}
+
+// critical_path_api: the longest chain of open tasks ending at id (for 0: anywhere), as
+// {"length":n,"path":[ids, first to start first]}. Only nodes dirtied since the last
+// query are recomputed.
+EXPORT const char* STDCALL critical_path_api(int id) {
+    static THREAD_LOCAL char buf[JSON_BUF];
+    METERED(API_CRITICAL_PATH);
+    engine_init();
+    DepNode *end = NULL;
+    int exists = 1, ok = 1;
+    if(id > 0){
+        end = dep_lookup(id, &exists);
+        if(!exists) return "{\"error\":\"unknown task\"}";
+        if(!end) return "{\"length\":0,\"path\":[]}";
+        ok = dep_refresh(end);
+    } else {
+        mutex_lock(&depLock);
+        // depOrder is topological, so one pass recomputes every dirty node after its blockers
+        for(int i=0;i<depOrderLen;i++){
+            DepNode *x = depOrder[i];
+            if(!x) continue;
+            if(x->dirty) dep_compute(x);
+            if(!end || x->chain > end->chain) end = x;
+        }
+    }
+    int k = 0;
+    for(DepNode *x = end; x && x->chain > 0; x = x->via) k++;
+    DepNode **path = (DepNode**)malloc((k + 1) * sizeof(DepNode*));
+    const char *r = buf;
+    if(!ok || !path) r = "{\"error\":\"out of memory\"}";
+    else {
+        int i = k;
+        for(DepNode *x = end; x && x->chain > 0; x = x->via) path[--i] = x;
+        int len = snprintf(buf, JSON_BUF, "{\"length\":%d,\"path\":[", k);
+        len = dep_ids_json(buf, len, path, k);
+        snprintf(buf + len, JSON_BUF - len, "]}");
+    }
+    mutex_unlock(&depLock);
+    free(path);
+    return r;
+}
+
+// ---------- Bulk import / export ----------
+// NDJSON: one object per line. A line with a "title" is a task,
+//   {"user":"alice","title":"...","priority":2,"due":"2025-01-31","status":"Pending","assignees":["bob"]}
+// one without is a user: {"user":"bob","password":"..."}. Other keys ("id", "time") are ignored.
+// CSV: a header row naming the columns (user, title, priority, due, status, assignees,
+// password; any order, unknown ones ignored), then one record per line. A row with an empty
+// title is a user and assignees are separated by ';'. Fields may be quoted ("" escapes a
+// quote), but a record never spans lines.
+//
+// Import streams the file in IMPORT_BLOCK pieces. Each piece is cut at line boundaries and
+// parsed on IMPORT_THREADS threads; then one thread per group of shards creates the users
+// and task nodes homed there, and a single pass links holders and logs the records in file
+// order, so a follower replaying them gets the same ids and lists. The shard treaps, bitmap
+// indexes and deadline heaps are built once, after the last piece. Import holds every shard
+// lock while it runs and hands out fresh ids: an "id" in the file is not kept.
+#ifndef IMPORT_THREADS
+#define IMPORT_THREADS 8
+#endif
+#define IMPORT_BLOCK (16 << 20)
+#define IMPORT_MAX_COLS 32
+
+enum { IMP_SKIP, IMP_USER, IMP_TASK };
+enum { F_USER, F_TITLE, F_PRIORITY, F_DUE, F_STATUS, F_ASSIGNEES, F_PASSWORD, F_COUNT };
+static const char *importFields[F_COUNT] = { "user", "title", "priority", "due", "status", "assignees", "password" };
+
+typedef struct {
+    int kind;
+    int home;                    // shard of user
+    int priority;
+    int created;                 // the line's user did not exist before it
+    char *f[F_COUNT];            // fields, parsed in place; assignees '\n'-separated
+    TaskNode *node;
+} ImportRec;
+
+typedef struct {
+    char *text;                  // whole lines of the current piece
+    size_t len;
+    ImportRec *recs;
+    int n, cap;
+} ImportChunk;
+
+typedef struct {
+    TaskNode **nodes;            // created by this import, ascending ids
+    int n, cap;
+} ImportNodes;
+
+typedef struct {
+    int csv;
+    int cols[IMPORT_MAX_COLS];   // CSV column -> field, -1 to ignore
+    int ncols;
+    time_t now;
+    int workers;                 // threads per phase
+    ImportChunk chunks[IMPORT_THREADS];
+    ImportNodes created[ENGINE_SHARDS];
+    int tasks, skipped;
+} Import;
+
+typedef struct {
+    Import *im;
+    int index;                   // chunk to parse, or shard group (shards with k % workers == index)
+} ImportJob;
+
+// run fn on jobs[0..n): n-1 threads plus the caller; a job whose thread cannot start runs inline
+static void run_parallel(EngineThreadFn fn, ImportJob *jobs, int n){
+    EngineThread th[IMPORT_THREADS];
+    int started[IMPORT_THREADS] = {0};
+    for(int i=1;i<n;i++) started[i] = thread_start(&th[i], fn, &jobs[i]);
+    fn(&jobs[0]);
+    for(int i=1;i<n;i++){
+        if(started[i]) thread_join(th[i]);
+        else fn(&jobs[i]);
+    }
+}
+
+static int import_field(const char *name){
+    for(int i=0;i<F_COUNT;i++) if(strcmp(name, importFields[i])==0) return i;
+    return -1;
+}
+
+static char* skip_ws(char *p){
+    while(*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+static char* put_utf8(char *w, unsigned v){
+    if(v < 0x80) *w++ = (char)v;
+    else if(v < 0x800){ *w++ = (char)(0xC0 | (v >> 6)); *w++ = (char)(0x80 | (v & 0x3F)); }
+    else if(v < 0x10000){ *w++ = (char)(0xE0 | (v >> 12)); *w++ = (char)(0x80 | ((v >> 6) & 0x3F)); *w++ = (char)(0x80 | (v & 0x3F)); }
+    else { *w++ = (char)(0xF0 | (v >> 18)); *w++ = (char)(0x80 | ((v >> 12) & 0x3F)); *w++ = (char)(0x80 | ((v >> 6) & 0x3F)); *w++ = (char)(0x80 | (v & 0x3F)); }
+    return w;
+}
+
+static int hex4(const char *p, unsigned *v){
+    *v = 0;
+    for(int i=0;i<4;i++){
+        char c = p[i];
+        int d = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if(d < 0) return 0;
+        *v = *v << 4 | (unsigned)d;
+    }
+    return 1;
+}
+
+// unescape the JSON string starting just past its opening quote, in place
+// (the result is never longer than its source); *pp moves past the closing quote
+static char* json_string(char **pp){
+    char *r = *pp, *w = *pp, *start = *pp;
+    while(*r != '"'){
+        if(!*r) return NULL;
+        if(*r != '\\'){ *w++ = *r++; continue; }
+        r++;
+        switch(*r){
+        case 'n': *w++ = '\n'; break;
+        case 't': *w++ = '\t'; break;
+        case 'r': *w++ = '\r'; break;
+        case 'b': *w++ = '\b'; break;
+        case 'f': *w++ = '\f'; break;
+        case 'u': {
+            unsigned v, lo;
+            if(!hex4(r + 1, &v)) return NULL;
+            r += 4;
+            if(v >= 0xD800 && v < 0xDC00 && r[1] == '\\' && r[2] == 'u' && hex4(r + 3, &lo) && lo >= 0xDC00 && lo < 0xE000){
+                v = 0x10000 + ((v - 0xD800) << 10) + (lo - 0xDC00);
+                r += 6;
+            }
+            w = put_utf8(w, v);
+            break;
+        }
+        case 0: return NULL;
+        default: *w++ = *r; break;   // \" \\ \/
+        }
+        r++;
+    }
+    *pp = r + 1;
+    *w = 0;
+    return start;
+}
+
+// one flat NDJSON object; assignee arrays are joined with '\n' in place
+static int parse_ndjson(char *line, char **f){
+    char *p = skip_ws(line);
+    if(*p++ != '{') return 0;
+    p = skip_ws(p);
+    if(*p == '}') return 1;
+    for(;;){
+        if(*p++ != '"') return 0;
+        char *key = json_string(&p);
+        if(!key) return 0;
+        p = skip_ws(p);
+        if(*p++ != ':') return 0;
+        p = skip_ws(p);
+        int k = import_field(key);
+        char *val;
+        if(*p == '"'){
+            p++;
+            if(!(val = json_string(&p))) return 0;
+        } else if(*p == '['){
+            char *w = val = ++p;
+            int first = 1;
+            for(;;){
+                p = skip_ws(p);
+                if(*p == ']'){ p++; break; }
+                if(!first){
+                    if(*p++ != ',') return 0;
+                    p = skip_ws(p);
+                }
+                if(*p++ != '"') return 0;
+                char *s = json_string(&p);
+                if(!s) return 0;
+                if(!first) *w++ = '\n';
+                size_t n = strlen(s);
+                memmove(w, s, n);
+                w += n;
+                first = 0;
+            }
+            *w = 0;
+            if(first) val = NULL;
+        } else {
+            // number or literal: terminate it once the next delimiter has been read
+            char *end = val = p;
+            while(*end && *end != ',' && *end != '}' && *end != ' ' && *end != '\t') end++;
+            p = skip_ws(end);
+            char next = *p;
+            *end = 0;
+            if(strcmp(val, "null")==0) val = NULL;
+            if(k >= 0) f[k] = val;
+            if(next == ','){ p = skip_ws(p + 1); continue; }
+            return next == '}';
+        }
+        if(k >= 0) f[k] = val;
+        p = skip_ws(p);
+        if(*p == ','){ p = skip_ws(p + 1); continue; }
+        return *p == '}';
+    }
+}
+
+// split a CSV line in place; returns the field count (fields beyond max are dropped) or -1
+static int csv_fields(char *line, char **out, int max){
+    char *p = line;
+    for(int c=0;;c++){
+        char *val = p, *w = p;
+        if(*p == '"'){
+            val = w = ++p;
+            for(;;){
+                if(!*p) return -1;
+                if(*p == '"'){
+                    if(p[1] != '"'){ p++; break; }
+                    p++;
+                }
+                *w++ = *p++;
+            }
+        } else {
+            while(*p && *p != ',') p++;
+            w = p;
+        }
+        char next = *p;
+        *w = 0;
+        if(c < max) out[c] = val;
+        if(next != ',') return next ? -1 : c + 1;
+        p++;
+    }
+}
+
+static void cut_name(char *s){
+    if(s && strlen(s) >= MAX_USERNAME) s[MAX_USERNAME-1] = 0;
+}
+
+// usernames are cut to what createOrGetUser stores, so every later lookup finds them
+static void import_names(char *list){
+    char *w = list, *r = list;
+    while(*r){
+        char *end = r + strcspn(r, "\n");
+        size_t n = end - r;
+        if(n >= MAX_USERNAME) n = MAX_USERNAME - 1;
+        if(n){
+            if(w > list) *w++ = '\n';
+            memmove(w, r, n);
+            w += n;
+        }
+        r = *end ? end + 1 : end;
+    }
+    *w = 0;
+}
+
+static int import_parse(const Import *im, char *line, ImportRec *r){
+    memset(r, 0, sizeof(*r));
+    if(im->csv){
+        char *raw[IMPORT_MAX_COLS];
+        int n = csv_fields(line, raw, IMPORT_MAX_COLS);
+        if(n < 0) return IMP_SKIP;
+        for(int c=0;c<n && c<im->ncols;c++)
+            if(im->cols[c] >= 0) r->f[im->cols[c]] = raw[c];
+        if(r->f[F_TITLE] && !*r->f[F_TITLE]) r->f[F_TITLE] = NULL;
+        for(char *a = r->f[F_ASSIGNEES]; a && *a; a++) if(*a == ';') *a = '\n';
+    } else if(!parse_ndjson(line, r->f)) {
+        return IMP_SKIP;
+    }
+    if(!r->f[F_USER]) r->f[F_USER] = "";
+    cut_name(r->f[F_USER]);
+    if(r->f[F_ASSIGNEES]){
+        import_names(r->f[F_ASSIGNEES]);
+        if(!*r->f[F_ASSIGNEES]) r->f[F_ASSIGNEES] = NULL;
+    }
+    r->home = user_shard(r->f[F_USER]);
+    r->priority = r->f[F_PRIORITY] ? atoi(r->f[F_PRIORITY]) : 0;
+    if(r->f[F_TITLE]) return IMP_TASK;
+    return *r->f[F_USER] ? IMP_USER : IMP_SKIP;
+}
+
+THREAD_FN(import_parse_main){
+    ImportJob *j = (ImportJob*)arg;
+    ImportChunk *c = &j->im->chunks[j->index];
+    char *p = c->text, *end = c->text + c->len;
+    c->n = 0;
+    while(p < end){
+        char *nl = (char*)memchr(p, '\n', end - p);
+        char *stop = nl ? nl : end;
+        *stop = 0;
+        if(stop > p && stop[-1] == '\r') stop[-1] = 0;
+        if(*skip_ws(p)){
+            if(c->n == c->cap){
+                int nc = c->cap ? c->cap * 2 : 4096;
+                ImportRec *g = (ImportRec*)realloc(c->recs, nc * sizeof(ImportRec));
+                if(!g) break;
+                c->recs = g;
+                c->cap = nc;
+            }
+            ImportRec *r = &c->recs[c->n++];
+            r->kind = import_parse(j->im, p, r);
+        }
+        p = stop + 1;
+    }
+    THREAD_RETURN;
+}
+
+// next name of a '\n'-separated list; returns where the one after starts, NULL at the end
+static const char* next_name(const char *p, char *name){
+    if(!p || !*p) return NULL;
+    size_t n = strcspn(p, "\n");
+    size_t k = n < MAX_USERNAME - 1 ? n : MAX_USERNAME - 1;
+    memcpy(name, p, k);
+    name[k] = 0;
+    return p[n] ? p + n + 1 : p + n;
+}
+
+// create the users and task nodes homed in this job's shards, in file order
+THREAD_FN(import_create_main){
+    ImportJob *j = (ImportJob*)arg;
+    Import *im = j->im;
+    char name[MAX_USERNAME];
+    opNow = im->now;
+    for(int c=0;c<im->workers;c++){
+        ImportChunk *ch = &im->chunks[c];
+        for(int i=0;i<ch->n;i++){
+            ImportRec *r = &ch->recs[i];
+            if(r->kind == IMP_SKIP) continue;
+            if(r->home % im->workers == j->index){
+                Shard *s = &shards[r->home];
+                if(*r->f[F_USER] && !findUser(r->f[F_USER])){
+                    User *u = createOrGetUser(r->f[F_USER]);
+                    r->created = u != NULL;
+                    if(u && r->kind == IMP_USER && r->f[F_PASSWORD] && strlen(r->f[F_PASSWORD]) > 0)
+                        password_hash(u->username, r->f[F_PASSWORD], u->password);
+                }
+                if(r->kind == IMP_TASK){
+                    ImportNodes *in = &im->created[r->home];
+                    if(in->n == in->cap){
+                        int nc = in->cap ? in->cap * 2 : 4096;
+                        TaskNode **g = (TaskNode**)realloc(in->nodes, nc * sizeof(TaskNode*));
+                        if(g){ in->nodes = g; in->cap = nc; }
+                    }
+                    r->node = in->n < in->cap ? createTaskNode(s, r->f[F_TITLE], r->priority, r->f[F_DUE], r->f[F_STATUS], CREATED_LATER) : NULL;
+                    if(r->node) in->nodes[in->n++] = r->node;
+                }
+            }
+            if(r->kind == IMP_TASK)
+                for(const char *a = next_name(r->f[F_ASSIGNEES], name); a; a = next_name(a, name))
+                    if(user_shard(name) % im->workers == j->index) createOrGetUser(name);
+        }
+    }
+    opNow = 0;
+    THREAD_RETURN;
+}
+
+// link holders and log every record of the piece, in file order
+static void import_link(Import *im){
+    char name[MAX_USERNAME];
+    for(int c=0;c<im->workers;c++){
+        ImportChunk *ch = &im->chunks[c];
+        for(int i=0;i<ch->n;i++){
+            ImportRec *r = &ch->recs[i];
+            opNow = im->now;
+            if(r->kind == IMP_USER){
+                if(r->created) replog_append(REC_LOGIN, r->f[F_USER], findUser(r->f[F_USER])->password);
+                continue;
+            }
+            if(r->kind == IMP_SKIP || !r->node){
+                im->skipped++;
+                continue;
+            }
+            // the workers created the nodes unnumbered, shard by shard: number them in file order
+            r->node->created = take_created(0);
+            user_add_taskdll(findUser(r->f[F_USER]), r->node);
+            for(const char *a = next_name(r->f[F_ASSIGNEES], name); a; a = next_name(a, name))
+                user_add_taskdll(findUser(name), r->node);
+            replog_append(REC_IMPORT, r->f[F_USER], r->f[F_TITLE], r->priority, r->f[F_DUE], r->f[F_STATUS], r->f[F_ASSIGNEES],
+                          (long long)r->node->created);
+            im->tasks++;
+        }
+    }
+    opNow = 0;
+}
+
+// treap over nodes sorted by id, built in O(n) along its right spine
+static TaskNode* bst_build(TaskNode **nodes, int n){
+    TaskNode **spine = (TaskNode**)malloc((n ? n : 1) * sizeof(TaskNode*));
+    TaskNode *root = NULL;
+    int top = 0;
+    if(!spine){
+        for(int i=0;i<n;i++) root = bst_insert(root, nodes[i]);
+        return root;
+    }
+    for(int i=0;i<n;i++){
+        TaskNode *t = nodes[i], *last = NULL;
+        t->left = t->right = NULL;
+        while(top && spine[top-1]->heapKey < t->heapKey) last = spine[--top];
+        t->left = last;
+        if(top) spine[top-1]->right = t;
+        spine[top++] = t;
+    }
+    root = top ? spine[0] : NULL;
+    free(spine);
+    return root;
+}
+
+// after the last piece: join the new nodes to the shard treaps, index them and heapify the deadlines
+THREAD_FN(import_finish_main){
+    ImportJob *j = (ImportJob*)arg;
+    Import *im = j->im;
+    for(int k=j->index;k<ENGINE_SHARDS;k+=im->workers){
+        Shard *s = &shards[k];
+        ImportNodes *in = &im->created[k];
+        if(!in->n) continue;
+        // every new id is above the shard's existing ones
+        s->taskRoot = bst_merge(s->taskRoot, bst_build(in->nodes, in->n));
+        int scheduled = 0;
+        for(int i=0;i<in->n;i++){
+            TaskNode *t = in->nodes[i];
+            index_task(t);
+            if(!t->dueAt || strcmp(t->status, CLOSED_STATUS)==0) continue;
+            if(s->schedCount == s->schedCap){
+                int nc = s->schedCap ? s->schedCap * 2 : 64;
+                TaskNode **g = (TaskNode**)realloc(s->schedHeap, nc * sizeof(TaskNode*));
+                if(!g) continue;
+                s->schedHeap = g;
+                s->schedCap = nc;
+            }
+            sched_set(s, s->schedCount++, t);
+            scheduled = 1;
+        }
+        if(scheduled){
+            for(int i = s->schedCount/2 - 1; i >= 0; i--) sched_sift_down(s, i);
+            cond_signal(&s->schedWake);
+        }
+    }
+    THREAD_RETURN;
+}
+
+// cut a piece into one chunk per worker at line boundaries, then run the per-piece phases
+static void import_piece(Import *im, char *text, size_t len){
+    ImportJob jobs[IMPORT_THREADS];
+    size_t pos = 0;
+    for(int i=0;i<im->workers;i++){
+        size_t stop = i == im->workers - 1 ? len : len / im->workers * (i + 1);
+        if(stop < pos) stop = pos;
+        while(stop < len && stop > 0 && text[stop-1] != '\n') stop++;
+        im->chunks[i].text = text + pos;
+        im->chunks[i].len = stop - pos;
+        pos = stop;
+        jobs[i].im = im;
+        jobs[i].index = i;
+    }
+    run_parallel(import_parse_main, jobs, im->workers);
+    run_parallel(import_create_main, jobs, im->workers);
+    import_link(im);
+}
+
+// the CSV header: map each column to a field
+static int import_header(Import *im, char *line){
+    char *raw[IMPORT_MAX_COLS];
+    size_t n = strlen(line);
+    if(n && line[n-1] == '\r') line[n-1] = 0;
+    int nc = csv_fields(line, raw, IMPORT_MAX_COLS);
+    if(nc <= 0) return 0;
+    im->ncols = nc < IMPORT_MAX_COLS ? nc : IMPORT_MAX_COLS;
+    int known = 0;
+    for(int c=0;c<im->ncols;c++){
+        im->cols[c] = import_field(skip_ws(raw[c]));
+        known |= im->cols[c] == F_USER || im->cols[c] == F_TITLE;
+    }
+    return known;
+}
+
+// apply one imported task outside a bulk run (a follower replaying REC_IMPORT); creates and
+// links the same users, in the same order, as the bulk path did on the primary
+static void import_apply(const char *user, const char *title, int priority, const char *due, const char *status, const char *assignees, unsigned long long created){
+    char name[MAX_USERNAME];
+    if(!user) user = "";
+    Shard *s = &shards[user_shard(user)];
+    uint64_t mask = SHARD_BIT(s - shards);
+    for(const char *a = next_name(assignees, name); a; a = next_name(a, name)) mask |= SHARD_BIT(user_shard(name));
+    lock_shards(mask);
+    User *u = *user ? createOrGetUser(user) : NULL;
+    TaskNode *n = createTaskNode(s, title, priority, due, status, created);
+    if(n){
+        s->taskRoot = bst_insert(s->taskRoot, n);
+        index_task(n);
+        sched_track(n);
+        user_add_taskdll(u, n);
+        for(const char *a = next_name(assignees, name); a; a = next_name(a, name))
+            user_add_taskdll(createOrGetUser(name), n);
+    }
+    replog_append(REC_IMPORT, user, title, priority, due, status, assignees, (long long)(n ? n->created : created));
+    unlock_shards(mask);
+}
+
+// import_tasks_api: load users, tasks and assignments from a file. format is "ndjson" or
+// "csv" (NULL/"" picks by the file extension). Returns {"tasks","users","skipped"} counts,
+// or {"error":...}. Blocks every other call until it is done.
+EXPORT const char* STDCALL import_tasks_api(const char* path, const char* format) {
+    static THREAD_LOCAL char buf[256];
+    METERED(API_IMPORT);
+    engine_init();
+    int csv;
+    if(format && *format) csv = strcmp(format, "csv")==0;
+    else csv = path && strlen(path) > 4 && strcmp(path + strlen(path) - 4, ".csv")==0;
+    if(format && *format && !csv && strcmp(format, "ndjson")!=0) return "{\"error\":\"unknown format\"}";
+    if(read_only()) return "{\"error\":\"read-only replica\"}";
+    FILE *f = path ? fopen(path, "rb") : NULL;
+    if(!f) return "{\"error\":\"cannot open file\"}";
+    trace_untraced("import_tasks_api");
+    Import *im = (Import*)calloc(1, sizeof(Import));
+    size_t cap = IMPORT_BLOCK, have = 0;
+    char *text = (char*)malloc(cap + 1);
+    if(!im || !text){
+        free(im);
+        free(text);
+        fclose(f);
+        return "{\"error\":\"out of memory\"}";
+    }
+    const char *err = NULL;
+    im->csv = csv;
+    im->workers = IMPORT_THREADS < ENGINE_SHARDS ? IMPORT_THREADS : ENGINE_SHARDS;
+    if(im->workers < 1) im->workers = 1;
+    lock_shards(ALL_SHARDS);
+    int users = 0;
+    for(int i=0;i<ENGINE_SHARDS;i++) users -= shards[i].userCount;
+    im->now = engine_now();
+    opNow = 0;
+    int header = csv;
+    for(;;){
+        size_t got = fread(text + have, 1, cap - have, f);
+        have += got;
+        int last = have < cap;           // a short read: end of file
+        size_t use = have, start = 0;
+        if(!last){
+            // stop after the final newline; a line longer than the whole piece grows it
+            while(use && text[use-1] != '\n') use--;
+            if(!use){
+                char *g = (char*)realloc(text, cap * 2 + 1);
+                if(!g){ err = "line too long"; break; }
+                text = g;
+                cap *= 2;
+                continue;
+            }
+        }
+        text[have] = 0;
+        if(header){
+            size_t n = strcspn(text, "\n");
+            text[n] = 0;
+            if(!import_header(im, text)){ err = "CSV header names no user or title column"; break; }
+            header = 0;
+            start = n < use ? n + 1 : use;
+        }
+        if(use > start) import_piece(im, text + start, use - start);
+        memmove(text, text + use, have - use);
+        have -= use;
+        if(last) break;
+    }
+    if(ferror(f) && !err) err = "read error";
+    ImportJob jobs[IMPORT_THREADS];
+    for(int i=0;i<im->workers;i++){ jobs[i].im = im; jobs[i].index = i; }
+    run_parallel(import_finish_main, jobs, im->workers);
+    for(int i=0;i<ENGINE_SHARDS;i++) users += shards[i].userCount;
+    unlock_shards(ALL_SHARDS);
+    fclose(f);
+    if(err) snprintf(buf, sizeof(buf), "{\"error\":\"%s\",\"tasks\":%d,\"users\":%d,\"skipped\":%d}", err, im->tasks, users, im->skipped);
+    else snprintf(buf, sizeof(buf), "{\"tasks\":%d,\"users\":%d,\"skipped\":%d}", im->tasks, users, im->skipped);
+    for(int i=0;i<IMPORT_THREADS;i++) free(im->chunks[i].recs);
+    for(int i=0;i<ENGINE_SHARDS;i++) free(im->created[i].nodes);
+    free(im);
+    free(text);
+    return buf;
+}
+
+// Export is pulled a buffer at a time through an opaque cursor, so the caller sets the
+// pace: nothing is produced until it asks for more, and each call holds one shard lock
+// at a time. Users come first (creation order, shard by shard), then tasks (id order
+// within each shard). A task's "user" is its earliest holder, "assignees" the rest.
+#define EXPORT_CSV_HEADER "id,user,title,priority,due,status,assignees,time\n"
+#define EXPORT_CURSOR(stage, shard, pos) (((long long)(stage) << 40) | ((long long)(shard) << 32) | (long long)(unsigned)(pos))
+
+typedef struct {
+    char *buf;
+    int len, cap;
+    int full;
+    size_t want;                 // bytes the current line needs, counted even once it no longer fits
+} ExportOut;
+
+static void ex_put(ExportOut *o, const char *s, size_t n){
+    o->want += n;
+    if(o->full || o->len + n > (size_t)o->cap){ o->full = 1; return; }
+    memcpy(o->buf + o->len, s, n);
+    o->len += (int)n;
+}
+
+// s escaped for a JSON string or a quoted CSV field, without the quotes
+static void ex_escaped(ExportOut *o, const char *s, int csv){
+    char esc[8];
+    const char *run = s;
+    for(; *s; s++){
+        unsigned char ch = (unsigned char)*s;
+        const char *rep = NULL;
+        if(csv){
+            if(ch == '"') rep = "\"\"";
+            else if(ch == '\n' || ch == '\r') rep = " ";
+        } else if(ch == '"' || ch == '\\'){
+            esc[0] = '\\'; esc[1] = (char)ch; esc[2] = 0;
+            rep = esc;
+        } else if(ch < 0x20){
+            snprintf(esc, sizeof(esc), "\\u%04x", ch);
+            rep = esc;
+        }
+        if(!rep) continue;
+        ex_put(o, run, s - run);
+        ex_put(o, rep, strlen(rep));
+        run = s + 1;
+    }
+    ex_put(o, run, s - run);
+}
+
+static void ex_str(ExportOut *o, const char *s, int csv){
+    ex_put(o, "\"", 1);
+    ex_escaped(o, s, csv);
+    ex_put(o, "\"", 1);
+}
+
+static void ex_int(ExportOut *o, int v){
+    char tmp[16];
+    ex_put(o, tmp, snprintf(tmp, sizeof(tmp), "%d", v));
+}
+
+// a line is written whole or not at all: 0 when it did not fit (o->want then holds its size)
+static int ex_line_end(ExportOut *o, int start){
+    if(!o->full) return 1;
+    o->len = start;
+    return 0;
+}
+
+static int export_user(ExportOut *o, const User *u, int csv){
+    int start = o->len;
+    o->want = 0;
+    if(csv){
+        ex_put(o, ",", 1);
+        ex_str(o, u->username, 1);
+        ex_put(o, ",,,,,,\n", 7);
+    } else {
+        ex_put(o, "{\"user\":", 8);
+        ex_str(o, u->username, 0);
+        ex_put(o, "}\n", 2);
+    }
+    return ex_line_end(o, start);
+}
+
+static int export_task(ExportOut *o, const TaskNode *t, int csv){
+    int start = o->len;
+    const TaskDLL *oldest = t->assignees;
+    while(oldest && oldest->tnext) oldest = oldest->tnext;
+    o->want = 0;
+    if(!csv) ex_put(o, "{\"id\":", 6);
+    ex_int(o, t->id);
+    ex_put(o, csv ? "," : ",\"user\":", csv ? 1 : 8);
+    ex_str(o, oldest ? oldest->owner->username : "", csv);
+    ex_put(o, csv ? "," : ",\"title\":", csv ? 1 : 9);
+    ex_str(o, t->title, csv);
+    ex_put(o, csv ? "," : ",\"priority\":", csv ? 1 : 12);
+    ex_int(o, t->priority);
+    ex_put(o, csv ? "," : ",\"due\":", csv ? 1 : 7);
+    ex_str(o, t->dueDate, csv);
+    ex_put(o, csv ? "," : ",\"status\":", csv ? 1 : 10);
+    ex_str(o, t->status, csv);
+    if(csv){
+        // one quoted field of ';'-separated names
+        ex_put(o, ",\"", 2);
+        for(const TaskDLL *it = oldest ? oldest->tprev : NULL; it; it = it->tprev){
+            if(it != oldest->tprev) ex_put(o, ";", 1);
+            ex_escaped(o, it->owner->username, 1);
+        }
+        ex_put(o, "\",", 2);
+    } else {
+        ex_put(o, ",\"assignees\":[", 14);
+        for(const TaskDLL *it = oldest ? oldest->tprev : NULL; it; it = it->tprev){
+            if(it != oldest->tprev) ex_put(o, ",", 1);
+            ex_str(o, it->owner->username, 0);
+        }
+        ex_put(o, "],\"time\":", 9);
+    }
+    ex_str(o, t->timestamp, csv);
+    ex_put(o, csv ? "\n" : "}\n", csv ? 1 : 2);
+    return ex_line_end(o, start);
+}
+
+typedef struct {
+    ExportOut *o;
+    int csv;
+    int after, last;
+} ExportWalk;
+
+// in-order from the first id above after; 0 once the buffer is full
+static int export_walk(const TaskNode *n, ExportWalk *w){
+    if(!n) return 1;
+    if(n->id > w->after){
+        if(!export_walk(n->left, w)) return 0;
+        if(!export_task(w->o, n, w->csv)) return 0;
+        w->last = n->id;
+    }
+    return export_walk(n->right, w);
+}
+
+// export_tasks_api: fill buf with whole lines of the export, starting at *cursor (0 for
+// the beginning) and advancing it; *cursor is -1 after the last line. Returns the bytes
+// written, or minus the size the next line needs when it alone does not fit in cap.
+EXPORT int STDCALL export_tasks_api(const char* format, long long* cursor, char* buf, int cap) {
+    METERED(API_EXPORT);
+    engine_init();
+    if(!cursor || *cursor < 0 || !buf || cap <= 0) return 0;
+    int csv = format && strcmp(format, "csv")==0;
+    ExportOut o = { buf, 0, cap, 0, 0 };
+    long long c = *cursor;
+    if(c == 0){
+        if(csv){
+            ex_put(&o, EXPORT_CSV_HEADER, strlen(EXPORT_CSV_HEADER));
+            if(o.full) return -(int)o.want;
+        }
+        c = EXPORT_CURSOR(1, 0, 0);
+    }
+    int stage = (int)(c >> 40), si = (int)((c >> 32) & 0xFF), pos = (int)(unsigned)(c & 0xFFFFFFFF);
+    while(stage <= 2 && si < ENGINE_SHARDS){
+        Shard *s = &shards[si];
+        int done;
+        mutex_lock(&s->lock);
+        if(stage == 1){
+            while(pos < s->userCount && export_user(&o, s->users[pos], csv)) pos++;
+            done = pos >= s->userCount;
+        } else {
+            ExportWalk w = { &o, csv, pos, pos };
+            done = export_walk(s->taskRoot, &w);
+            pos = w.last;
+        }
+        mutex_unlock(&s->lock);
+        if(!done) break;
+        pos = 0;
+        if(++si == ENGINE_SHARDS){ si = 0; stage++; }
+    }
+    *cursor = stage > 2 ? -1 : EXPORT_CURSOR(stage, si, pos);
+    if(o.len == 0 && o.full) return -(int)o.want;
+    return o.len;
+}
+
+// ---------- Replication ----------
+// The engine keeps the log; moving it between processes is up to the host
+// (server.py streams it over a socket). A primary serves replog_read_api to
+// its followers, each follower feeds what it receives to replog_apply_api.
+static EngineMutex applyLock = ENGINE_MUTEX_INIT;
+
+// replog_lsn_api: lsn of the newest record
+EXPORT long long STDCALL replog_lsn_api(void) {
+    engine_init();
+    mutex_lock(&replog.lock);
+    long long lsn = replog.lsn;
+    mutex_unlock(&replog.lock);
+    return lsn;
+}
+
+// replog_wait_api: block until the log is past from_lsn or timeout_ms passes; returns the newest lsn
+EXPORT long long STDCALL replog_wait_api(long long from_lsn, int timeout_ms) {
+    engine_init();
+    mutex_lock(&replog.lock);
+    if(replog.lsn <= from_lsn) cond_wait_ms(&replog.grew, &replog.lock, timeout_ms);
+    long long lsn = replog.lsn;
+    mutex_unlock(&replog.lock);
+    return lsn;
+}
+
+// replog_read_api: copy the whole records after from_lsn that fit into buf; returns the
+// bytes copied, minus the size of the next record when it alone does not fit, or -1
+// when the records after from_lsn are no longer held (the follower must start over
+// from a snapshot)
+EXPORT int STDCALL replog_read_api(long long from_lsn, char *buf, int cap) {
+    METERED(API_REPLOG_READ);
+    engine_init();
+    int n = 0;
+    mutex_lock(&replog.lock);
+    if(from_lsn < 0) from_lsn = 0;
+    if(from_lsn < replog.lsn && (from_lsn + 1 < replog.first || atomic_load(&replMode) != REPL_KEEP)) n = -1;
+    else if(from_lsn < replog.lsn && buf && cap > 0){
+        size_t start = replog.offs[from_lsn + 1 - replog.first];
+        size_t end = start;
+        for(long long l = from_lsn + 1; l <= replog.lsn; l++){
+            size_t next = l < replog.lsn ? replog.offs[l + 1 - replog.first] : replog.len;
+            if(next - start > (size_t)cap){
+                if(end == start) n = -(int)(next - start);
+                break;
+            }
+            end = next;
+        }
+        if(end > start){
+            memcpy(buf, replog.buf + start, end - start);
+            n = (int)(end - start);
+        }
+    }
+    mutex_unlock(&replog.lock);
+    return n;
+}
+
+// replication_enable_api: start keeping the log for followers, with at least the newest
+// keep_bytes of it held so a follower that reconnects soon can carry on. 0 on a follower
+EXPORT int STDCALL replication_enable_api(long long keep_bytes) {
+    engine_init();
+    mutex_lock(&applyLock);
+    int ok = !replicaRole;
+    if(ok){
+        mutex_lock(&replog.lock);
+        replog.keepBytes = keep_bytes > 0 ? keep_bytes : 0;
+        if(atomic_load(&replMode) != REPL_KEEP) replog.first = replog.lsn + 1;
+        atomic_store(&replMode, REPL_KEEP);
+        mutex_unlock(&replog.lock);
+    }
+    mutex_unlock(&applyLock);
+    return ok;
+}
+
+// replog_retain_api: the oldest lsn a connected follower has, -1 if none is connected;
+// records up to it may be dropped beyond the newest keep_bytes
+EXPORT void STDCALL replog_retain_api(long long from_lsn) {
+    engine_init();
+    mutex_lock(&replog.lock);
+    replog.retainFrom = from_lsn < 0 ? LLONG_MAX : from_lsn;
+    replog_trim();
+    mutex_unlock(&replog.lock);
+}
+
+// ----- Snapshots -----
+// A snapshot is a run of records, all stamped with the lsn it was taken at, that
+// rebuilds the engine from empty with the same ids, creation numbers, task lists,
+// undo stacks, teams, dependencies and notifications. It is taken under every shard
+// lock; the records after its lsn then bring a follower up to date.
+typedef struct {
+    unsigned char *buf;
+    size_t len, cap;
+    int failed;
+    long long lsn;
+    time_t when;
+} SnapOut;
+
+typedef struct {
+    char text[REC_LIST_MAX + 2 * MAX_USERNAME];
+    int len, items;
+} SnapList;
+
+static void snap_put(SnapOut *o, int op, ...){
+    va_list ap;
+    va_start(ap, op);
+    size_t size = rec_size(recArgs[op], ap);
+    va_end(ap);
+    if(o->failed) return;
+    if(o->len + size > o->cap){
+        size_t nc = o->cap ? o->cap * 2 : 1 << 20;
+        while(nc < o->len + size) nc *= 2;
+        unsigned char *g = (unsigned char*)realloc(o->buf, nc);
+        if(!g){ o->failed = 1; return; }
+        o->buf = g;
+        o->cap = nc;
+    }
+    va_start(ap, op);
+    rec_write(o->buf + o->len, size, o->lsn, o->when, op, ap);
+    va_end(ap);
+    o->len += size;
+}
+
+// add item to a separated list; 1 once the list is long enough to go out as a record
+static int list_add(SnapList *l, const char *item, char sep){
+    int n = (int)strlen(item);
+    if(l->len) l->text[l->len++] = sep;
+    memcpy(l->text + l->len, item, n);
+    l->len += n;
+    l->text[l->len] = 0;
+    l->items++;
+    return l->len >= REC_LIST_MAX;
+}
+
+static void list_add_id(SnapList *l, int id){
+    char tmp[16];
+    snprintf(tmp, sizeof(tmp), "%d", id);
+    list_add(l, tmp, ',');
+}
+
+static void list_clear(SnapList *l){
+    l->len = l->items = 0;
+    l->text[0] = 0;
+}
+
+static void snap_tasks(SnapOut *o, TaskNode *t){
+    if(!t) return;
+    snap_tasks(o, t->left);
+    snap_put(o, REC_SNAP_TASK, t->id, (long long)t->created, t->title, t->priority, t->dueDate,
+             t->status, t->timestamp, t->dueState);
+    snap_tasks(o, t->right);
+}
+
+// each task's holders, newest first as task_assignees_api lists them
+static void snap_holders(SnapOut *o, SnapList *l, TaskNode *t){
+    if(!t) return;
+    snap_holders(o, l, t->left);
+    if(t->assigneeCount > 1){
+        int pos = 0;
+        list_clear(l);
+        for(TaskDLL *it = t->assignees; it; it = it->tnext){
+            if(list_add(l, it->owner->username, '\n') || !it->tnext){
+                snap_put(o, REC_SNAP_HOLDERS, t->id, pos, l->text);
+                pos += l->items;
+                list_clear(l);
+            }
+        }
+    }
+    snap_holders(o, l, t->right);
+}
+
+static int compareMemberSeq(const void *a, const void *b){
+    unsigned x = (*(TeamMember* const*)a)->seq, y = (*(TeamMember* const*)b)->seq;
+    return (x > y) - (x < y);
+}
+
+// caller holds every shard lock
+static void snapshot_encode(SnapOut *o, SnapList *l){
+    snap_put(o, REC_HELLO, ENGINE_SHARDS);
+    for(int si=0;si<ENGINE_SHARDS;si++){
+        Shard *s = &shards[si];
+        for(int i=0;i<s->userCount;i++){
+            User *u = s->users[i];
+            SnapList redo;
+            list_clear(l);
+            list_clear(&redo);
+            for(int k=0;k<u->undoTop;k++) list_add_id(l, u->undoStack[k]);
+            for(int k=0;k<u->redoTop;k++) list_add_id(&redo, u->redoStack[k]);
+            snap_put(o, REC_SNAP_USER, u->username, u->password, l->text, redo.text);
+        }
+    }
+    for(int si=0;si<ENGINE_SHARDS;si++){
+        snap_tasks(o, shards[si].taskRoot);
+        snap_put(o, REC_SNAP_SHARD, si, shards[si].nextSeq);
+    }
+    for(int si=0;si<ENGINE_SHARDS;si++){
+        Shard *s = &shards[si];
+        for(int i=0;i<s->userCount;i++){
+            User *u = s->users[i];
+            list_clear(l);
+            for(TaskDLL *it = u->head; it; it = it->next){
+                list_add_id(l, it->task->id);
+                if(l->len >= REC_LIST_MAX || !it->next){
+                    snap_put(o, REC_SNAP_HOLD, u->username, l->text);
+                    list_clear(l);
+                }
+            }
+        }
+    }
+    for(int si=0;si<ENGINE_SHARDS;si++) snap_holders(o, l, shards[si].taskRoot);
+
+    mutex_lock(&teamsLock);
+    int nteams = teamCount;
+    Team **all = (Team**)malloc((nteams ? nteams : 1) * sizeof(Team*));
+    if(all) memcpy(all, teams, nteams * sizeof(Team*));
+    mutex_unlock(&teamsLock);
+    if(!all) o->failed = 1;
+    for(int i=0;all && i<nteams;i++){
+        Team *tm = all[i];
+        mutex_lock(&tm->lock);
+        TeamMember **ms = (TeamMember**)malloc((tm->count ? tm->count : 1) * sizeof(TeamMember*));
+        if(ms){
+            memcpy(ms, tm->heap, tm->count * sizeof(TeamMember*));
+            qsort(ms, tm->count, sizeof(TeamMember*), compareMemberSeq);
+            for(int k=0;k<tm->count;k++) snap_put(o, REC_TEAM, tm->name, ms[k]->u->username, 1);
+            free(ms);
+        } else o->failed = 1;
+        mutex_unlock(&tm->lock);
+    }
+    free(all);
+
+    mutex_lock(&depLock);
+    for(int i=0;i<depOrderLen;i++) if(depOrder[i]) snap_put(o, REC_SNAP_DEP, depOrder[i]->id, 0, "");
+    for(int i=0;i<depOrderLen;i++){
+        DepNode *n = depOrder[i];
+        for(int kind=1; n && kind<=2; kind++){
+            DepNode **arr = kind == 1 ? n->blockers : n->blocks;
+            int cnt = kind == 1 ? n->nBlockers : n->nBlocks;
+            list_clear(l);
+            for(int k=0;k<cnt;k++){
+                list_add_id(l, arr[k]->id);
+                if(l->len >= REC_LIST_MAX || k == cnt - 1){
+                    snap_put(o, REC_SNAP_DEP, n->id, kind, l->text);
+                    list_clear(l);
+                }
+            }
+        }
+    }
+    mutex_unlock(&depLock);
+
+    for(int si=0;si<ENGINE_SHARDS;si++){
+        NotifRing *q = &shards[si].notif;
+        mutex_lock(&q->lock);
+        for(int k=0;k<q->count;k++){
+            int at = (q->front + k) % MAX_NOTIF;
+            snap_put(o, REC_SNAP_NOTIF, si, (long long)q->seq[at], q->to[at], q->msg[at]);
+        }
+        mutex_unlock(&q->lock);
+    }
+    snap_put(o, REC_SNAP_END, (long long)atomic_load(&tasksCreated), (long long)atomic_load(&notifSeq));
+}
+
+// replog_snapshot_api: write a snapshot of the engine to path for a new follower;
+// returns the lsn it was taken at, or -1. Records after that lsn stay held until
+// replog_retain_api says otherwise. Writes wait while the state is encoded (the
+// file is written after the locks are released).
+EXPORT long long STDCALL replog_snapshot_api(const char *path) {
+    engine_init();
+    if(!path || atomic_load(&replMode) != REPL_KEEP) return -1;
+    SnapOut o;
+    SnapList *l = (SnapList*)malloc(sizeof(SnapList));
+    if(!l) return -1;
+    memset(&o, 0, sizeof(o));
+    lock_shards(ALL_SHARDS);
+    mutex_lock(&replog.lock);
+    o.lsn = replog.lsn;
+    o.when = replog.lastTime ? replog.lastTime : time(NULL);
+    if(replog.retainFrom > o.lsn) replog.retainFrom = o.lsn;
+    mutex_unlock(&replog.lock);
+    snapshot_encode(&o, l);
+    unlock_shards(ALL_SHARDS);
+    free(l);
+    FILE *f = o.failed ? NULL : fopen(path, "wb");
+    long long lsn = f && fwrite(o.buf, 1, o.len, f) == o.len ? o.lsn : -1;
+    if(f && fclose(f) != 0) lsn = -1;
+    free(o.buf);
+    return lsn;
+}
+
+static int snapRestoring = 0;            // under applyLock: between a snapshot's REC_HELLO and REC_SNAP_END
+static long long snapLsn = 0;
+
+// no users or tasks yet: the only state a snapshot may be applied to
+static int engine_empty(void){
+    int empty = atomic_load(&tasksCreated) == 0;
+    lock_shards(ALL_SHARDS);
+    for(int i=0;i<ENGINE_SHARDS && empty;i++) empty = shards[i].userCount == 0;
+    unlock_shards(ALL_SHARDS);
+    return empty;
+}
+
+static void parse_ids(const char *text, int *out, int *n, int max){
+    *n = 0;
+    for(const char *p = text; p && *p && *n < max; ){
+        out[(*n)++] = atoi(p);
+        p = strchr(p, ',');
+        if(p) p++;
+    }
+}
+
+// move t's holder node nd to position pos of its assignee list
+static void holder_move(TaskNode *t, TaskDLL *nd, int pos){
+    if(nd->tprev) nd->tprev->tnext = nd->tnext;
+    else t->assignees = nd->tnext;
+    if(nd->tnext) nd->tnext->tprev = nd->tprev;
+    TaskDLL *before = NULL;
+    for(TaskDLL *it = t->assignees; it && pos > 0; it = it->tnext, pos--) before = it;
+    nd->tprev = before;
+    nd->tnext = before ? before->tnext : t->assignees;
+    if(nd->tnext) nd->tnext->tprev = nd;
+    if(before) before->tnext = nd;
+    else t->assignees = nd;
+}
+
+// apply one snapshot record (caller holds applyLock); 0, or -1 if it does not fit
+static int snapshot_apply(int op, const RecArgs *a, long long lsn, time_t when){
+    static int ids[REC_LIST_MAX / 2 + 1];
+    int n = 0;
+    if(op == REC_HELLO){
+        if(snapRestoring || a->n[0] != ENGINE_SHARDS || replog_lsn_api() != 0 || !engine_empty()) return -1;
+        snapRestoring = 1;
+        snapLsn = lsn;
+        return 0;
+    }
+    if(!snapRestoring || lsn != snapLsn) return -1;
+    switch(op){
+    case REC_SNAP_USER: {
+        Shard *s = &shards[user_shard(a->s[0])];
+        mutex_lock(&s->lock);
+        User *u = createOrGetUser(a->s[0]);
+        if(u){
+            snprintf(u->password, sizeof(u->password), "%s", a->s[1] ? a->s[1] : "");
+            parse_ids(a->s[2], u->undoStack, &u->undoTop, 128);
+            parse_ids(a->s[3], u->redoStack, &u->redoTop, 128);
+        }
+        mutex_unlock(&s->lock);
+        return u ? 0 : -1;
+    }
+    case REC_SNAP_TASK: {
+        int id = (int)a->n[0];
+        Shard *s = &shards[task_shard(id)];
+        mutex_lock(&s->lock);
+        TaskNode *t = createTaskNode(s, a->s[0], (int)a->n[2], a->s[1], a->s[2], (unsigned long long)a->n[1]);
+        if(t){
+            t->id = id;
+            snprintf(t->timestamp, sizeof(t->timestamp), "%s", a->s[3] ? a->s[3] : "");
+            t->dueState = (int)a->n[3];
+            s->taskRoot = bst_insert(s->taskRoot, t);
+            index_task(t);
+            sched_track(t);
+        }
+        mutex_unlock(&s->lock);
+        return t ? 0 : -1;
+    }
+    case REC_SNAP_SHARD:
+        if(a->n[0] < 0 || a->n[0] >= ENGINE_SHARDS) return -1;
+        mutex_lock(&shards[a->n[0]].lock);
+        shards[a->n[0]].nextSeq = (int)a->n[1];
+        mutex_unlock(&shards[a->n[0]].lock);
+        return 0;
+    case REC_SNAP_HOLD: {
+        parse_ids(a->s[1], ids, &n, REC_LIST_MAX / 2 + 1);
+        lock_shards(ALL_SHARDS);
+        User *u = findUser(a->s[0]);
+        for(int i=0;u && i<n;i++) user_add_taskdll(u, task_lookup(ids[i]));
+        unlock_shards(ALL_SHARDS);
+        return u ? 0 : -1;
+    }
+    case REC_SNAP_HOLDERS: {
+        int pos = (int)a->n[1];
+        lock_shards(ALL_SHARDS);
+        TaskNode *t = task_lookup((int)a->n[0]);
+        for(const char *p = a->s[0]; t && p && *p; pos++){
+            const char *e = strchr(p, '\n');
+            char name[MAX_USERNAME];
+            snprintf(name, sizeof(name), "%.*s", e ? (int)(e - p) : (int)strlen(p), p);
+            TaskDLL *nd = task_holder_node(t, findUser(name));
+            if(nd) holder_move(t, nd, pos);
+            p = e ? e + 1 : NULL;
+        }
+        unlock_shards(ALL_SHARDS);
+        return t ? 0 : -1;
+    }
+    case REC_TEAM:
+        team_join_api(a->s[0], a->s[1]);
+        return 0;
+    case REC_SNAP_DEP: {
+        int ok = 0;
+        parse_ids(a->s[0], ids, &n, REC_LIST_MAX / 2 + 1);
+        lock_shards(ALL_SHARDS);
+        mutex_lock(&depLock);
+        TaskNode *t = task_lookup((int)a->n[0]);
+        DepNode *d = t ? (a->n[1] == 0 ? dep_node(t) : t->dep) : NULL;
+        if(d){
+            ok = 1;
+            for(int i=0;i<n && ok;i++){
+                TaskNode *x = task_lookup(ids[i]);
+                DepNode *e = x ? x->dep : NULL;
+                if(!e) ok = 0;
+                else if(a->n[1] == 1){
+                    ok = dep_push(&d->blockers, &d->nBlockers, &d->capBlockers, e);
+                    if(ok && !e->done) dep_open_add(d, 1);
+                } else ok = dep_push(&d->blocks, &d->nBlocks, &d->capBlocks, e);
+            }
+        }
+        mutex_unlock(&depLock);
+        unlock_shards(ALL_SHARDS);
+        return ok ? 0 : -1;
+    }
+    case REC_SNAP_NOTIF: {
+        if(a->n[0] < 0 || a->n[0] >= ENGINE_SHARDS) return -1;
+        NotifRing *q = &shards[a->n[0]].notif;
+        mutex_lock(&q->lock);
+        if(q->count < MAX_NOTIF){
+            q->rear = (q->rear + 1) % MAX_NOTIF;
+            snprintf(q->msg[q->rear], MAX_NOTIF_MSG, "%s", a->s[1] ? a->s[1] : "");
+            snprintf(q->to[q->rear], MAX_USERNAME, "%s", a->s[0] ? a->s[0] : "");
+            q->seq[q->rear] = (unsigned long long)a->n[1];
+            q->count++;
+        }
+        mutex_unlock(&q->lock);
+        return 0;
+    }
+    case REC_SNAP_END: {
+        unsigned long long have = atomic_load(&tasksCreated);
+        if((unsigned long long)a->n[0] > have) atomic_store(&tasksCreated, (unsigned long long)a->n[0]);
+        atomic_store(&notifSeq, (unsigned long long)a->n[1]);
+        mutex_lock(&replog.lock);
+        replog.lsn = lsn;
+        replog.first = lsn + 1;
+        replog.lastTime = when;
+        cond_signal(&replog.grew);
+        mutex_unlock(&replog.lock);
+        snapRestoring = 0;
+        return 0;
+    }
+    }
+    return -1;
+}
+
+// replog_apply_api: apply records received from the primary, in order. Records this
+// engine already has are skipped, so a reconnecting follower may be sent them again.
+// A new follower is sent a snapshot first (REC_HELLO to REC_SNAP_END), which only applies
+// to an empty engine. Returns the number applied, or -1 on a malformed record, a gap in
+// the lsns, a primary built with a different ENGINE_SHARDS, or a replay that diverged.
+EXPORT int STDCALL replog_apply_api(const char *buf, int len) {
+    static char *scratch = NULL;
+    static size_t scratchCap = 0;
+    METERED(API_REPLOG_APPLY);
+    engine_init();
+    const unsigned char *p = (const unsigned char*)buf;
+    const unsigned char *end = p + (len > 0 ? len : 0);
+    int applied = 0;
+    if(p < end) trace_untraced("replog_apply_api");
+    mutex_lock(&applyLock);
+    while(p < end){
+        size_t size = end - p >= 4 ? (size_t)get_u(p, 4) : 0;
+        if(size < REC_HEADER || size > (size_t)(end - p)){ applied = -1; break; }
+        long long lsn = (long long)get_u(p + 4, 8);
+        if(size > scratchCap){
+            char *g = (char*)realloc(scratch, size);
+            if(!g){ applied = -1; break; }
+            scratch = g;
+            scratchCap = size;
+        }
+        RecArgs a;
+        int op = rec_decode(p, size, scratch, &a);
+        if(!op){ applied = -1; break; }
+        if(op == REC_HELLO || op >= REC_SNAP_USER || snapRestoring){
+            applying = 1;
+            opNow = (time_t)(long long)get_u(p + 12, 8);
+            int r = snapshot_apply(op, &a, lsn, opNow);
+            applying = 0;
+            opNow = 0;
+            if(r < 0){ applied = -1; break; }
+            applied++;
+            p += size;
+            continue;
+        }
+        long long have = replog_lsn_api();
+        if(lsn <= have){ p += size; continue; }
+        if(lsn != have + 1){ applied = -1; break; }
+        applying = 1;
+        opNow = (time_t)(long long)get_u(p + 12, 8);
+        switch(op){
+        case REC_LOGIN: login_user(a.s[0], a.s[1]); break;
+        case REC_ADD:
+            opCreated = (unsigned long long)a.n[1];
+            add_task_api(a.s[0], a.s[1], (int)a.n[0], a.s[2], a.s[3]);
+            break;
+        case REC_EDIT: edit_task_api(a.s[0], (int)a.n[0], a.s[1], (int)a.n[1], a.s[2], a.s[3]); break;
+        case REC_REMOVE: remove_task_api(a.s[0], (int)a.n[0]); break;
+        case REC_DELETE: delete_task_api(a.s[0], (int)a.n[0]); break;
+        case REC_ASSIGN: assign_task_api(a.s[0], a.s[1], (int)a.n[0]); break;
+        case REC_UNDO: undo_api(a.s[0]); break;
+        case REC_REDO: redo_api(a.s[0]); break;
+        case REC_CLEAR_NOTIF: clear_notifications_api(a.s[0]); break;
+        case REC_DUE_FIRE: due_fire((int)a.n[0], (time_t)a.n[1], (int)a.n[2], 1); break;
+        case REC_IMPORT: import_apply(a.s[0], a.s[1], (int)a.n[0], a.s[2], a.s[3], a.s[4], (unsigned long long)a.n[1]); break;
+        case REC_TEAM:
+            if(a.n[0]) team_join_api(a.s[0], a.s[1]);
+            else team_leave_api(a.s[0], a.s[1]);
+            break;
+        case REC_DEP:
+            if(a.n[2]) add_dependency_api((int)a.n[0], (int)a.n[1]);
+            else remove_dependency_api((int)a.n[0], (int)a.n[1]);
+            break;
+        }
+        applying = 0;
+        opNow = 0;
+        opCreated = 0;
+        // a faithful replay logs exactly the record it applied
+        if(replog_lsn_api() != lsn){ applied = -1; break; }
+        applied++;
+        p += size;
+    }
+    mutex_unlock(&applyLock);
+    return applied;
+}
+
+// replication_role_api: 1 turns this engine into a read-only follower, 0 back into a
+// primary. Becoming a follower fails (0) once the engine has users or tasks of its own,
+// or keeps a log for followers itself.
+EXPORT int STDCALL replication_role_api(int follower) {
+    engine_init();
+    int ok = 1;
+    mutex_lock(&applyLock);
+    if(follower && !replicaRole && (atomic_load(&replMode) == REPL_KEEP || !engine_empty())) ok = 0;
+    else {
+        replicaRole = follower != 0;
+        atomic_store(&replMode, follower ? REPL_COUNT : atomic_load(&replMode) == REPL_COUNT ? REPL_OFF : atomic_load(&replMode));
+    }
+    mutex_unlock(&applyLock);
+    // due-date events come from the primary's log now; local threads would only spin
+    if(ok && follower) scheduler_stop_api();
+    return ok;
+}
+
+// replication_status_api: role, newest lsn, time of the newest record, oldest lsn held
+// and bytes held
+EXPORT const char* STDCALL replication_status_api(void) {
+    static THREAD_LOCAL char buf[256];
+    engine_init();
+    mutex_lock(&replog.lock);
+    snprintf(buf, sizeof(buf), "{\"role\":\"%s\",\"lsn\":%lld,\"time\":%lld,\"first\":%lld,\"bytes\":%lld}",
+             replicaRole ? "follower" : "primary", replog.lsn, (long long)replog.lastTime, replog.first, (long long)replog.len);
+    mutex_unlock(&replog.lock);
+    return buf;
+}
+
+// ---------- Metrics export ----------
+// metrics_api: Prometheus text exposition of the call counters and latency
+// histograms, the event counters and the bytes held per structure. Byte counts
+// are what the engine allocated for each structure (node and array sizes), not
+// allocator overhead; notification rings are fixed arrays inside the shards.
+typedef struct {
+    size_t tasks, dllNodes, viewNodes, users, indexes, sched;
+    long long liveTasks, pooledTasks, userCount, dllCount, viewCount, notifQueued;
+} ShardMemory;
+
+static size_t rb_bytes(const Roaring *r){
+    size_t n = (size_t)r->cap * sizeof(RBContainer);
+    for(int i=0;i<r->n;i++){
+        if(r->c[i].bits) n += RB_WORDS * sizeof(uint64_t);
+        if(r->c[i].array) n += (size_t)r->c[i].cap * sizeof(uint16_t);
+    }
+    return n;
+}
+
+static void memory_job(Shard *s, void *ctx){
+    ShardMemory *m = &((ShardMemory*)ctx)[s - shards];
+    memset(m, 0, sizeof(*m));
+    mutex_lock(&s->lock);
+    m->liveTasks = s->liveTaskCount;
+    m->pooledTasks = s->freeTaskCount;
+    m->tasks = (size_t)(s->liveTaskCount + s->freeTaskCount) * sizeof(TaskNode);
+    m->userCount = s->userCount;
+    m->users = (size_t)s->userCount * sizeof(User) + (size_t)s->userCap * sizeof(User*) + (size_t)s->userIndexCap * sizeof(int);
+    m->indexes = rb_bytes(&s->allTasks) + rb_bytes(&s->assignedTasks)
+               + (size_t)(s->statusClassCount + s->priorityClassCount) * sizeof(TaskClass);
+    for(int i=0;i<s->statusClassCount;i++) m->indexes += rb_bytes(&s->statusClasses[i].set);
+    for(int i=0;i<s->priorityClassCount;i++) m->indexes += rb_bytes(&s->priorityClasses[i].set);
+    for(int i=0;i<s->userCount;i++){
+        // a user has one list node per held task, and one view node per held task in each active view
+        const User *u = s->users[i];
+        long long held = 0;
+        int views = 0;
+        for(int j=0;j<ENGINE_SHARDS;j++) held += u->heldPerShard[j];
+        for(int c=0;c<SORT_COUNT;c++) views += u->viewActive[c];
+        m->dllCount += held;
+        m->viewCount += held * views;
+        m->indexes += rb_bytes(&u->assigned);
+    }
+    m->dllNodes = (size_t)m->dllCount * sizeof(TaskDLL);
+    m->viewNodes = (size_t)m->viewCount * sizeof(ViewNode);
+    m->sched = (size_t)s->schedCap * sizeof(TaskNode*);
+    mutex_unlock(&s->lock);
+    mutex_lock(&s->notif.lock);
+    m->notifQueued = s->notif.count;
+    mutex_unlock(&s->notif.lock);
+}
+
+// growable text buffer, kept per thread so the returned string outlives the call
+typedef struct {
+    char *buf;
+    size_t len, cap;
+} TextOut;
+
+static void text_printf(TextOut *o, const char *fmt, ...){
+    for(;;){
+        va_list ap;
+        va_start(ap, fmt);
+        int n = o->buf ? vsnprintf(o->buf + o->len, o->cap - o->len, fmt, ap) : -1;
+        va_end(ap);
+        if(n >= 0 && o->len + (size_t)n < o->cap){
+            o->len += (size_t)n;
+            return;
+        }
+        size_t nc = o->cap ? o->cap * 2 : 16384;
+        while(n >= 0 && nc <= o->len + (size_t)n) nc *= 2;
+        char *g = (char*)realloc(o->buf, nc);
+        if(!g) return; // keep what fits
+        o->buf = g;
+        o->cap = nc;
+    }
+}
+
+EXPORT const char* STDCALL metrics_api(void) {
+    static THREAD_LOCAL TextOut out;
+    static ShardMemory mem[ENGINE_SHARDS];
+    static EngineMutex memLock = ENGINE_MUTEX_INIT;
+    ShardMemory total;
+    engine_init();
+    out.len = 0;
+
+    text_printf(&out, "# HELP task_engine_calls_total Calls per exported engine function.\n"
+                      "# TYPE task_engine_calls_total counter\n");
+    unsigned long long calls[API_COUNT], nanos[API_COUNT], buckets[API_COUNT][LATENCY_BUCKETS + 1];
+    memset(calls, 0, sizeof(calls));
+    memset(nanos, 0, sizeof(nanos));
+    memset(buckets, 0, sizeof(buckets));
+    for(int s=0;s<METRIC_STRIPES;s++)
+        for(int a=0;a<API_COUNT;a++){
+            calls[a] += atomic_load_explicit(&metricStripes[s].calls[a], memory_order_relaxed);
+            nanos[a] += atomic_load_explicit(&metricStripes[s].nanos[a], memory_order_relaxed);
+            for(int b=0;b<=LATENCY_BUCKETS;b++)
+                buckets[a][b] += atomic_load_explicit(&metricStripes[s].buckets[a][b], memory_order_relaxed);
+        }
+    for(int a=0;a<API_COUNT;a++)
+        text_printf(&out, "task_engine_calls_total{api=\"%s\"} %llu\n", apiNames[a], calls[a]);
+
+    // stripes are summed without a snapshot, so _count is taken from the buckets to stay consistent
+    text_printf(&out, "# HELP task_engine_call_duration_seconds Latency per exported engine function.\n"
+                      "# TYPE task_engine_call_duration_seconds histogram\n");
+    for(int a=0;a<API_COUNT;a++){
+        if(!calls[a]) continue;
+        unsigned long long cum = 0;
+        for(int b=0;b<LATENCY_BUCKETS;b++){
+            cum += buckets[a][b];
+            text_printf(&out, "task_engine_call_duration_seconds_bucket{api=\"%s\",le=\"%g\"} %llu\n",
+                        apiNames[a], (double)(1LL << b) * 1e-6, cum);
+        }
+        cum += buckets[a][LATENCY_BUCKETS];
+        text_printf(&out, "task_engine_call_duration_seconds_bucket{api=\"%s\",le=\"+Inf\"} %llu\n"
+                          "task_engine_call_duration_seconds_sum{api=\"%s\"} %.9f\n"
+                          "task_engine_call_duration_seconds_count{api=\"%s\"} %llu\n",
+                    apiNames[a], cum, apiNames[a], nanos[a] * 1e-9, apiNames[a], cum);
+    }
+
+    text_printf(&out, "# HELP task_engine_notifications_dropped_total Notifications overwritten by a full ring.\n"
+                      "# TYPE task_engine_notifications_dropped_total counter\n"
+                      "task_engine_notifications_dropped_total %llu\n"
+                      "# HELP task_engine_history_overflows_total Undo/redo entries lost to a full stack.\n"
+                      "# TYPE task_engine_history_overflows_total counter\n"
+                      "task_engine_history_overflows_total{stack=\"undo\"} %llu\n"
+                      "task_engine_history_overflows_total{stack=\"redo\"} %llu\n"
+                      "# HELP task_engine_json_truncations_total JSON results cut short by their buffer.\n"
+                      "# TYPE task_engine_json_truncations_total counter\n"
+                      "task_engine_json_truncations_total %llu\n"
+                      "# HELP task_engine_trace_dropped_total Call trace records dropped while the writer fell behind.\n"
+                      "# TYPE task_engine_trace_dropped_total counter\n"
+                      "task_engine_trace_dropped_total %llu\n",
+                (unsigned long long)atomic_load(&notifDropped), (unsigned long long)atomic_load(&undoOverflows),
+                (unsigned long long)atomic_load(&redoOverflows), (unsigned long long)atomic_load(&jsonTruncations),
+                (unsigned long long)atomic_load(&traceDropped));
+
+    // mem[] is shared by concurrent scrapes, so they take turns
+    mutex_lock(&memLock);
+    shard_fanout(memory_job, mem);
+    memset(&total, 0, sizeof(total));
+    for(int i=0;i<ENGINE_SHARDS;i++){
+        total.tasks += mem[i].tasks;
+        total.dllNodes += mem[i].dllNodes;
+        total.viewNodes += mem[i].viewNodes;
+        total.users += mem[i].users;
+        total.indexes += mem[i].indexes;
+        total.sched += mem[i].sched;
+        total.liveTasks += mem[i].liveTasks;
+        total.pooledTasks += mem[i].pooledTasks;
+        total.userCount += mem[i].userCount;
+        total.dllCount += mem[i].dllCount;
+        total.viewCount += mem[i].viewCount;
+        total.notifQueued += mem[i].notifQueued;
+    }
+    mutex_unlock(&memLock);
+    mutex_lock(&replog.lock);
+    size_t replogBytes = replog.cap + (size_t)replog.offCap * sizeof(size_t);
+    long long replogRecords = atomic_load(&replMode) == REPL_KEEP ? replog.lsn - replog.first + 1 : 0;
+    mutex_unlock(&replog.lock);
+
+    text_printf(&out, "# HELP task_engine_memory_bytes Bytes allocated per engine structure.\n"
+                      "# TYPE task_engine_memory_bytes gauge\n"
+                      "task_engine_memory_bytes{structure=\"tasks\"} %zu\n"
+                      "task_engine_memory_bytes{structure=\"dll_nodes\"} %zu\n"
+                      "task_engine_memory_bytes{structure=\"view_nodes\"} %zu\n"
+                      "task_engine_memory_bytes{structure=\"users\"} %zu\n"
+                      "task_engine_memory_bytes{structure=\"indexes\"} %zu\n"
+                      "task_engine_memory_bytes{structure=\"scheduler\"} %zu\n"
+                      "task_engine_memory_bytes{structure=\"notifications\"} %zu\n"
+                      "task_engine_memory_bytes{structure=\"replog\"} %zu\n",
+                total.tasks, total.dllNodes, total.viewNodes, total.users, total.indexes, total.sched,
+                (size_t)ENGINE_SHARDS * sizeof(NotifRing), replogBytes);
+    text_printf(&out, "# HELP task_engine_objects Live objects per engine structure.\n"
+                      "# TYPE task_engine_objects gauge\n"
+                      "task_engine_objects{structure=\"tasks\"} %lld\n"
+                      "task_engine_objects{structure=\"pooled_tasks\"} %lld\n"
+                      "task_engine_objects{structure=\"dll_nodes\"} %lld\n"
+                      "task_engine_objects{structure=\"view_nodes\"} %lld\n"
+                      "task_engine_objects{structure=\"users\"} %lld\n"
+                      "task_engine_objects{structure=\"notifications\"} %lld\n"
+                      "task_engine_objects{structure=\"replog\"} %lld\n",
+                total.liveTasks, total.pooledTasks, total.dllCount, total.viewCount, total.userCount,
+                total.notifQueued, replogRecords);
+    return out.buf ? out.buf : "";
+}
+
+// ---------- Call tracing ----------
+// trace_start_api(path) records every call made through the engine interface
+// (the task_engine_ops table) to a binary trace (record_codec.h) until
+// trace_stop_api; trace_replay.c runs such a trace against any engine build.
+// A record is encoded on the calling thread and copied into the current
+// TRACE_BLOCK under a leaf lock; a writer thread writes full blocks to disk.
+// At most TRACE_BLOCKS blocks exist: if the disk falls that far behind, records
+// are dropped and counted instead of stalling callers. With capture off a call
+// costs one relaxed load on top of the engine's own work.
+// Mutating exports outside the table (import, teams, auto-assignment, dependencies,
+// clearing notifications, due-date fires, replication) are not recorded; while
+// capturing, each writes a TRACE_UNTRACED marker so replay knows where the trace
+// stops describing the engine's state.
+#define TRACE_BLOCK (1 << 20)
+#define TRACE_BLOCKS 16
+
+typedef struct TraceBlock {
+    struct TraceBlock *next;
+    size_t len;
+    unsigned char data[TRACE_BLOCK];
+} TraceBlock;
+
+static struct {
+    EngineMutex lock;            // leaf lock over everything below
+    EngineCond wake;             // a block is full, or capture is stopping
+    FILE *f;                     // NULL when not capturing
+    int stopping;
+    TraceBlock *cur;             // being filled
+    TraceBlock *full, **fullTail;
+    TraceBlock *spare;
+    int blocks;                  // allocated
+    long long epoch;             // mono_ns() when capture began
+    EngineThread writer;
+} trace = { .lock = ENGINE_MUTEX_INIT, .wake = ENGINE_COND_INIT, .fullTail = &trace.full };
+static EngineMutex traceCtl = ENGINE_MUTEX_INIT; // serializes start/stop
+static atomic_int traceOn;
+static atomic_int traceInFlight;       // traced calls running
+static atomic_ullong traceEvents;      // traced calls started or finished
+
+typedef struct {
+    long long start;
+    unsigned long long event;          // traceEvents when the call started
+    int busy;                          // another call was running at the start
+} TraceSpan;
+
+THREAD_FN(trace_writer){
+    (void)arg;
+    mutex_lock(&trace.lock);
+    for(;;){
+        while(!trace.full && !trace.stopping) cond_wait_ms(&trace.wake, &trace.lock, -1);
+        TraceBlock *b = trace.full;
+        if(!b) break;
+        if(!(trace.full = b->next)) trace.fullTail = &trace.full;
+        mutex_unlock(&trace.lock);
+        fwrite(b->data, 1, b->len, trace.f);
+        mutex_lock(&trace.lock);
+        b->len = 0;
+        b->next = trace.spare;
+        trace.spare = b;
+    }
+    mutex_unlock(&trace.lock);
+    THREAD_RETURN;
+}
+
+static void trace_queue_cur(void){
+    trace.cur->next = NULL;
+    *trace.fullTail = trace.cur;
+    trace.fullTail = &trace.cur->next;
+    trace.cur = NULL;
+    cond_signal(&trace.wake);
+}
+
+static void trace_append(unsigned char *rec, size_t size){
+    mutex_lock(&trace.lock);
+    if(trace.f && !trace.stopping){
+        long long start = (long long)get_u(rec + 4, 8) - trace.epoch;
+        put_u(rec + 4, (unsigned long long)(start > 0 ? start : 0), 8);
+        if(trace.cur && trace.cur->len + size > TRACE_BLOCK) trace_queue_cur();
+        if(!trace.cur && trace.spare){
+            trace.cur = trace.spare;
+            trace.spare = trace.cur->next;
+        }
+        if(!trace.cur && trace.blocks < TRACE_BLOCKS && (trace.cur = (TraceBlock*)malloc(sizeof(TraceBlock))) != NULL){
+            trace.cur->len = 0;
+            trace.blocks++;
+        }
+        if(trace.cur){
+            memcpy(trace.cur->data + trace.cur->len, rec, size);
+            trace.cur->len += size;
+        } else metric_count(&traceDropped);
+    }
+    mutex_unlock(&trace.lock);
+}
+
+// mark that a mutation outside the engine interface begins: a replay cannot redo it, so
+// nothing recorded after the marker can be checked (see TRACE_UNTRACED)
+static void trace_untraced(const char *api){
+    unsigned char rec[TRACE_HEADER + 2 + 64];
+    if(!atomic_load_explicit(&traceOn, memory_order_relaxed)) return;
+    size_t size = TRACE_HEADER + 2 + rec_strlen(api);
+    memset(rec, 0, TRACE_HEADER);
+    put_u(rec, size, 4);
+    put_u(rec + 4, (unsigned long long)mono_ns(), 8);
+    rec[20] = TRACE_UNTRACED;
+    rec_put_str(rec + TRACE_HEADER, api);
+    trace_append(rec, size);
+}
+
+// 1 if capturing: the call must then end with trace_call
+static int trace_begin(TraceSpan *sp){
+    if(!atomic_load_explicit(&traceOn, memory_order_relaxed)) return 0;
+    sp->event = atomic_fetch_add(&traceEvents, 1);
+    sp->busy = atomic_fetch_add(&traceInFlight, 1) > 0;
+    sp->start = mono_ns();
+    return 1;
+}
+
+// record a finished call; the arguments follow traceArgs[call]. text is the JSON
+// result of calls that return one
+static void trace_call(int call, const TraceSpan *sp, int result, const char *text, ...){
+    long long start = sp->start, end = mono_ns();
+    atomic_fetch_sub(&traceInFlight, 1);
+    // anything else start or finish since this call started?
+    if(sp->busy || atomic_fetch_add(&traceEvents, 1) != sp->event + 1) call |= TRACE_CONCURRENT;
+    unsigned char small[1024];
+    const char *f = traceArgs[call & ~TRACE_CONCURRENT];
+    size_t size = TRACE_HEADER;
+    va_list ap;
+    va_start(ap, text);
+    for(const char *c = f; *c; c++){
+        if(*c == 's') size += 2 + rec_strlen(va_arg(ap, const char*));
+        else { (void)va_arg(ap, int); size += 4; }
+    }
+    va_end(ap);
+    unsigned char *rec = size <= sizeof(small) ? small : (unsigned char*)malloc(size);
+    if(!rec){ metric_count(&traceDropped); return; }
+    if(trace_returns_text(call & ~TRACE_CONCURRENT)) result = text ? (int)strlen(text) : -1;
+    put_u(rec, size, 4);
+    put_u(rec + 4, (unsigned long long)start, 8);     // made relative to the capture in trace_append
+    put_u(rec + 12, (unsigned long long)(end - start), 8);
+    rec[20] = (unsigned char)call;
+    put_u(rec + 21, (unsigned)result, 4);
+    put_u(rec + 25, trace_returns_text(call & ~TRACE_CONCURRENT) ? trace_hash(text) : 0, 8);
+    unsigned char *p = rec + TRACE_HEADER;
+    va_start(ap, text);
+    for(const char *c = f; *c; c++){
+        if(*c == 's') p += rec_put_str(p, va_arg(ap, const char*));
+        else { put_u(p, (unsigned)va_arg(ap, int), 4); p += 4; }
+    }
+    va_end(ap);
+    trace_append(rec, size);
+    if(rec != small) free(rec);
+}
+
+// trace_start_api: start capturing to path (truncated). 0 if already capturing or it cannot be opened
+EXPORT int STDCALL trace_start_api(const char* path) {
+    engine_init();
+    mutex_lock(&traceCtl);
+    FILE *f = NULL;
+    int ok = !trace.f && path && (f = fopen(path, "wb")) != NULL;
+    if(ok){
+        unsigned char head[TRACE_FILE_HEADER];
+        memcpy(head, TRACE_MAGIC, 8);
+        put_u(head + 8, ENGINE_SHARDS, 4);
+        put_u(head + 12, 0, 4);
+        mutex_lock(&trace.lock);
+        trace.f = f;
+        trace.stopping = 0;
+        trace.epoch = mono_ns();
+        mutex_unlock(&trace.lock);
+        ok = fwrite(head, 1, sizeof(head), f) == sizeof(head) && thread_start(&trace.writer, trace_writer, NULL);
+        if(ok) atomic_store(&traceOn, 1);
+        else {
+            mutex_lock(&trace.lock);
+            trace.f = NULL;
+            mutex_unlock(&trace.lock);
+            fclose(f);
+        }
+    }
+    mutex_unlock(&traceCtl);
+    return ok;
+}
+
+// trace_stop_api: flush and close the trace. Returns 1 if a capture was running
+EXPORT int STDCALL trace_stop_api(void) {
+    engine_init();
+    mutex_lock(&traceCtl);
+    int wasOn = trace.f != NULL;
+    if(wasOn){
+        atomic_store(&traceOn, 0);
+        mutex_lock(&trace.lock);
+        if(trace.cur && trace.cur->len) trace_queue_cur();
+        trace.stopping = 1;
+        cond_signal(&trace.wake);
+        mutex_unlock(&trace.lock);
+        thread_join(trace.writer);
+        mutex_lock(&trace.lock);
+        fclose(trace.f);
+        trace.f = NULL;
+        trace.stopping = 0;
+        while(trace.spare){
+            TraceBlock *b = trace.spare;
+            trace.spare = b->next;
+            free(b);
+        }
+        free(trace.cur);
+        trace.cur = NULL;
+        trace.blocks = 0;
+        mutex_unlock(&trace.lock);
+    }
+    mutex_unlock(&traceCtl);
+    return wasOn;
+}
+
+// the engine interface goes through these, so a capture sees what hosts call
+// the trace holds the first 32 hex digits of password_hash, not the password: the
+// same password still maps to the same stand-in, so replay accepts and refuses alike
+static int STDCALL traced_login_user(const char *username, const char *password){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    int r = login_user_api(username, password);
+    if(on){
+        char hash[65];
+        if(username && password && *password){
+            password_hash(username, password, hash);
+            hash[32] = 0;
+        }
+        trace_call(TRACE_LOGIN, &sp, r, NULL, username, username && password && *password ? hash : password);
+    }
+    return r;
+}
+
+static int STDCALL traced_add_task(const char *username, const char *title, int priority, const char *dueDate, const char *status){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    int r = add_task_api(username, title, priority, dueDate, status);
+    if(on) trace_call(TRACE_ADD, &sp, r, NULL, username, title, priority, dueDate, status);
+    return r;
+}
+
+static int STDCALL traced_edit_task(const char *username, int id, const char *title, int priority, const char *dueDate, const char *status){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    int r = edit_task_api(username, id, title, priority, dueDate, status);
+    if(on) trace_call(TRACE_EDIT, &sp, r, NULL, username, id, title, priority, dueDate, status);
+    return r;
+}
+
+static int STDCALL traced_remove_task(const char *username, int id){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    int r = remove_task_api(username, id);
+    if(on) trace_call(TRACE_REMOVE, &sp, r, NULL, username, id);
+    return r;
+}
+
+static int STDCALL traced_delete_task(const char *username, int id){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    int r = delete_task_api(username, id);
+    if(on) trace_call(TRACE_DELETE, &sp, r, NULL, username, id);
+    return r;
+}
+
+static int STDCALL traced_assign_task(const char *fromUser, const char *toUser, int id){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    int r = assign_task_api(fromUser, toUser, id);
+    if(on) trace_call(TRACE_ASSIGN, &sp, r, NULL, fromUser, toUser, id);
+    return r;
+}
+
+static int STDCALL traced_undo(const char *username){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    int r = undo_api(username);
+    if(on) trace_call(TRACE_UNDO, &sp, r, NULL, username);
+    return r;
+}
+
+static int STDCALL traced_redo(const char *username){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    int r = redo_api(username);
+    if(on) trace_call(TRACE_REDO, &sp, r, NULL, username);
+    return r;
+}
+
+static const char* STDCALL traced_list_tasks(const char *username, const char *criterion){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    const char *r = list_tasks_api(username, criterion);
+    if(on) trace_call(TRACE_LIST, &sp, 0, r, username, criterion);
+    return r;
+}
+
+static const char* STDCALL traced_notifications(const char *username){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    const char *r = notifications_api(username);
+    if(on) trace_call(TRACE_NOTIFICATIONS, &sp, 0, r, username);
+    return r;
+}
+
+static const char* STDCALL traced_manager_tasks(void){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    const char *r = manager_tasks_api();
+    if(on) trace_call(TRACE_MANAGER_TASKS, &sp, 0, r);
+    return r;
+}
+
+static const char* STDCALL traced_search_task(const char *username, const char *q){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    const char *r = search_task_api(username, q);
+    if(on) trace_call(TRACE_SEARCH, &sp, 0, r, username, q);
+    return r;
+}
+
+static const char* STDCALL traced_filter_task(const char *username, const char *status, int priority){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    const char *r = filter_task_api(username, status, priority);
+    if(on) trace_call(TRACE_FILTER, &sp, 0, r, username, status, priority);
+    return r;
+}
+
+static const char* STDCALL traced_analytics(const char *username){
+    TraceSpan sp;
+    int on = trace_begin(&sp);
+    const char *r = analytics_api(username);
+    if(on) trace_call(TRACE_ANALYTICS, &sp, 0, r, username);
+    return r;
+}
+
+// ---------- Engine interface (task_engine.h) ----------
+static const TaskEngineOps treapOps = {
+    TASK_ENGINE_ABI, "treap",
+    traced_login_user, traced_add_task, traced_edit_task, traced_remove_task, traced_delete_task,
+    traced_assign_task, traced_undo, traced_redo, traced_list_tasks, traced_notifications,
+    traced_manager_tasks, traced_search_task, traced_filter_task, traced_analytics
+};
+
+EXPORT const TaskEngineOps* STDCALL task_engine_ops(void) {
+    return &treapOps;
 }
 
 // ----------------- End extern "C"
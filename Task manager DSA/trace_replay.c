@@ -0,0 +1,380 @@
+// trace_replay.c
+// Replays a call trace captured by the treap engine (trace_start_api, or TASK_TRACE=<path>
+// for server.py) against any engine build and checks it answers the same way.
+// Compile:
+// Linux:   gcc -O2 -std=c11 -o trace_replay trace_replay.c -ldl
+// Windows: gcc -O2 -std=c11 -o trace_replay.exe trace_replay.c
+// Run:
+//   trace_replay <trace> <engine library> [--speed X] [--no-verify]
+// Calls run one at a time in trace order (the order the captured calls finished), each
+// started at its captured offset divided by --speed: 1 (default) is the original pace,
+// 10 ten times faster, 0 as fast as the engine answers. Replay into a fresh engine, as
+// the capture was (a server started with TASK_TRACE set, or before any other call).
+//
+// Verification compares every result with the captured one: int results exactly, JSON
+// results by length and trace_hash (creation stamps are ignored). Task ids the replayed
+// engine hands out are mapped back onto the captured ones for later calls; once they
+// differ the JSON results, which embed ids, are counted as unchecked instead. So are the
+// results of calls captured while another call was running (TRACE_CONCURRENT): a serial
+// replay cannot know which of them took effect first. A single-threaded capture is
+// checked in full. The first mismatches are printed to stderr and any mismatch makes
+// the exit status 1.
+// A trace that ran alongside mutations it does not record (imports, team changes,
+// dependencies; see TRACE_UNTRACED) only describes the engine up to the first of
+// them: every result after that is unchecked, the summary counts the markers as
+// "untraced", and the exit status is 1 because the trace could not be verified.
+//
+// Every entry point is reported as one NDJSON line, then a line for the whole trace:
+//   {"engine":"treap","op":"add","calls":5000,"mismatches":0,"unchecked":0,
+//    "ns_per_op":912.3,"captured_ns_per_op":1204.7,"p99_us":3.1}
+//   {"engine":"treap","op":"all","calls":20000,"mismatches":0,"unchecked":0,"untraced":0,
+//    "seconds":2.41,"captured_seconds":2.40,"max_lag_us":812.0}
+// ns_per_op is time spent inside the engine; max_lag_us is how late a call started
+// against its schedule, which stays small unless the engine cannot keep up with --speed.
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "task_engine.h"
+#include "record_codec.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#define MAX_ARGS 6
+#define SHOW_MISMATCHES 10
+
+// ----- Platform helpers -----
+static double now_ns(void){
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if(!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+#endif
+}
+
+static void sleep_ns(double ns){
+#ifdef _WIN32
+    if(ns >= 1e6) Sleep((DWORD)(ns / 1e6));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1e9);
+    ts.tv_nsec = (long)(ns - ts.tv_sec * 1e9);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static const TaskEngineOps* load_engine(const char *path){
+    TaskEngineOpsFn fn = NULL;
+#ifdef _WIN32
+    HMODULE lib = LoadLibraryA(path);
+    if(lib) fn = (TaskEngineOpsFn)(void*)GetProcAddress(lib, "task_engine_ops");
+#else
+    void *lib = dlopen(path, RTLD_NOW);
+    if(!lib) fprintf(stderr, "%s\n", dlerror());
+    // POSIX guarantees function pointers round-trip through void*
+    if(lib) *(void**)&fn = dlsym(lib, "task_engine_ops");
+#endif
+    if(!fn) return NULL;
+    const TaskEngineOps *ops = fn();
+    if(!ops || ops->abi != TASK_ENGINE_ABI){
+        fprintf(stderr, "%s: engine ABI %d, expected %d\n", path, ops ? ops->abi : -1, TASK_ENGINE_ABI);
+        return NULL;
+    }
+    return ops;
+}
+
+// ----- Task id map -----
+// captured id -> replayed id, open addressing; 0 is the empty key (ids start at 1)
+typedef struct {
+    int *keys, *vals;
+    size_t cap, count;
+} IdMap;
+
+static size_t id_slot(const IdMap *m, int key){
+    size_t i = ((uint32_t)key * 2654435761u) & (m->cap - 1);
+    while(m->keys[i] && m->keys[i] != key) i = (i + 1) & (m->cap - 1);
+    return i;
+}
+
+static int id_put(IdMap *m, int key, int val){
+    if((m->count + 1) * 2 > m->cap){
+        IdMap g = { NULL, NULL, m->cap ? m->cap * 2 : 1024, 0 };
+        g.keys = (int*)calloc(g.cap, sizeof(int));
+        g.vals = (int*)malloc(g.cap * sizeof(int));
+        if(!g.keys || !g.vals){ free(g.keys); free(g.vals); return 0; }
+        for(size_t i = 0; i < m->cap; i++)
+            if(m->keys[i]) id_put(&g, m->keys[i], m->vals[i]);
+        free(m->keys); free(m->vals);
+        *m = g;
+    }
+    size_t i = id_slot(m, key);
+    if(!m->keys[i]){ m->keys[i] = key; m->count++; }
+    m->vals[i] = val;
+    return 1;
+}
+
+static int id_get(const IdMap *m, int key){
+    if(!m->cap || key <= 0) return key;
+    size_t i = id_slot(m, key);
+    return m->keys[i] ? m->vals[i] : key;     // ids from before the capture pass through
+}
+
+// ----- Per-entry-point statistics -----
+typedef struct {
+    long long calls, mismatches, unchecked;
+    double ns, capturedNs;
+    double *lat;              // ns of every call, for the p99
+    size_t latCap;
+} OpStats;
+
+static int cmp_double(const void *a, const void *b){
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int record_latency(OpStats *s, double ns){
+    if((size_t)s->calls >= s->latCap){
+        size_t cap = s->latCap ? s->latCap * 2 : 256;
+        double *l = (double*)realloc(s->lat, cap * sizeof(double));
+        if(!l) return 0;
+        s->lat = l;
+        s->latCap = cap;
+    }
+    s->lat[s->calls] = ns;
+    return 1;
+}
+
+// ----- Replay -----
+typedef struct {
+    const TaskEngineOps *ops;
+    IdMap ids;
+    int idsDiverged;
+    OpStats stats[TRACE_CALL_COUNT];
+    long long mismatches;
+    long long untraced;          // TRACE_UNTRACED markers seen
+} Replay;
+
+typedef struct {
+    const char *s[MAX_ARGS];
+    int n[MAX_ARGS];
+} Args;
+
+// decode the arguments of a record into a; strings are NUL-terminated in place in
+// scratch, which must hold the record's argument bytes plus one byte per string
+static int decode_args(Replay *r, int call, const unsigned char *p, const unsigned char *end, char *scratch, Args *a){
+    int k = 0;
+    for(const char *c = traceArgs[call]; *c; c++, k++){
+        if(*c == 's'){
+            if(end - p < 2) return 0;
+            unsigned n = (unsigned)get_u(p, 2);
+            p += 2;
+            if(n == 0xFFFF){ a->s[k] = NULL; continue; }
+            if((size_t)(end - p) < n) return 0;
+            memcpy(scratch, p, n);
+            scratch[n] = '\0';
+            a->s[k] = scratch;
+            scratch += n + 1;
+            p += n;
+        } else {
+            if(end - p < 4) return 0;
+            int v = (int)(int32_t)get_u(p, 4);
+            a->n[k] = *c == 'd' ? id_get(&r->ids, v) : v;
+            p += 4;
+        }
+    }
+    return p == end;
+}
+
+static int run_call(const TaskEngineOps *o, int call, const Args *a, const char **text){
+    *text = NULL;
+    switch(call){
+    case TRACE_LOGIN:   return o->login_user(a->s[0], a->s[1]);
+    case TRACE_ADD:     return o->add_task(a->s[0], a->s[1], a->n[2], a->s[3], a->s[4]);
+    case TRACE_EDIT:    return o->edit_task(a->s[0], a->n[1], a->s[2], a->n[3], a->s[4], a->s[5]);
+    case TRACE_REMOVE:  return o->remove_task(a->s[0], a->n[1]);
+    case TRACE_DELETE:  return o->delete_task(a->s[0], a->n[1]);
+    case TRACE_ASSIGN:  return o->assign_task(a->s[0], a->s[1], a->n[2]);
+    case TRACE_UNDO:    return o->undo(a->s[0]);
+    case TRACE_REDO:    return o->redo(a->s[0]);
+    case TRACE_LIST:          *text = o->list_tasks(a->s[0], a->s[1]); break;
+    case TRACE_NOTIFICATIONS: *text = o->notifications(a->s[0]); break;
+    case TRACE_MANAGER_TASKS: *text = o->manager_tasks(); break;
+    case TRACE_SEARCH:        *text = o->search_task(a->s[0], a->s[1]); break;
+    case TRACE_FILTER:        *text = o->filter_task(a->s[0], a->s[1], a->n[2]); break;
+    case TRACE_ANALYTICS:     *text = o->analytics(a->s[0]); break;
+    }
+    return *text ? (int)strlen(*text) : -1;
+}
+
+static void mismatch(Replay *r, long long index, int call, const char *what, long long want, long long got){
+    r->stats[call].mismatches++;
+    if(r->mismatches++ < SHOW_MISMATCHES)
+        fprintf(stderr, "record %lld (%s): %s %lld, captured %lld\n", index, traceNames[call], what, got, want);
+}
+
+// compare one replayed call with its record; id-returning calls update the id map
+static void verify(Replay *r, long long index, int call, int concurrent, int want, uint64_t wantHash, int got, const char *text){
+    OpStats *s = &r->stats[call];
+    concurrent |= r->untraced > 0; // the engine's state is no longer known either
+    if(call == TRACE_ADD){
+        if(concurrent && (want > 0) != (got > 0)) s->unchecked++;
+        else if((want > 0) != (got > 0)) mismatch(r, index, call, "returned", want, got);
+        else if(want > 0){
+            if(want != got) r->idsDiverged = 1;
+            if(!id_put(&r->ids, want, got)) r->idsDiverged = 1;
+        }
+    } else if(concurrent) s->unchecked++;
+    else if(!trace_returns_text(call)){
+        if(want != got) mismatch(r, index, call, "returned", want, got);
+    } else if(r->idsDiverged) s->unchecked++;
+    else if(want != got) mismatch(r, index, call, "result length", want, got);
+    else if(trace_hash(text) != wantHash) mismatch(r, index, call, "result hash", (long long)wantHash, (long long)trace_hash(text));
+}
+
+int main(int argc, char **argv){
+    const char *tracePath = NULL, *engine = NULL;
+    double speed = 1.0;
+    int check = 1;
+    Replay r;
+
+    memset(&r, 0, sizeof(r));
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = atof(argv[++i]);
+        else if(strcmp(argv[i], "--no-verify") == 0) check = 0;
+        else if(!tracePath && argv[i][0] != '-') tracePath = argv[i];
+        else if(!engine && argv[i][0] != '-') engine = argv[i];
+        else {
+            fprintf(stderr, "unknown argument %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if(!tracePath || !engine || speed < 0){
+        fprintf(stderr, "usage: %s <trace> <engine library> [--speed X] [--no-verify]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *f = fopen(tracePath, "rb");
+    unsigned char head[TRACE_FILE_HEADER];
+    if(!f || fread(head, 1, sizeof(head), f) != sizeof(head) || memcmp(head, TRACE_MAGIC, 8) != 0){
+        fprintf(stderr, "%s: not a call trace\n", tracePath);
+        return 2;
+    }
+    r.ops = load_engine(engine);
+    if(!r.ops){
+        fprintf(stderr, "%s: cannot load task_engine_ops\n", engine);
+        return 1;
+    }
+
+    unsigned char *rec = NULL;
+    char *scratch = NULL;
+    size_t recCap = 0;
+    long long index = 0;
+    double begin = now_ns(), maxLag = 0, capturedEnd = 0;
+    unsigned char sizeBytes[4];
+    while(fread(sizeBytes, 1, 4, f) == 4){
+        size_t size = (size_t)get_u(sizeBytes, 4);
+        if(size < TRACE_HEADER){
+            fprintf(stderr, "record %lld: bad size %zu\n", index, size);
+            break;
+        }
+        if(size > recCap){
+            free(rec); free(scratch);
+            recCap = size * 2;
+            rec = (unsigned char*)malloc(recCap);
+            scratch = (char*)malloc(recCap + MAX_ARGS);
+            if(!rec || !scratch){
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+        }
+        if(fread(rec + 4, 1, size - 4, f) != size - 4){
+            fprintf(stderr, "record %lld: trace ends mid-record\n", index);
+            break;
+        }
+        double start = (double)get_u(rec + 4, 8), took = (double)get_u(rec + 12, 8);
+        int call = rec[20] & ~TRACE_CONCURRENT, concurrent = (rec[20] & TRACE_CONCURRENT) != 0;
+        int want = (int)(int32_t)get_u(rec + 21, 4);
+        uint64_t wantHash = get_u(rec + 25, 8);
+        Args a;
+        memset(&a, 0, sizeof(a));
+        if(call == TRACE_UNTRACED){
+            size_t n = size >= TRACE_HEADER + 2 ? (size_t)get_u(rec + TRACE_HEADER, 2) : 0;
+            if(size != TRACE_HEADER + 2 + n){
+                fprintf(stderr, "record %lld: malformed\n", index);
+                break;
+            }
+            if(!r.untraced++)
+                fprintf(stderr, "record %lld: %.*s ran during the capture and is not in the trace; "
+                        "later results are not checked\n", index, (int)n, (const char*)rec + TRACE_HEADER + 2);
+            index++;
+            continue;
+        }
+        if(call >= TRACE_CALL_COUNT || !decode_args(&r, call, rec + TRACE_HEADER, rec + size, scratch, &a)){
+            fprintf(stderr, "record %lld: malformed\n", index);
+            break;
+        }
+
+        if(speed > 0){
+            double due = begin + start / speed, now = now_ns();
+            if(due > now) sleep_ns(due - now);
+            else if(now - due > maxLag) maxLag = now - due;
+        }
+        const char *text;
+        double t0 = now_ns();
+        int got = run_call(r.ops, call, &a, &text);
+        double ns = now_ns() - t0;
+
+        OpStats *s = &r.stats[call];
+        if(!record_latency(s, ns)){
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        s->calls++;
+        s->ns += ns;
+        s->capturedNs += took;
+        if(start + took > capturedEnd) capturedEnd = start + took;
+        if(check) verify(&r, index, call, concurrent, want, wantHash, got, text);
+        index++;
+    }
+    fclose(f);
+    double elapsed = now_ns() - begin;
+
+    long long unchecked = 0;
+    const char *name = r.ops->name ? r.ops->name : "?";
+    for(int c = 0; c < TRACE_CALL_COUNT; c++){
+        OpStats *s = &r.stats[c];
+        if(!s->calls) continue;
+        qsort(s->lat, (size_t)s->calls, sizeof(double), cmp_double);
+        size_t p99 = (size_t)(s->calls * 99 / 100);
+        unchecked += s->unchecked;
+        printf("{\"engine\":\"%s\",\"op\":\"%s\",\"calls\":%lld,\"mismatches\":%lld,\"unchecked\":%lld,"
+               "\"ns_per_op\":%.1f,\"captured_ns_per_op\":%.1f,\"p99_us\":%.1f}\n",
+               name, traceNames[c], s->calls, s->mismatches, s->unchecked,
+               s->ns / s->calls, s->capturedNs / s->calls, s->lat[p99] / 1e3);
+        free(s->lat);
+    }
+    printf("{\"engine\":\"%s\",\"op\":\"all\",\"calls\":%lld,\"mismatches\":%lld,\"unchecked\":%lld,\"untraced\":%lld,"
+           "\"seconds\":%.3f,\"captured_seconds\":%.3f,\"max_lag_us\":%.1f}\n",
+           name, index - r.untraced, r.mismatches, unchecked, r.untraced, elapsed / 1e9, capturedEnd / 1e9, maxLag / 1e3);
+    if(!check) fprintf(stderr, "results not verified (--no-verify)\n");
+    free(rec); free(scratch);
+    free(r.ids.keys); free(r.ids.vals);
+    return r.mismatches || (check && r.untraced) ? 1 : 0;
+}